@@ -0,0 +1,569 @@
+/**
+ * @file agent.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - connection-pooling agent shared by the client processes.
+ *
+ * The agent keeps a pool of connections to each server the clients use and the login tokens
+ * of their accounts in memory, so concurrent clients on the host neither connect to the server
+ * themselves nor share the login-token file. A client forwards each request over the Unix socket
+ * of the agent when it is running, preceded by a header naming the server and the account:
+ *  (agent "<addr>" "<port>" "<user>") (<request as sent to the server>)
+ * The user is escaped as in the requests, empty for the account of the last login on the server.
+ * The agent sends the request over its pool with the token of the account in place of the token
+ * of the client, keeps the token of a login (and drops it on logout) and sends the reply of the
+ * server back as it is, in the order of the requests of the connection. A request the server does
+ * not answer gets (err "agent: ...") instead. All connections are served by one epoll loop,
+ * the engines of the pools are watched through their epoll descriptors.
+ *
+ * usage: agent [ <option> ... ]
+ * <option> is one of
+ * -s <path>, --socket <path>
+ *    Socket to listen on, $ISA_AGENT, else isa-agent.sock in $XDG_RUNTIME_DIR
+ *    or /tmp/isa-agent-<uid>.sock by default
+ * -c <count>, --connections <count>
+ *    Connections kept to each server, 4 by default
+ * --connect-timeout <ms>
+ *    Time to connect to a server over all its addresses, 10000 by default, 0 without timeout
+ * --read-timeout <ms>
+ *    Time a server may send no reply data for while a reply is awaited, 30000 by default
+ * --write-timeout <ms>
+ *    Time a server may stop reading a request for while it is sent, 30000 by default
+ * -d, --daemon
+ *    Run in the background once the socket is listening
+ * --help, -h
+ *    Show this help
+ */
+
+#include "agent.h"
+
+static int epfd = -1;
+static std::vector<s_agent_conn> conns; // client connections indexed by socket
+static std::unordered_map<std::string, std::unique_ptr<s_agent_server>> servers; // pools by "<addr> <port>"
+static std::unordered_map<int, s_agent_server *> engines; // pools by the epoll descriptor of their engine
+static uint64_t next_conn_id = 1;
+static bool daemonize = false;
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int) {
+    stop = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    parseargs(argc, argv);
+
+    int listenfd = listen_agent();
+    if (listenfd == -1) {
+        return 2;
+    }
+    //* detached only once the socket is ready, so the clients started next find it
+    if (daemonize && daemon(1, 0) == -1) {
+        perror("agent: daemon");
+        close(listenfd);
+        unlink(agent_args.socket.c_str());
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int rv = run_loop(listenfd);
+    close(listenfd);
+    unlink(agent_args.socket.c_str());
+    return rv;
+}
+
+void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"socket", 1, 0, 's'},
+                {"connections", 1, 0, 'c'},
+                {"connect-timeout", 1, 0, 'C'},
+                {"read-timeout", 1, 0, 'R'},
+                {"write-timeout", 1, 0, 'W'},
+                {"daemon", 0, 0, 'd'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "s:c:dh", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 's':
+                agent_args.socket = optarg;
+                break;
+            case 'c':
+                agent_args.connections = std::max(1, atoi(optarg));
+                break;
+            case 'C':
+                args.connect_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'R':
+                args.read_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'W':
+                args.write_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'd':
+                daemonize = true;
+                break;
+            case 'h':
+                p_help();
+                break;
+            case '?':
+                exit(1);
+        }
+    }
+
+    //! no positional arguments
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument %s. See --help.\n", argv[optind]);
+        exit(1);
+    }
+    if (agent_args.socket == "") {
+        agent_args.socket = agent_socket_path();
+    }
+    if (agent_args.socket == "") {
+        fprintf(stderr, "The agent is disabled by %s=0, give the socket with --socket.\n", AGENT_ENV);
+        exit(1);
+    }
+}
+
+void p_help() {
+    printf("usage: agent [ <option> ... ]\n <option> is one of\n-s <path>, --socket <path>\nSocket to listen on ($ISA_AGENT, else isa-agent.sock in $XDG_RUNTIME_DIR or /tmp/isa-agent-<uid>.sock)\n");
+    printf("-c <count>, --connections <count>\nConnections kept to each server (default 4)\n");
+    printf("--connect-timeout <ms>\nTime to connect to a server over all its addresses (default 10000, 0 without timeout)\n--read-timeout <ms>\nTime a server may send no reply data for (default 30000)\n--write-timeout <ms>\nTime a server may stop reading a request for (default 30000)\n");
+    printf("-d, --daemon\nRun in the background once the socket is listening\n--help, -h\nShow this help\n");
+    exit(0);
+}
+
+int listen_agent() {
+    struct sockaddr_un addr;
+    socklen_t addrlen = agent_address(agent_args.socket, addr);
+
+    if (addrlen == 0) {
+        fprintf(stderr, "Invalid agent socket %s.\n", agent_args.socket.c_str());
+        return -1;
+    }
+    int listenfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenfd == -1) {
+        perror("agent: socket");
+        return -1;
+    }
+    //* the socket gives the tokens of the accounts away, only the user may connect
+    mode_t mask = umask(077);
+    int rv = bind(listenfd, (struct sockaddr *)&addr, addrlen);
+    if (rv == -1 && errno == EADDRINUSE) {
+        //* a socket left by an agent that is not running is replaced
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe != -1 && connect(probe, (struct sockaddr *)&addr, addrlen) == 0) {
+            fprintf(stderr, "Another agent is running on %s.\n", agent_args.socket.c_str());
+            close(probe);
+            close(listenfd);
+            umask(mask);
+            return -1;
+        }
+        if (probe != -1) {
+            close(probe);
+        }
+        unlink(agent_args.socket.c_str());
+        rv = bind(listenfd, (struct sockaddr *)&addr, addrlen);
+    }
+    umask(mask);
+    if (rv == -1) {
+        perror("agent: bind");
+        close(listenfd);
+        return -1;
+    }
+    if (listen(listenfd, SOMAXCONN) == -1) {
+        perror("agent: listen");
+        close(listenfd);
+        unlink(agent_args.socket.c_str());
+        return -1;
+    }
+    return listenfd;
+}
+
+int run_loop(int listenfd) {
+    struct epoll_event ev, events[AGENT_MAXEVENTS];
+
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd == -1) {
+        perror("agent: epoll_create1");
+        return 1;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = listenfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev) == -1) {
+        perror("agent: epoll_ctl");
+        close(epfd);
+        return 1;
+    }
+
+    while (!stop) {
+        //* sleep until the nearest deadline of the pools
+        int timeout = -1;
+        for (auto &server : servers) {
+            timeout = engine_timeout(server.second->engine, timeout);
+        }
+
+        int n = epoll_wait(epfd, events, AGENT_MAXEVENTS, timeout);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("agent: epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenfd) {
+                accept_connections(listenfd);
+                continue;
+            }
+            auto engine = engines.find(fd);
+            if (engine != engines.end()) {
+                engine_poll(engine->second->engine, 0);
+                continue;
+            }
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) && conns[fd].open && !conns[fd].closing) {
+                read_requests(fd);
+            }
+            if ((events[i].events & EPOLLOUT) && conns[fd].open) {
+                write_replies(fd);
+            }
+            //* the client is gone, its replies cannot be sent
+            if ((events[i].events & (EPOLLHUP | EPOLLERR)) && conns[fd].open) {
+                close_connection(fd);
+            }
+        }
+
+        //* connects to start and deadlines passed in the pools
+        for (auto &server : servers) {
+            if (server.second->engine.timed > 0) {
+                engine_poll(server.second->engine, 0);
+            }
+        }
+    }
+
+    for (size_t fd = 0; fd < conns.size(); fd++) {
+        if (conns[fd].open) {
+            close_connection(fd);
+        }
+    }
+    for (auto &server : servers) {
+        engine_free(server.second->engine);
+        free_server(server.second->server_info);
+    }
+    servers.clear();
+    close(epfd);
+    return stop ? 0 : 1;
+}
+
+void accept_connections(int listenfd) {
+    struct epoll_event ev;
+    int fd;
+
+    while ((fd = accept4(listenfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("agent: epoll_ctl");
+            close(fd);
+            continue;
+        }
+        if ((size_t)fd >= conns.size()) {
+            conns.resize(fd + 1);
+        }
+        conns[fd] = s_agent_conn();
+        conns[fd].open = true;
+        conns[fd].id = next_conn_id++;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("agent: accept");
+    }
+}
+
+void read_requests(int fd) {
+    char buf[AGENT_MAXDATASIZE];
+    s_agent_conn &conn = conns[fd];
+    ssize_t numbytes;
+    bool closed = false;
+
+    //* the rest is read in the next iteration once the buffered requests are framed
+    while (conn.in.size() <= AGENT_MAXUNFRAMED && (numbytes = recv(fd, buf, AGENT_MAXDATASIZE, 0)) > 0) {
+        conn.in.append(buf, numbytes);
+    }
+    if (conn.in.size() <= AGENT_MAXUNFRAMED && (numbytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))) {
+        closed = true;
+    }
+
+    //* the header and the request are framed one after the other
+    size_t handled = 0, end;
+    while ((end = frame_reply(conn.framer, conn.in.data() + conn.scanned, conn.in.size() - conn.scanned)) != std::string::npos) {
+        conn.scanned += end;
+        std::string_view message(conn.in.data() + handled, conn.scanned - handled);
+        handled = conn.scanned;
+        conn.framer = s_framer();
+        if (conn.header == "") {
+            conn.header = message;
+            continue;
+        }
+        forward_request(fd, conn.header, message);
+        if (!conns[fd].open) {
+            return; // the client went away while its replies were written
+        }
+        conn.header.clear();
+    }
+    conn.scanned = conn.in.size();
+    conn.in.erase(0, handled);
+    conn.scanned -= handled;
+    //! a request that never ends would be buffered without a limit
+    if (conn.in.size() > AGENT_MAXUNFRAMED) {
+        fprintf(stderr, "A client request is longer than %d bytes, closing its connection.\n", AGENT_MAXUNFRAMED);
+        close_connection(fd);
+        return;
+    }
+
+    //* client closed its side, finish sending the replies of its requests
+    if (closed) {
+        conn.closing = true;
+        if (conn.replies.empty() && conn.out_offset == conn.out.size()) {
+            close_connection(fd);
+        } else {
+            struct epoll_event ev;
+            ev.events = conn.writing ? EPOLLOUT : 0;
+            ev.data.fd = fd;
+            epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+}
+
+void forward_request(int fd, std::string_view header, std::string_view request) {
+    std::shared_ptr<s_agent_reply> slot = std::make_shared<s_agent_reply>();
+    s_request head, parsed;
+
+    conns[fd].replies.push_back(slot);
+    //! the header names the server and the account
+    if (parse_request(header, head) != 0 || head.command != "agent" || head.args.size() != 3) {
+        slot->reply = agent_error("agent: malformed request header");
+    } else if (parse_request(request, parsed) != 0) {
+        slot->reply = agent_error("agent: malformed request");
+    }
+    s_agent_server *server = NULL;
+    if (slot->reply == "" && (server = get_server(std::string(head.args[0]), std::string(head.args[1]))) == NULL) {
+        slot->reply = agent_error("agent: the server address cannot be resolved");
+    }
+    if (slot->reply != "") {
+        slot->done = true;
+        flush_replies(fd);
+        return;
+    }
+
+    //* the token of the account replaces the one sent by the client
+    std::string message(request);
+    std::string account(head.args[2]);
+    e_effect effect = EFFECT_NONE;
+    bool read_only = false;
+    int index = find_command(parsed.command);
+    if (index != -1) {
+        const s_command &entry = command_table[index];
+        effect = entry.effect;
+        read_only = entry.read_only;
+        if (effect == EFFECT_LOGIN && !parsed.args.empty()) {
+            account = parsed.args[0];
+        } else if (account == "") {
+            account = server->last;
+        }
+        auto token = server->tokens.find(account);
+        for (size_t i = 0; i < entry.count && i < parsed.args.size() && token != server->tokens.end(); i++) {
+            if (entry.args[i] == ARG_TOKEN) {
+                message = with_token(parsed, i, token->second);
+            }
+        }
+    }
+
+    s_engine_request upstream;
+    message_own(upstream.message, std::move(message));
+    upstream.read_only = read_only;
+    upstream.on_done = [fd, id = conns[fd].id, slot, server, effect, account](int status, std::string reply) {
+        if (status == 0) {
+            resolve_account(*server, effect, account, reply);
+            slot->reply = std::move(reply);
+        } else if (status == 3) {
+            server->stale = true;
+            slot->reply = agent_error("agent: failed to connect to the server");
+        } else if (status == 4) {
+            slot->reply = agent_error("agent: the server did not answer in time");
+        } else if (status == 2) {
+            slot->reply = agent_error("agent: invalid server response");
+        } else {
+            slot->reply = agent_error("agent: connection closed before the reply");
+        }
+        slot->done = true;
+        if (conns[fd].open && conns[fd].id == id) {
+            flush_replies(fd);
+        }
+    };
+    //* the requests of all clients are spread over the pool in turns
+    int conn = server->conns[server->next_conn++ % server->conns.size()];
+    engine_submit(server->engine, conn, std::move(upstream));
+}
+
+s_agent_server *get_server(std::string addr, std::string port) {
+    std::string key = addr + " " + port;
+    struct epoll_event ev;
+
+    auto found = servers.find(key);
+    std::unordered_map<std::string, std::string> tokens;
+    std::string last = "";
+    //* a server that could not be connected to is resolved again, the tokens are kept
+    if (found != servers.end() && found->second->stale && found->second->engine.pending == 0) {
+        s_agent_server &stale = *found->second;
+        tokens.swap(stale.tokens);
+        last = stale.last;
+        engines.erase(stale.engine.epfd);
+        epoll_ctl(epfd, EPOLL_CTL_DEL, stale.engine.epfd, NULL);
+        engine_free(stale.engine);
+        free_server(stale.server_info);
+        servers.erase(found);
+        found = servers.end();
+    }
+    if (found != servers.end()) {
+        return found->second.get();
+    }
+
+    std::unique_ptr<s_agent_server> server = std::make_unique<s_agent_server>();
+    server->addr = addr;
+    server->port = port;
+    server->tokens.swap(tokens);
+    server->last = last;
+    if (resolve_address(addr, port, &server->server_info) != 0) {
+        return NULL;
+    }
+    if (engine_init(server->engine, server->server_info) != 0) {
+        free_server(server->server_info);
+        return NULL;
+    }
+    server->engine.connect_timeout = args.connect_timeout;
+    server->engine.read_timeout = args.read_timeout;
+    server->engine.write_timeout = args.write_timeout;
+    for (int i = 0; i < agent_args.connections; i++) {
+        server->conns.push_back(engine_open(server->engine));
+    }
+    //* the engine is polled once its own epoll instance has events
+    ev.events = EPOLLIN;
+    ev.data.fd = server->engine.epfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, server->engine.epfd, &ev) == -1) {
+        perror("agent: epoll_ctl");
+        engine_free(server->engine);
+        free_server(server->server_info);
+        return NULL;
+    }
+    engines[server->engine.epfd] = server.get();
+    return (servers[key] = std::move(server)).get();
+}
+
+std::string with_token(const s_request &parsed, size_t position, std::string_view token) {
+    std::string request = "(";
+    request += parsed.command;
+    for (size_t i = 0; i < parsed.args.size(); i++) {
+        request += " ";
+        if (i == position) {
+            request += "\"";
+            request += token;
+            request += "\"";
+        } else if (parsed.quoted[i]) {
+            request += "\"";
+            request += parsed.args[i];
+            request += "\"";
+        } else {
+            request += parsed.args[i];
+        }
+    }
+    request += ")";
+    return request;
+}
+
+void resolve_account(s_agent_server &server, e_effect effect, std::string account, std::string_view reply) {
+    s_reply parsed;
+
+    if (effect == EFFECT_NONE || parse_response(reply, parsed) != 0 || !parsed.ok) {
+        return;
+    }
+    if (effect == EFFECT_LOGIN && parsed.fields.size() > 1) {
+        server.tokens[account] = parsed.fields[1];
+        server.last = account;
+    } else if (effect == EFFECT_LOGOUT) {
+        server.tokens.erase(account);
+        if (server.last == account) {
+            server.last = "";
+        }
+    }
+}
+
+void flush_replies(int fd) {
+    s_agent_conn &conn = conns[fd];
+
+    //* a reply is sent once the replies of the requests before it are
+    while (!conn.replies.empty() && conn.replies.front()->done) {
+        conn.out += conn.replies.front()->reply;
+        conn.replies.pop_front();
+    }
+    write_replies(fd);
+}
+
+void write_replies(int fd) {
+    s_agent_conn &conn = conns[fd];
+    struct epoll_event ev;
+    ssize_t numbytes;
+
+    while (conn.out_offset < conn.out.size()) {
+        numbytes = send(fd, conn.out.data() + conn.out_offset, conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (numbytes == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            close_connection(fd);
+            return;
+        }
+        conn.out_offset += numbytes;
+    }
+
+    bool pending = conn.out_offset < conn.out.size();
+    if (!pending) {
+        conn.out.clear();
+        conn.out_offset = 0;
+        if (conn.closing && conn.replies.empty()) {
+            close_connection(fd);
+            return;
+        }
+    }
+    //* wait for the socket to become writable only while something is pending
+    if (pending != conn.writing) {
+        conn.writing = pending;
+        ev.events = (conn.closing ? 0 : EPOLLIN | EPOLLRDHUP) | (pending ? EPOLLOUT : 0);
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+}
+
+void close_connection(int fd) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    conns[fd] = s_agent_conn();
+}
+
+std::string agent_error(std::string text) {
+    return "(err \"" + char_to_escaped(text) + "\")";
+}
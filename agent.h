@@ -0,0 +1,149 @@
+/**
+ * @file agent.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - connection-pooling agent shared by the client processes, header.
+ *
+ **/
+
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <sys/stat.h>
+#include "engine.h"
+
+#define AGENT_MAXDATASIZE 65536 // max number of bytes read from a client at once
+#define AGENT_MAXUNFRAMED (16 * 1024 * 1024) // max number of bytes of a client request not yet framed
+#define AGENT_MAXEVENTS 256 // max number of events handled in one loop iteration
+
+struct s_agent_args {
+    std::string socket = ""; // socket the clients connect to, the default of agent_socket_path if empty
+    int connections = 4; // connections kept to each server
+} agent_args;
+
+struct s_agent_server {
+    std::string addr = ""; // server hostname or address, as given by the clients
+    std::string port = "";
+    struct addrinfo *server_info = NULL;
+    s_engine engine; // the pool of connections to the server
+    std::vector<int> conns; // engine connections, used in turns
+    size_t next_conn = 0;
+    std::unordered_map<std::string, std::string> tokens; // login tokens by escaped user name
+    std::string last = ""; // escaped user name of the last login, its token is used if the client names no account
+    bool stale = false; // the server could not be connected to, it is resolved again once idle
+};
+
+struct s_agent_reply {
+    bool done = false; // the reply was received from the server (or an error built)
+    std::string reply = "";
+};
+
+struct s_agent_conn {
+    bool open = false;
+    uint64_t id = 0; // distinguishes connections reusing the same descriptor
+    std::string in = ""; // received data not handled yet
+    size_t scanned = 0; // bytes of the received data already passed to the framer
+    s_framer framer;
+    std::string header = ""; // header of the request being received, empty while the header is awaited
+    std::deque<std::shared_ptr<s_agent_reply>> replies; // replies of the requests in their order, sent once done
+    std::string out = ""; // replies not sent yet
+    size_t out_offset = 0; // bytes of the replies already sent
+    bool writing = false; // EPOLLOUT is registered
+    bool closing = false; // the client closed its side, close once the replies are sent
+};
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+void parseargs(int argc, char** argv);
+
+/**
+ * Print help.
+ */
+void p_help();
+
+/**
+ * Create the listening socket, a stale socket of an agent that is not running is replaced.
+ * @return Listening socket, or -1 if an error occurs (or another agent is running).
+ */
+int listen_agent();
+
+/**
+ * Serve the clients until the agent is stopped by a signal.
+ * @param listenfd Listening socket.
+ * @return 1 if an error occurs, else 0.
+ */
+int run_loop(int listenfd);
+
+/**
+ * Accept all pending connections.
+ * @param listenfd Listening socket.
+ */
+void accept_connections(int listenfd);
+
+/**
+ * Read the available data and forward all complete requests.
+ * @param fd Client socket.
+ */
+void read_requests(int fd);
+
+/**
+ * Forward a request to the pool of the server named by its header.
+ * @param fd Client socket.
+ * @param header Header of the request.
+ * @param request The request as sent to the server.
+ */
+void forward_request(int fd, std::string_view header, std::string_view request);
+
+/**
+ * Get the pool of a server, it is created with the first request.
+ * @param addr Server hostname or address.
+ * @param port Server port.
+ * @return Server pool, NULL if the server cannot be resolved.
+ */
+s_agent_server *get_server(std::string addr, std::string port);
+
+/**
+ * Rebuild a request with the login token of the account.
+ * @param parsed Parsed request.
+ * @param position Index of the token argument.
+ * @param token Login token.
+ * @return Request to be sent.
+ */
+std::string with_token(const s_request &parsed, size_t position, std::string_view token);
+
+/**
+ * Keep the token of a login, or forget the token of a logout.
+ * @param server Server pool.
+ * @param effect Effect of the command on the token.
+ * @param account Escaped user name of the request.
+ * @param reply Reply of the server.
+ */
+void resolve_account(s_agent_server &server, e_effect effect, std::string account, std::string_view reply);
+
+/**
+ * Send the replies that are complete, in the order of the requests.
+ * @param fd Client socket.
+ */
+void flush_replies(int fd);
+
+/**
+ * Send the queued replies until the socket would block.
+ * @param fd Client socket.
+ */
+void write_replies(int fd);
+
+/**
+ * Close the client connection and forget its state, its requests in flight are completed unseen.
+ * @param fd Client socket.
+ */
+void close_connection(int fd);
+
+/**
+ * Build the error reply of a request the server did not answer.
+ * @param text Error message.
+ * @return Reply message.
+ */
+std::string agent_error(std::string text);
@@ -0,0 +1,327 @@
+/**
+ * @file analyzer.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - offline analyzer of captured protocol traffic.
+ *
+ * Reads a pcap capture (e.g. isa.pcap) without copying it: the file is mapped, one pass over
+ * the record headers decodes the link, IP and TCP headers and assigns the packets of the protocol
+ * to shards by their TCP connection. The shards are then analyzed in parallel, each thread
+ * reassembles the streams of its connections (out-of-order and retransmitted segments included),
+ * frames the messages and parses them with the client and server parser, and matches the replies
+ * to the requests in order as the isa.lua dissector does.
+ * The latency is measured from the segment completing the request to the segment completing the reply.
+ *
+ * usage: analyzer [ <option> ... ] <file>
+ * <option> is one of
+ * -p <port>, --port <port>
+ *    Server port the traffic is told apart by, 32323 by default
+ * -t <count>, --threads <count>
+ *    Number of analyzing threads, number of cores by default
+ * -j, --json
+ *    Print the report as JSON
+ * -H, --histogram
+ *    Print the percentile distribution of each command
+ * --help, -h
+ *    Show this help
+ */
+
+#include "analyzer.h"
+
+int main(int argc, char *argv[])
+{
+    s_capture capture;
+    uint32_t streams = 0;
+
+    parseargs(argc, argv);
+
+    if (open_capture(capture, analyzer_args.file) != 0) {
+        return 1;
+    }
+
+    //* the connections are spread over the threads, each connection is reassembled by one thread only
+    int threads = analyzer_args.threads > 0 ? analyzer_args.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<s_shard> shards(threads);
+    std::vector<std::vector<s_packet>> packets_of(threads);
+    capture.port = analyzer_args.port;
+    uint64_t packets = dispatch_packets(capture, packets_of, streams);
+    madvise((void *)capture.data, capture.size, MADV_NORMAL);
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++) {
+        s_shard &shard = shards[i];
+        shard.packets.swap(packets_of[i]);
+        shard.stats.resize(ANALYZER_COMMANDS);
+        if (!shard.packets.empty()) {
+            workers.emplace_back(analyze_shard, &capture, &shard);
+        }
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    //* merge the statistics of the shards, the last entry is the total
+    std::vector<s_command_stats> stats(ANALYZER_COMMANDS + 1);
+    uint64_t unmatched = 0, gaps = 0;
+    for (auto &shard : shards) {
+        for (int i = 0; i < ANALYZER_COMMANDS; i++) {
+            for (s_command_stats *target : {&stats[i], &stats[ANALYZER_COMMANDS]}) {
+                const s_command_stats &s = shard.stats[i];
+                histogram_merge(target->latency, s.latency);
+                target->requests += s.requests;
+                target->ok += s.ok;
+                target->err += s.err;
+                target->unanswered += s.unanswered;
+                target->malformed += s.malformed;
+                target->request_bytes += s.request_bytes;
+                target->reply_bytes += s.reply_bytes;
+                target->max_reply = std::max(target->max_reply, s.max_reply);
+            }
+        }
+        unmatched += shard.unmatched;
+        gaps += shard.gaps;
+    }
+
+    double elapsed = capture.last > capture.first ? (capture.last - capture.first) / 1e6 : 0;
+    if (analyzer_args.json) {
+        print_json(stats, packets, streams, unmatched, gaps, elapsed);
+    } else {
+        print_text(stats, packets, streams, unmatched, gaps, elapsed);
+    }
+
+    close_capture(capture);
+    return 0;
+}
+
+void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"port", 1, 0, 'p'},
+                {"threads", 1, 0, 't'},
+                {"json", 0, 0, 'j'},
+                {"histogram", 0, 0, 'H'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "p:t:jHh", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 'p':
+                analyzer_args.port = atoi(optarg);
+                break;
+            case 't':
+                analyzer_args.threads = atoi(optarg);
+                break;
+            case 'j':
+                analyzer_args.json = true;
+                break;
+            case 'H':
+                analyzer_args.histogram = true;
+                break;
+            case 'h':
+                p_help();
+                break;
+            case '?':
+                exit(1);
+        }
+    }
+
+    //! exactly one capture file
+    if (optind != argc - 1) {
+        fprintf(stderr, "Missing capture file. See --help.\n");
+        exit(1);
+    }
+    analyzer_args.file = argv[optind];
+    //! invalid values
+    if (analyzer_args.port == 0 || analyzer_args.threads < 0) {
+        fprintf(stderr, "Invalid port or number of threads. See --help.\n");
+        exit(1);
+    }
+}
+
+void p_help() {
+    printf("usage: analyzer [ <option> ... ] <file>\n <option> is one of\n-p <port>, --port <port>\nServer port the traffic is told apart by, 32323 by default\n");
+    printf("-t <count>, --threads <count>\nNumber of analyzing threads, number of cores by default\n-j, --json\nPrint the report as JSON\n");
+    printf("-H, --histogram\nPrint the percentile distribution of each command\n--help, -h\nShow this help\n");
+    exit(0);
+}
+
+void analyze_shard(const s_capture *capture, s_shard *shard) {
+    std::unordered_map<uint32_t, std::deque<s_exchange>> requests; // requests waiting for the reply by connection
+    s_reassembly reassembly;
+
+    reassembly.max_kept = ANALYZER_MAX_PARSED;
+    reassembly.on_message = [&](uint32_t stream, bool to_server, const s_direction &dir, uint64_t time) {
+        complete_message(*shard, requests[stream], to_server, dir, time);
+    };
+    //* requests still waiting when the connection ends were not answered
+    reassembly.on_close = [&](uint32_t stream) {
+        auto found = requests.find(stream);
+        if (found != requests.end()) {
+            for (const s_exchange &request : found->second) {
+                shard->stats[request.command].unanswered++;
+            }
+            requests.erase(found);
+        }
+    };
+    reassemble_packets(*capture, reassembly, shard->packets);
+    std::vector<s_packet>().swap(shard->packets);
+    shard->gaps = reassembly.gaps;
+}
+
+void complete_message(s_shard &shard, std::deque<s_exchange> &requests, bool to_server, const s_direction &dir, uint64_t time) {
+    bool whole = dir.message_size <= ANALYZER_MAX_PARSED, malformed = false;
+
+    if (to_server) {
+        int command = request_command(dir.message, whole, malformed);
+        s_command_stats &stats = shard.stats[command];
+        stats.requests++;
+        stats.request_bytes += dir.message_size;
+        stats.malformed += malformed;
+        requests.push_back({command, time, dir.message_size});
+        return;
+    }
+
+    //* replies are matched to the requests in order
+    if (requests.empty()) {
+        shard.unmatched++;
+        return;
+    }
+    s_exchange request = requests.front();
+    requests.pop_front();
+    s_command_stats &stats = shard.stats[request.command];
+    if (reply_ok(dir.message, whole, malformed)) {
+        stats.ok++;
+    } else if (!malformed) {
+        stats.err++;
+    }
+    stats.malformed += malformed;
+    stats.reply_bytes += dir.message_size;
+    stats.max_reply = std::max<uint64_t>(stats.max_reply, dir.message_size);
+    histogram_record(stats.latency, time > request.time ? time - request.time : 0);
+}
+
+int request_command(std::string_view message, bool whole, bool &malformed) {
+    s_request parsed;
+    std::string_view command;
+
+    if (whole) {
+        malformed = parse_request(message, parsed) != 0;
+        command = parsed.command;
+    } else {
+        command = first_word(message);
+        malformed = command.empty();
+    }
+    for (int i = 0; i < ANALYZER_COMMANDS - 1; i++) {
+        if (command == analyzer_commands[i]) {
+            return i;
+        }
+    }
+    return ANALYZER_COMMANDS - 1;
+}
+
+bool reply_ok(std::string_view message, bool whole, bool &malformed) {
+    s_reply reply;
+
+    if (whole) {
+        malformed = parse_response(message, reply) != 0;
+        return !malformed && reply.ok;
+    }
+    std::string_view state = first_word(message);
+    malformed = state != "ok" && state != "err";
+    return state == "ok";
+}
+
+std::string_view first_word(std::string_view message) {
+    size_t start = message.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos || message[start] != '(') {
+        return std::string_view();
+    }
+    size_t end = message.find_first_of(" \t\r\n()\"", start + 1);
+    return message.substr(start + 1, end == std::string_view::npos ? std::string_view::npos : end - start - 1);
+}
+
+void print_text(const std::vector<s_command_stats> &stats, uint64_t packets, uint32_t streams, uint64_t unmatched, uint64_t gaps, double elapsed) {
+    printf("%s: %lu packets, %u connections, %.3f s of traffic\n", analyzer_args.file.c_str(), packets, streams, elapsed);
+    printf("%-9s %9s %9s %7s %7s %7s %10s %10s %9s %9s %9s %9s %9s %9s\n", "command", "count", "ok", "err", "no rep", "malform",
+        "req B", "reply B", "mean ms", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_command_stats &s = stats[i];
+        const s_histogram &h = s.latency;
+        if (s.requests == 0 && i < ANALYZER_COMMANDS) {
+            continue;
+        }
+        printf("%-9s %9lu %9lu %7lu %7lu %7lu %10.1f %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+            i < ANALYZER_COMMANDS ? analyzer_commands[i] : "total", s.requests, s.ok, s.err, s.unanswered, s.malformed,
+            s.requests ? (double)s.request_bytes / s.requests : 0, h.total ? (double)s.reply_bytes / h.total : 0,
+            h.total ? h.sum / h.total / 1000 : 0, histogram_percentile(h, 50) / 1000.0, histogram_percentile(h, 90) / 1000.0,
+            histogram_percentile(h, 99) / 1000.0, histogram_percentile(h, 99.9) / 1000.0, h.total ? h.max / 1000.0 : 0);
+    }
+    if (unmatched > 0 || gaps > 0) {
+        printf("%lu replies without a request, %lu segments missing from the capture\n", unmatched, gaps);
+    }
+
+    if (!analyzer_args.histogram) {
+        return;
+    }
+    //* percentile distribution, the steps halve towards the maximum as in HdrHistogram
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_histogram &h = stats[i].latency;
+        if (h.total == 0) {
+            continue;
+        }
+        printf("\n%s\n%12s %14s %10s %14s\n", i < ANALYZER_COMMANDS ? analyzer_commands[i] : "total", "Value (ms)", "Percentile", "TotalCount", "1/(1-Percentile)");
+        for (int half = 0; ; half++) {
+            double remaining = std::pow(0.5, half);
+            bool last = remaining * h.total < 1;
+            for (int tick = 0; tick < 5 && !last; tick++) {
+                double percentile = 1 - remaining * (1 - tick / 10.0);
+                uint64_t value = histogram_percentile(h, percentile * 100);
+                printf("%12.3f %14.12f %10lu %14.2f\n", value / 1000.0, percentile, (uint64_t)std::ceil(percentile * h.total), 1 / (1 - percentile));
+            }
+            if (last) {
+                printf("%12.3f %14.12f %10lu %14s\n", h.max / 1000.0, 1.0, h.total, "inf");
+                break;
+            }
+        }
+        printf("#[Mean = %.3f, Max = %.3f, Total count = %lu]\n", h.sum / h.total / 1000, h.max / 1000.0, h.total);
+    }
+}
+
+void print_json(const std::vector<s_command_stats> &stats, uint64_t packets, uint32_t streams, uint64_t unmatched, uint64_t gaps, double elapsed) {
+    printf("{\"file\":\"%s\",\"packets\":%lu,\"connections\":%u,\"elapsed_s\":%.6f,\"unmatched_replies\":%lu,\"missing_segments\":%lu,\"commands\":{",
+        char_to_escaped(analyzer_args.file).c_str(), packets, streams, elapsed, unmatched, gaps);
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_command_stats &s = stats[i];
+        const s_histogram &h = s.latency;
+        if (i == ANALYZER_COMMANDS) {
+            printf("},\"total\":");
+        } else {
+            printf("%s\"%s\":", i > 0 ? "," : "", analyzer_commands[i]);
+        }
+        printf("{\"count\":%lu,\"ok\":%lu,\"err\":%lu,\"unanswered\":%lu,\"malformed\":%lu,", s.requests, s.ok, s.err, s.unanswered, s.malformed);
+        printf("\"request_bytes\":%lu,\"reply_bytes\":%lu,\"max_reply_bytes\":%lu,", s.request_bytes, s.reply_bytes, s.max_reply);
+        printf("\"latency_us\":{\"min\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu},",
+            h.total ? h.min : 0, h.total ? h.sum / h.total : 0, histogram_percentile(h, 50), histogram_percentile(h, 90),
+            histogram_percentile(h, 99), histogram_percentile(h, 99.9), h.max);
+        //* non-empty buckets as [highest equivalent value, count]
+        printf("\"histogram\":[");
+        bool first = true;
+        for (size_t j = 0; j < h.counts.size(); j++) {
+            if (h.counts[j] > 0) {
+                printf("%s[%lu,%lu]", first ? "" : ",", histogram_value(j), h.counts[j]);
+                first = false;
+            }
+        }
+        printf("]}");
+    }
+    printf("}\n");
+}
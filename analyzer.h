@@ -0,0 +1,137 @@
+/**
+ * @file analyzer.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - offline analyzer of captured protocol traffic, header.
+ *
+ **/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <algorithm>
+#include <getopt.h>
+#include <sys/mman.h>
+#include "capture.h"
+#include "histogram.h"
+
+#define ANALYZER_COMMANDS 7 // register, login, list, send, fetch, logout, other
+#define ANALYZER_MAX_PARSED 65536 // larger messages are only classified by their beginning, not parsed whole
+
+const char *const analyzer_commands[ANALYZER_COMMANDS] = {"register", "login", "list", "send", "fetch", "logout", "other"};
+
+struct s_analyzer_args {
+    uint16_t port = 32323; // server port, the traffic is told apart by it
+    int threads = 0; // analyzing threads, number of cores if 0
+    bool json = false; // print the report as JSON
+    bool histogram = false; // print the percentile distribution of each command
+    std::string file = ""; // pcap file
+} analyzer_args;
+
+struct s_exchange {
+    int command; // index in analyzer_commands
+    uint64_t time; // time the request was completed
+    size_t size; // bytes of the request
+};
+
+struct s_command_stats {
+    s_histogram latency; // request to reply, microseconds
+    uint64_t requests = 0;
+    uint64_t ok = 0; // ok replies
+    uint64_t err = 0; // err replies
+    uint64_t unanswered = 0; // no reply until the end of the capture
+    uint64_t malformed = 0; // the request or the reply could not be parsed
+    uint64_t request_bytes = 0;
+    uint64_t reply_bytes = 0;
+    uint64_t max_reply = 0; // largest reply
+};
+
+struct s_shard {
+    std::vector<s_packet> packets; // packets of the streams of the shard, in capture order
+    std::vector<s_command_stats> stats; // one per command
+    uint64_t unmatched = 0; // replies without a request
+    uint64_t gaps = 0; // segments missing from the capture
+};
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+void parseargs(int argc, char** argv);
+
+/**
+ * Print help.
+ */
+void p_help();
+
+/**
+ * Reassemble the streams of a shard and collect the statistics of their messages.
+ * @param capture Capture state.
+ * @param shard Shard.
+ */
+void analyze_shard(const s_capture *capture, s_shard *shard);
+
+/**
+ * Record a complete request or reply.
+ * @param shard Shard.
+ * @param requests Requests of the connection waiting for the reply.
+ * @param to_server True for a request, false for a reply.
+ * @param dir Direction with the message.
+ * @param time Capture time of the segment completing the message.
+ */
+void complete_message(s_shard &shard, std::deque<s_exchange> &requests, bool to_server, const s_direction &dir, uint64_t time);
+
+/**
+ * Get the command of a request.
+ * @param message Whole request, or its beginning.
+ * @param whole True if the message is whole and can be parsed.
+ * @param malformed Set to true if the request cannot be parsed.
+ * @return Index in analyzer_commands.
+ */
+int request_command(std::string_view message, bool whole, bool &malformed);
+
+/**
+ * Get the state of a reply.
+ * @param message Whole reply, or its beginning.
+ * @param whole True if the message is whole and can be parsed.
+ * @param malformed Set to true if the reply cannot be parsed.
+ * @return True for an ok reply.
+ */
+bool reply_ok(std::string_view message, bool whole, bool &malformed);
+
+/**
+ * Get the first word after the opening parenthesis.
+ * @param message Message or its beginning.
+ * @return Word, empty if the message does not start with a parenthesis.
+ */
+std::string_view first_word(std::string_view message);
+
+/**
+ * Print the report as a text table.
+ * @param stats Statistics of all commands, the last one is the total.
+ * @param packets Number of packets in the capture.
+ * @param streams Number of TCP connections.
+ * @param unmatched Replies without a request.
+ * @param gaps Segments missing from the capture.
+ * @param elapsed Seconds from the first to the last packet of the protocol.
+ */
+void print_text(const std::vector<s_command_stats> &stats, uint64_t packets, uint32_t streams, uint64_t unmatched, uint64_t gaps, double elapsed);
+
+/**
+ * Print the report as JSON.
+ * @param stats Statistics of all commands, the last one is the total.
+ * @param packets Number of packets in the capture.
+ * @param streams Number of TCP connections.
+ * @param unmatched Replies without a request.
+ * @param gaps Segments missing from the capture.
+ * @param elapsed Seconds from the first to the last packet of the protocol.
+ */
+void print_json(const std::vector<s_command_stats> &stats, uint64_t packets, uint32_t streams, uint64_t unmatched, uint64_t gaps, double elapsed);
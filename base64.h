@@ -27,120 +27,338 @@
  */
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BASE64_X86 1
+#include <immintrin.h>
+#endif
 
 namespace encoding {
 
+/**
+ * Base64 (RFC 4648) encoder and decoder.
+ * The SSE4.1 and AVX2 kernels follow the vectorized algorithms by W. Mula and D. Lemire
+ * (https://arxiv.org/abs/1704.00605), the best one supported by the CPU is selected at runtime.
+ */
 class Base64 {
  public:
 
-  static std::string Encode(const std::string data) {
-    static constexpr char sEncodingTable[] = {
-      'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
-      'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
-      'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
-      'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
-      'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
-      'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
-      'w', 'x', 'y', 'z', '0', '1', '2', '3',
-      '4', '5', '6', '7', '8', '9', '+', '/'
-    };
-
-    size_t in_len = data.size();
-    if (in_len == 0)
-      return "";
-
-    size_t out_len = 4 * ((in_len + 2) / 3);
-    std::string ret(out_len, '\0');
-    size_t i;
-    char *p = const_cast<char*>(ret.c_str());
-
-    if (in_len == 1) {
-      ret[0] = sEncodingTable[(data[0] >> 2) & 0x3F];
-      ret[1] = sEncodingTable[((data[0] & 0x3) << 4)];
-      ret[2] = '=';
-      ret[3] = '=';
-      return ret;
-    }
+  using EncodeKernel = size_t (*)(const char *in, size_t in_len, char *out);
+  using DecodeKernel = bool (*)(const char *in, size_t in_len, char *out);
+
+  static size_t EncodedLength(size_t in_len) {
+    return 4 * ((in_len + 2) / 3);
+  }
+
+  // Number of decoded bytes, or 0 if the input size is not a multiple of 4.
+  static size_t DecodedLength(std::string_view input) {
+    size_t in_len = input.size();
+    if (in_len == 0 || in_len % 4 != 0) return 0;
+    size_t out_len = in_len / 4 * 3;
+    if (input[in_len - 1] == '=') out_len--;
+    if (input[in_len - 2] == '=') out_len--;
+    return out_len;
+  }
+
+  // Encodes into a caller-supplied buffer of at least EncodedLength(data.size()) bytes.
+  static size_t Encode(std::string_view data, char *out) {
+    return Kernels().encode(data.data(), data.size(), out);
+  }
+
+  static std::string Encode(std::string_view data) {
+    std::string ret(EncodedLength(data.size()), '\0');
+    Encode(data, &ret[0]);
+    return ret;
+  }
+
+  // Decodes into a caller-supplied buffer of at least DecodedLength(input) bytes.
+  static bool Decode(std::string_view input, char *out, size_t *out_len) {
+    *out_len = 0;
+    if (input.size() % 4 != 0) return false;
+    if (!Kernels().decode(input.data(), input.size(), out)) return false;
+    *out_len = DecodedLength(input);
+    return true;
+  }
 
-    if (in_len == 2) {
-      ret[0] = sEncodingTable[(data[0] >> 2) & 0x3F];
-      ret[1] = sEncodingTable[((data[0] & 0x3) << 4) | ((int)(data[1] & 0xF0) >> 4)];
-      ret[2] = sEncodingTable[((data[1] & 0xF) << 2)];
-      ret[3] = '=';
-      return ret;
+  static std::string Decode(const std::string& input, std::string& out) {
+    if (input.size() % 4 != 0) return "Input data size is not a multiple of 4";
+    out.resize(DecodedLength(input));
+    size_t out_len;
+    if (!Decode(input, &out[0], &out_len)) {
+      out.clear();
+      return "Input data contains invalid characters";
     }
+    return "";
+  }
 
-    for (i = 0; i < in_len - 2; i += 3) {
-      *p++ = sEncodingTable[(data[i] >> 2) & 0x3F];
-      *p++ = sEncodingTable[((data[i] & 0x3) << 4) | ((int) (data[i + 1] & 0xF0) >> 4)];
-      *p++ = sEncodingTable[((data[i + 1] & 0xF) << 2) | ((int) (data[i + 2] & 0xC0) >> 6)];
-      *p++ = sEncodingTable[data[i + 2] & 0x3F];
+  // Name of the kernels selected for this CPU.
+  static const char *Implementation() {
+    return Kernels().name;
+  }
+
+  static size_t EncodeScalar(const char *in, size_t in_len, char *out) {
+    const unsigned char *data = reinterpret_cast<const unsigned char *>(in);
+    char *p = out;
+    size_t i = 0;
+
+    for (; i + 2 < in_len; i += 3) {
+      *p++ = kEncodingTable[data[i] >> 2];
+      *p++ = kEncodingTable[((data[i] & 0x3) << 4) | (data[i + 1] >> 4)];
+      *p++ = kEncodingTable[((data[i + 1] & 0xF) << 2) | (data[i + 2] >> 6)];
+      *p++ = kEncodingTable[data[i + 2] & 0x3F];
     }
     if (i < in_len) {
-      *p++ = sEncodingTable[(data[i] >> 2) & 0x3F];
+      *p++ = kEncodingTable[data[i] >> 2];
       if (i == (in_len - 1)) {
-        *p++ = sEncodingTable[((data[i] & 0x3) << 4)];
+        *p++ = kEncodingTable[((data[i] & 0x3) << 4)];
         *p++ = '=';
       }
       else {
-        *p++ = sEncodingTable[((data[i] & 0x3) << 4) | ((int) (data[i + 1] & 0xF0) >> 4)];
-        *p++ = sEncodingTable[((data[i + 1] & 0xF) << 2)];
+        *p++ = kEncodingTable[((data[i] & 0x3) << 4) | (data[i + 1] >> 4)];
+        *p++ = kEncodingTable[((data[i + 1] & 0xF) << 2)];
       }
       *p++ = '=';
     }
+    return p - out;
+  }
 
-    return ret;
+  static bool DecodeScalar(const char *in, size_t in_len, char *out) {
+    const unsigned char *input = reinterpret_cast<const unsigned char *>(in);
+
+    for (size_t i = 0, j = 0; i < in_len; i += 4) {
+      // padding is allowed only in the last two characters
+      bool last = i + 4 == in_len;
+      size_t pad = 0;
+      if (last && input[i + 3] == '=') pad = input[i + 2] == '=' ? 2 : 1;
+
+      uint32_t a = kDecodingTable[input[i]];
+      uint32_t b = kDecodingTable[input[i + 1]];
+      uint32_t c = pad == 2 ? 0 : kDecodingTable[input[i + 2]];
+      uint32_t d = pad >= 1 ? 0 : kDecodingTable[input[i + 3]];
+      if ((a | b | c | d) & 64) return false;
+
+      uint32_t triple = (a << 3 * 6) + (b << 2 * 6) + (c << 1 * 6) + (d << 0 * 6);
+
+      out[j++] = (triple >> 2 * 8) & 0xFF;
+      if (pad < 2) out[j++] = (triple >> 1 * 8) & 0xFF;
+      if (pad < 1) out[j++] = (triple >> 0 * 8) & 0xFF;
+    }
+    return true;
   }
 
-  static std::string Decode(const std::string& input, std::string& out) {
-    static constexpr unsigned char kDecodingTable[] = {
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
-      52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64,
-      64,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-      15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 64, 64, 64, 64, 64,
-      64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-      41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64
-    };
+#ifdef BASE64_X86
+  __attribute__((target("sse4.1")))
+  static size_t EncodeSSE41(const char *in, size_t in_len, char *out) {
+    size_t i = 0, o = 0;
 
-    size_t in_len = input.size();
-    if (in_len % 4 != 0) return "Input data size is not a multiple of 4";
-    if (in_len == 0) {
-      out.clear();
-      return "";
+    // 12 input bytes -> 16 characters, the load reads 16 bytes
+    for (; i + 16 <= in_len; i += 12, o += 16) {
+      __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), EncTranslate128(EncReshuffle128(data)));
     }
+    return o + EncodeScalar(in + i, in_len - i, out + o);
+  }
 
-    size_t out_len = in_len / 4 * 3;
-    if (input[in_len - 1] == '=') out_len--;
-    if (input[in_len - 2] == '=') out_len--;
+  __attribute__((target("sse4.1")))
+  static bool DecodeSSE41(const char *in, size_t in_len, char *out) {
+    size_t i = 0, o = 0;
 
-    out.resize(out_len);
+    // 16 characters -> 12 bytes, the store writes 16 bytes; padding is left to the scalar tail
+    for (; i + 24 <= in_len; i += 16, o += 12) {
+      __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+      if (!DecTranslate128(str)) return false;
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o), DecReshuffle128(str));
+    }
+    return DecodeScalar(in + i, in_len - i, out + o);
+  }
 
-    for (size_t i = 0, j = 0; i < in_len;) {
-      uint32_t a = input[i] == '=' ? 0 & i++ : kDecodingTable[static_cast<int>(input[i++])];
-      uint32_t b = input[i] == '=' ? 0 & i++ : kDecodingTable[static_cast<int>(input[i++])];
-      uint32_t c = input[i] == '=' ? 0 & i++ : kDecodingTable[static_cast<int>(input[i++])];
-      uint32_t d = input[i] == '=' ? 0 & i++ : kDecodingTable[static_cast<int>(input[i++])];
+  __attribute__((target("avx2")))
+  static size_t EncodeAVX2(const char *in, size_t in_len, char *out) {
+    size_t i = 0, o = 0;
 
-      uint32_t triple = (a << 3 * 6) + (b << 2 * 6) + (c << 1 * 6) + (d << 0 * 6);
+    // 24 input bytes -> 32 characters, 12 bytes per 128-bit lane, the loads read 28 bytes
+    for (; i + 28 <= in_len; i += 24, o += 32) {
+      __m256i data = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i + 12)), 1);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o), EncTranslate256(EncReshuffle256(data)));
+    }
+    return o + EncodeSSE41(in + i, in_len - i, out + o);
+  }
 
-      if (j < out_len) out[j++] = (triple >> 2 * 8) & 0xFF;
-      if (j < out_len) out[j++] = (triple >> 1 * 8) & 0xFF;
-      if (j < out_len) out[j++] = (triple >> 0 * 8) & 0xFF;
+  __attribute__((target("avx2")))
+  static bool DecodeAVX2(const char *in, size_t in_len, char *out) {
+    size_t i = 0, o = 0;
+
+    // 32 characters -> 24 bytes, the store writes 32 bytes; padding is left to the tail
+    for (; i + 48 <= in_len; i += 32, o += 24) {
+      __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+      if (!DecTranslate256(str)) return false;
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o), DecReshuffle256(str));
     }
+    return DecodeSSE41(in + i, in_len - i, out + o);
+  }
+#endif
 
-    return "";
+ private:
+
+  struct KernelSet {
+    EncodeKernel encode;
+    DecodeKernel decode;
+    const char *name;
+  };
+
+  static const KernelSet &Kernels() {
+    static const KernelSet kernels = SelectKernels();
+    return kernels;
+  }
+
+  static KernelSet SelectKernels() {
+#ifdef BASE64_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {EncodeAVX2, DecodeAVX2, "avx2"};
+    if (__builtin_cpu_supports("sse4.1")) return {EncodeSSE41, DecodeSSE41, "sse4.1"};
+#endif
+    return {EncodeScalar, DecodeScalar, "scalar"};
+  }
+
+#ifdef BASE64_X86
+  // Spreads 3 bytes to 4 bytes holding one 6-bit index each.
+  __attribute__((target("sse4.1")))
+  static __m128i EncReshuffle128(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
   }
 
+  // Maps 6-bit indices to characters by adding a per-range offset.
+  __attribute__((target("sse4.1")))
+  static __m128i EncTranslate128(__m128i in) {
+    const __m128i lut = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m128i indices = _mm_subs_epu8(in, _mm_set1_epi8(51));
+    indices = _mm_sub_epi8(indices, _mm_cmpgt_epi8(in, _mm_set1_epi8(25)));
+    return _mm_add_epi8(in, _mm_shuffle_epi8(lut, indices));
+  }
+
+  // Maps characters to 6-bit values, returns false if any character is not in the alphabet.
+  __attribute__((target("sse4.1")))
+  static bool DecTranslate128(__m128i &str) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+    const __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+    const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+    const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm_testz_si128(lo, hi)) return false;
+    const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+    str = _mm_add_epi8(str, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles)));
+    return true;
+  }
+
+  // Packs 4 6-bit values to 3 bytes, 12 valid bytes at the start of the result.
+  __attribute__((target("sse4.1")))
+  static __m128i DecReshuffle128(__m128i in) {
+    const __m128i merge_ab_and_bc = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    const __m128i out = _mm_madd_epi16(merge_ab_and_bc, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  }
+
+  __attribute__((target("avx2")))
+  static __m256i EncReshuffle256(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                                 10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+  }
+
+  __attribute__((target("avx2")))
+  static __m256i EncTranslate256(__m256i in) {
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0,
+                                         65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+    __m256i indices = _mm256_subs_epu8(in, _mm256_set1_epi8(51));
+    indices = _mm256_sub_epi8(indices, _mm256_cmpgt_epi8(in, _mm256_set1_epi8(25)));
+    return _mm256_add_epi8(in, _mm256_shuffle_epi8(lut, indices));
+  }
+
+  __attribute__((target("avx2")))
+  static bool DecTranslate256(__m256i &str) {
+    const __m256i lut_lo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+
+    const __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) return false;
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    str = _mm256_add_epi8(str, _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles)));
+    return true;
+  }
+
+  // 12 valid bytes per lane are packed to the low 24 bytes.
+  __attribute__((target("avx2")))
+  static __m256i DecReshuffle256(__m256i in) {
+    const __m256i merge_ab_and_bc = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+    __m256i out = _mm256_madd_epi16(merge_ab_and_bc, _mm256_set1_epi32(0x00011000));
+    out = _mm256_shuffle_epi8(out, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                    2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    return _mm256_permutevar8x32_epi32(out, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+  }
+#endif
+
+  static constexpr char kEncodingTable[] = {
+    'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H',
+    'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
+    'Q', 'R', 'S', 'T', 'U', 'V', 'W', 'X',
+    'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f',
+    'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n',
+    'o', 'p', 'q', 'r', 's', 't', 'u', 'v',
+    'w', 'x', 'y', 'z', '0', '1', '2', '3',
+    '4', '5', '6', '7', '8', '9', '+', '/'
+  };
+
+  static constexpr unsigned char kDecodingTable[] = {
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64,
+    64,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 64, 64, 64, 64, 64,
+    64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
+    64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64
+  };
+
 };
 
 }
@@ -0,0 +1,125 @@
+/**
+ * @file base64_bench.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - Base64 encoder/decoder benchmark.
+ * 
+ * usage: base64_bench [<max size>]
+ * Compares the original table loop with the scalar, SSE4.1 and AVX2 kernels
+ * on inputs from 16 B up to 64 MB (or the given size in bytes).
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include "base64.h"
+
+using encoding::Base64;
+
+/**
+ * The original encoder (input taken by value, output written through c_str()), kept for comparison.
+ * @param data Input data.
+ * @return Encoded string.
+ */
+static std::string legacy_encode(const std::string data) {
+    static constexpr char sEncodingTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t in_len = data.size();
+    if (in_len == 0)
+        return "";
+    size_t out_len = 4 * ((in_len + 2) / 3);
+    std::string ret(out_len, '\0');
+    size_t i;
+    char *p = const_cast<char*>(ret.c_str());
+    if (in_len < 3)
+        return Base64::Encode(data);
+    for (i = 0; i < in_len - 2; i += 3) {
+        *p++ = sEncodingTable[(data[i] >> 2) & 0x3F];
+        *p++ = sEncodingTable[((data[i] & 0x3) << 4) | ((int) (data[i + 1] & 0xF0) >> 4)];
+        *p++ = sEncodingTable[((data[i + 1] & 0xF) << 2) | ((int) (data[i + 2] & 0xC0) >> 6)];
+        *p++ = sEncodingTable[data[i + 2] & 0x3F];
+    }
+    if (i < in_len) {
+        *p++ = sEncodingTable[(data[i] >> 2) & 0x3F];
+        if (i == (in_len - 1)) {
+            *p++ = sEncodingTable[((data[i] & 0x3) << 4)];
+            *p++ = '=';
+        } else {
+            *p++ = sEncodingTable[((data[i] & 0x3) << 4) | ((int) (data[i + 1] & 0xF0) >> 4)];
+            *p++ = sEncodingTable[((data[i + 1] & 0xF) << 2)];
+        }
+        *p++ = '=';
+    }
+    return ret;
+}
+
+/**
+ * Run the function repeatedly and measure its throughput.
+ * @param bytes Number of input bytes processed by one call.
+ * @param fn Measured function.
+ * @return Throughput in MB/s.
+ */
+template <typename F>
+static double throughput(size_t bytes, F fn) {
+    //* about 256 MB of input per measurement, at least 3 calls
+    size_t reps = std::max<size_t>(3, (256u << 20) / bytes);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < reps; i++) {
+        fn();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)bytes * reps / elapsed.count() / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    size_t max_size = argc > 1 ? strtoull(argv[1], NULL, 10) : 64u << 20;
+    std::mt19937 rng(42);
+    volatile size_t sink = 0;
+
+    printf("dispatch: %s\n", Base64::Implementation());
+    printf("%10s | %9s %9s %9s %9s %9s | %9s %9s %9s %9s  (MB/s)\n", "size",
+           "legacy", "scalar", "sse4.1", "avx2", "Encode", "scalar", "sse4.1", "avx2", "Decode");
+
+    for (size_t size = 16; size <= max_size; size *= 4) {
+        std::string input(size, '\0');
+        for (auto &c : input) {
+            c = (char)rng();
+        }
+        std::string encoded(Base64::EncodedLength(size), '\0');
+        std::string decoded(size, '\0');
+        Base64::EncodeScalar(input.data(), size, &encoded[0]);
+        size_t decoded_len;
+
+        double enc_legacy = throughput(size, [&] { sink += legacy_encode(input).size(); });
+        double enc_scalar = throughput(size, [&] { sink += Base64::EncodeScalar(input.data(), size, &encoded[0]); });
+#ifdef BASE64_X86
+        double enc_sse = throughput(size, [&] { sink += Base64::EncodeSSE41(input.data(), size, &encoded[0]); });
+        double enc_avx = __builtin_cpu_supports("avx2") ?
+            throughput(size, [&] { sink += Base64::EncodeAVX2(input.data(), size, &encoded[0]); }) : 0;
+#else
+        double enc_sse = 0, enc_avx = 0;
+#endif
+        double enc_api = throughput(size, [&] { sink += Base64::Encode(input, &encoded[0]); });
+
+        double dec_scalar = throughput(encoded.size(), [&] { sink += Base64::DecodeScalar(encoded.data(), encoded.size(), &decoded[0]); });
+#ifdef BASE64_X86
+        double dec_sse = throughput(encoded.size(), [&] { sink += Base64::DecodeSSE41(encoded.data(), encoded.size(), &decoded[0]); });
+        double dec_avx = __builtin_cpu_supports("avx2") ?
+            throughput(encoded.size(), [&] { sink += Base64::DecodeAVX2(encoded.data(), encoded.size(), &decoded[0]); }) : 0;
+#else
+        double dec_sse = 0, dec_avx = 0;
+#endif
+        double dec_api = throughput(encoded.size(), [&] { sink += Base64::Decode(encoded, &decoded[0], &decoded_len); });
+
+        //! all implementations must agree
+        if (legacy_encode(input) != encoded || !Base64::Decode(encoded, &decoded[0], &decoded_len) || decoded != input) {
+            fprintf(stderr, "Mismatch at size %zu.\n", size);
+            return 1;
+        }
+
+        printf("%10zu | %9.0f %9.0f %9.0f %9.0f %9.0f | %9.0f %9.0f %9.0f %9.0f\n", size,
+               enc_legacy, enc_scalar, enc_sse, enc_avx, enc_api, dec_scalar, dec_sse, dec_avx, dec_api);
+    }
+    return 0;
+}
@@ -0,0 +1,304 @@
+/**
+ * @file cache.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - on-disk cache of fetched messages.
+ *
+ * Fetched messages never change, so they are kept per server and user in two files:
+ *  messages.dat - append-only records: sender, subject and body lengths (3 x uint32), then the fields
+ *  messages.idx - fixed-width entries (offset, length, checksum) indexed by message id
+ *  sync.state   - fingerprints (uint32) of the listed messages seen by the last sync, in order
+ * The resolved addresses of each server are kept apart from the messages, in addresses/<server>:
+ * the expiry time (int64, seconds since the epoch), then the addresses (uint32 length and the sockaddr).
+ * It is replaced at once by renaming, so readers never see it partly written.
+ * The message files are mapped on open. Writers append under an exclusive lock, readers check the
+ * checksum, so a record being written by another process is seen as not cached.
+ */
+
+#include "cache.h"
+
+std::string cache_path(std::string base, std::string server, std::string user) {
+    if (base == "") {
+        const char *xdg = getenv("XDG_CACHE_HOME");
+        const char *home = getenv("HOME");
+        if (xdg != NULL && xdg[0] != '\0') {
+            base = std::string(xdg) + "/isa-client";
+        } else if (home != NULL && home[0] != '\0') {
+            base = std::string(home) + "/.cache/isa-client";
+        } else {
+            base = ".isa-cache";
+        }
+    }
+    //* server and user names are kept readable, other characters are hex encoded
+    std::string path = base;
+    for (std::string part : {server, user}) {
+        path += "/";
+        for (unsigned char c : part) {
+            if (isalnum(c) || c == '.' || c == '-' || c == '_') {
+                path += c;
+            } else {
+                char hex[4];
+                snprintf(hex, sizeof hex, "%%%02X", c);
+                path += hex;
+            }
+        }
+    }
+    return path;
+}
+
+int cache_mkdir(std::string dir) {
+    //* create the directories one by one
+    for (size_t slash = dir.find('/', 1); ; slash = dir.find('/', slash + 1)) {
+        std::string part = dir.substr(0, slash);
+        if (mkdir(part.c_str(), 0700) == -1 && errno != EEXIST) {
+            perror("Error while creating the cache directory");
+            return 1;
+        }
+        if (slash == std::string::npos) {
+            break;
+        }
+    }
+    return 0;
+}
+
+int cache_open(s_cache &cache, std::string dir) {
+    if (cache_mkdir(dir) != 0) {
+        return 1;
+    }
+
+    cache.data_fd = open((dir + "/messages.dat").c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+    cache.index_fd = open((dir + "/messages.idx").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (cache.data_fd == -1 || cache.index_fd == -1) {
+        perror("Error while opening the cache");
+        cache_close(cache);
+        return 1;
+    }
+    cache_map(cache.data_fd, cache.data, cache.data_size);
+    cache_map(cache.index_fd, cache.index, cache.index_size);
+    cache.dir = dir;
+    return 0;
+}
+
+void cache_close(s_cache &cache) {
+    if (cache.data != NULL) {
+        munmap((void *)cache.data, cache.data_size);
+    }
+    if (cache.index != NULL) {
+        munmap((void *)cache.index, cache.index_size);
+    }
+    if (cache.data_fd != -1) {
+        close(cache.data_fd);
+    }
+    if (cache.index_fd != -1) {
+        close(cache.index_fd);
+    }
+    cache = s_cache();
+}
+
+int cache_get(s_cache &cache, long id, s_cached_message &message) {
+    s_cache_entry entry;
+    size_t position = (size_t)(id - 1) * sizeof entry;
+
+    if (cache.index_fd == -1 || id < 1 || id > CACHE_MAX_ID) {
+        return 1;
+    }
+    //* the files may have grown since they were mapped
+    if (position + sizeof entry > cache.index_size) {
+        cache_map(cache.index_fd, cache.index, cache.index_size);
+        if (position + sizeof entry > cache.index_size) {
+            return 1;
+        }
+    }
+    memcpy(&entry, cache.index + position, sizeof entry);
+    if (entry.offset == 0 || entry.length < 12) {
+        return 1;
+    }
+    if (entry.offset - 1 + entry.length > cache.data_size) {
+        cache_map(cache.data_fd, cache.data, cache.data_size);
+        if (entry.offset - 1 + entry.length > cache.data_size) {
+            return 1;
+        }
+    }
+
+    //! record damaged or being written
+    const char *record = cache.data + entry.offset - 1;
+    if (cache_checksum(record, entry.length) != entry.checksum) {
+        return 1;
+    }
+    uint32_t lengths[3];
+    memcpy(lengths, record, sizeof lengths);
+    if ((uint64_t)lengths[0] + lengths[1] + lengths[2] + sizeof lengths != entry.length) {
+        return 1;
+    }
+    const char *field = record + sizeof lengths;
+    message.sender = std::string_view(field, lengths[0]);
+    message.subject = std::string_view(field + lengths[0], lengths[1]);
+    message.body = std::string_view(field + lengths[0] + lengths[1], lengths[2]);
+    return 0;
+}
+
+int cache_put(s_cache &cache, long id, std::string_view sender, std::string_view subject, std::string_view body) {
+    s_cache_entry entry;
+    struct stat st;
+
+    if (cache.data_fd == -1 || id < 1 || id > CACHE_MAX_ID || sender.size() + subject.size() + body.size() > CACHE_MAX_RECORD) {
+        return 1;
+    }
+    uint32_t lengths[3] = {(uint32_t)sender.size(), (uint32_t)subject.size(), (uint32_t)body.size()};
+    std::string record((const char *)lengths, sizeof lengths);
+    record.append(sender);
+    record.append(subject);
+    record.append(body);
+
+    //* other clients may append at the same time, the record offset is known under the lock
+    if (flock(cache.data_fd, LOCK_EX) == -1) {
+        return 1;
+    }
+    int rv = 1;
+    if (fstat(cache.data_fd, &st) == 0 && write(cache.data_fd, record.data(), record.size()) == (ssize_t)record.size()) {
+        entry.offset = st.st_size + 1;
+        entry.length = record.size();
+        entry.checksum = cache_checksum(record.data(), record.size());
+        if (pwrite(cache.index_fd, &entry, sizeof entry, (off_t)(id - 1) * sizeof entry) == sizeof entry) {
+            rv = 0;
+        }
+    }
+    flock(cache.data_fd, LOCK_UN);
+    if (rv != 0) {
+        perror("Error while writing the cache");
+    }
+    return rv;
+}
+
+int cache_sync_load(s_cache &cache, std::vector<uint32_t> &fingerprints) {
+    struct stat st;
+
+    fingerprints.clear();
+    int fd = open((cache.dir + "/sync.state").c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return errno == ENOENT ? 0 : 1;
+    }
+    //* a partly written fingerprint is ignored, it is written again by the next sync
+    if (fstat(fd, &st) == 0) {
+        fingerprints.resize(st.st_size / sizeof(uint32_t));
+        size_t len = fingerprints.size() * sizeof(uint32_t);
+        if (pread(fd, fingerprints.data(), len, 0) != (ssize_t)len) {
+            fingerprints.clear();
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+int cache_sync_save(s_cache &cache, const std::vector<uint32_t> &fingerprints, size_t from) {
+    int fd = open((cache.dir + "/sync.state").c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    if (fd == -1) {
+        perror("Error while saving the sync state");
+        return 1;
+    }
+    //* the unchanged start is kept, only the new fingerprints are written
+    size_t len = (fingerprints.size() - from) * sizeof(uint32_t);
+    int rv = 1;
+    if (flock(fd, LOCK_EX) == 0 && ftruncate(fd, from * sizeof(uint32_t)) == 0
+            && pwrite(fd, fingerprints.data() + from, len, from * sizeof(uint32_t)) == (ssize_t)len) {
+        rv = 0;
+    }
+    if (rv != 0) {
+        perror("Error while saving the sync state");
+    }
+    close(fd);
+    return rv;
+}
+
+int cache_addresses_load(std::string path, std::vector<std::string> &addresses) {
+    int64_t expires;
+    uint32_t len;
+
+    addresses.clear();
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return 1;
+    }
+    std::string data;
+    char buf[1024];
+    ssize_t numbytes;
+    while ((numbytes = read(fd, buf, sizeof buf)) > 0) {
+        data.append(buf, numbytes);
+    }
+    close(fd);
+
+    //! expired, or damaged by a crash before the rename
+    if (data.size() < sizeof expires || (memcpy(&expires, data.data(), sizeof expires), expires <= (int64_t)time(NULL))) {
+        return 1;
+    }
+    for (size_t position = sizeof expires; position < data.size(); position += sizeof len + len) {
+        if (data.size() - position < sizeof len) {
+            return 1;
+        }
+        memcpy(&len, data.data() + position, sizeof len);
+        if (len == 0 || data.size() - position - sizeof len < len) {
+            return 1;
+        }
+        addresses.push_back(data.substr(position + sizeof len, len));
+    }
+    return addresses.empty() ? 1 : 0;
+}
+
+int cache_addresses_save(std::string path, const std::vector<std::string> &addresses, int ttl) {
+    int64_t expires = (int64_t)time(NULL) + ttl;
+    std::string data((const char *)&expires, sizeof expires);
+
+    for (const std::string &address : addresses) {
+        uint32_t len = address.size();
+        data.append((const char *)&len, sizeof len);
+        data += address;
+    }
+    if (cache_mkdir(path.substr(0, path.rfind('/'))) != 0) {
+        return 1;
+    }
+    //* written next to the file and renamed over it
+    std::string tmp = path + "." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd == -1 || write(fd, data.data(), data.size()) != (ssize_t)data.size() || close(fd) != 0
+            || rename(tmp.c_str(), path.c_str()) != 0) {
+        perror("Error while saving the server addresses");
+        unlink(tmp.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t cache_fingerprint(std::string_view sender, std::string_view subject) {
+    std::string fields(sender);
+    fields += '\0';
+    fields.append(subject);
+    return cache_checksum(fields.data(), fields.size());
+}
+
+void cache_map(int fd, const char *&map, size_t &size) {
+    struct stat st;
+
+    if (map != NULL) {
+        munmap((void *)map, size);
+    }
+    map = NULL;
+    size = 0;
+    //* empty files cannot be mapped, they are seen as having no entries
+    if (fstat(fd, &st) == -1 || st.st_size == 0) {
+        return;
+    }
+    void *mapped = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped != MAP_FAILED) {
+        map = (const char *)mapped;
+        size = st.st_size;
+    }
+}
+
+uint32_t cache_checksum(const char *data, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file cache.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - on-disk cache of fetched messages, header.
+ *
+ **/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include <cstdint>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define CACHE_MAX_ID (1 << 24) // ids above are not cached, the index would grow too large
+#define CACHE_MAX_RECORD (1 << 20) // larger messages are not cached, they would be buffered while fetched
+
+struct s_cache_entry {
+    uint64_t offset; // offset of the record in the data file + 1, 0 if the message is not cached
+    uint32_t length; // length of the record
+    uint32_t checksum; // FNV-1a of the record
+};
+
+struct s_cache {
+    int data_fd = -1; // append-only records
+    int index_fd = -1; // fixed-width entries, entry of message id at (id - 1) * sizeof(s_cache_entry)
+    const char *data = NULL; // mapped data file
+    size_t data_size = 0;
+    const char *index = NULL; // mapped index file
+    size_t index_size = 0;
+    std::string dir = ""; // cache directory, also keeps the sync state
+};
+
+struct s_cached_message {
+    std::string_view sender; // fields point into the mapped data file
+    std::string_view subject;
+    std::string_view body;
+};
+
+/**
+ * Get the cache directory of the user on the server given by the program arguments.
+ * @param base Base directory, the default user cache directory if empty.
+ * @param server Server address and port.
+ * @param user Escaped user name.
+ * @return Cache directory.
+ */
+std::string cache_path(std::string base, std::string server, std::string user);
+
+/**
+ * Create a directory and its missing parents.
+ * @param dir Directory.
+ * @return 1 if an error occurs, else 0.
+ */
+int cache_mkdir(std::string dir);
+
+/**
+ * Open the cache, the directory and the files are created if missing.
+ * @param cache Cache state.
+ * @param dir Cache directory.
+ * @return 1 if an error occurs, else 0.
+ */
+int cache_open(s_cache &cache, std::string dir);
+
+/**
+ * Unmap and close the cache files.
+ * @param cache Cache state.
+ */
+void cache_close(s_cache &cache);
+
+/**
+ * Look up a message, records appended since the files were mapped are found too.
+ * @param cache Cache state.
+ * @param id Message id.
+ * @param message Cached message, valid until the cache is closed or looked up again.
+ * @return 0 if the message is cached, else 1.
+ */
+int cache_get(s_cache &cache, long id, s_cached_message &message);
+
+/**
+ * Append a message to the data file and point its index entry to it.
+ * @param cache Cache state.
+ * @param id Message id.
+ * @param sender Unescaped sender.
+ * @param subject Unescaped subject.
+ * @param body Unescaped body.
+ * @return 1 if an error occurs, else 0.
+ */
+int cache_put(s_cache &cache, long id, std::string_view sender, std::string_view subject, std::string_view body);
+
+/**
+ * Read the fingerprints of the mailbox saved by the last sync.
+ * @param cache Cache state.
+ * @param fingerprints Fingerprint of each listed message in order, replaced.
+ * @return 1 if an error occurs, else 0 (also when no sync was done yet).
+ */
+int cache_sync_load(s_cache &cache, std::vector<uint32_t> &fingerprints);
+
+/**
+ * Save the fingerprints of the synced mailbox, only the ones from the given position are written.
+ * @param cache Cache state.
+ * @param fingerprints Fingerprint of each synced message in order.
+ * @param from Number of fingerprints already saved and unchanged.
+ * @return 1 if an error occurs, else 0.
+ */
+int cache_sync_save(s_cache &cache, const std::vector<uint32_t> &fingerprints, size_t from);
+
+/**
+ * Read the cached addresses of a server.
+ * @param path Address cache file.
+ * @param addresses Socket addresses in the order they are tried, replaced.
+ * @return 1 if the addresses are not cached or expired, else 0.
+ */
+int cache_addresses_load(std::string path, std::vector<std::string> &addresses);
+
+/**
+ * Cache the addresses of a server.
+ * @param path Address cache file.
+ * @param addresses Socket addresses in the order they are tried.
+ * @param ttl Seconds the addresses are used for.
+ * @return 1 if an error occurs, else 0.
+ */
+int cache_addresses_save(std::string path, const std::vector<std::string> &addresses, int ttl);
+
+/**
+ * Compute the fingerprint of a listed message.
+ * @param sender Unescaped sender.
+ * @param subject Unescaped subject.
+ * @return Fingerprint of the sender and subject.
+ */
+uint32_t cache_fingerprint(std::string_view sender, std::string_view subject);
+
+/**
+ * Map the current contents of a cache file.
+ * @param fd File descriptor.
+ * @param map Mapped file, replaced.
+ * @param size Mapped size, replaced.
+ */
+void cache_map(int fd, const char *&map, size_t &size);
+
+/**
+ * Compute the record checksum.
+ * @param data Record.
+ * @param len Length of the record.
+ * @return FNV-1a hash.
+ */
+uint32_t cache_checksum(const char *data, size_t len);
+
+#endif /* _CACHE_H_ */
@@ -0,0 +1,354 @@
+/**
+ * @file capture.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - reading captured protocol traffic.
+ *
+ * The pcap file is mapped and read without copying. One pass over the record headers decodes
+ * the link, IP and TCP headers and assigns the packets of the protocol to shards by their TCP
+ * connection, the shards can be reassembled in parallel. The reassembly trims retransmitted data,
+ * keeps out-of-order segments until the missing ones arrive (or skips them if the capture lost them),
+ * frames the messages of both directions and passes them on complete.
+ */
+
+#include "capture.h"
+
+/**
+ * Read a number in the byte order of the capture file.
+ */
+static uint32_t read32(const s_capture &capture, const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof value);
+    return capture.swapped ? __builtin_bswap32(value) : value;
+}
+
+/**
+ * Read a number in the network byte order.
+ */
+static uint16_t net16(const unsigned char *p) {
+    return p[0] << 8 | p[1];
+}
+
+static uint32_t net32(const unsigned char *p) {
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+int open_capture(s_capture &capture, std::string path) {
+    struct stat st;
+    uint32_t magic;
+
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        perror("Error while opening the capture");
+        if (fd != -1) {
+            close(fd);
+        }
+        return 1;
+    }
+    if (st.st_size < 24) {
+        fprintf(stderr, "The capture %s is not a pcap file.\n", path.c_str());
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error while mapping the capture");
+        return 1;
+    }
+    //* the packet headers are read in order first
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    capture.data = (const unsigned char *)map;
+    capture.size = st.st_size;
+
+    //* byte order and timestamp precision are given by the magic number
+    memcpy(&magic, capture.data, sizeof magic);
+    if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+        capture.swapped = false;
+    } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+        capture.swapped = true;
+    } else {
+        fprintf(stderr, magic == 0x0a0d0d0a ? "The capture %s is in the pcapng format, save it as pcap (e.g. editcap -F pcap).\n"
+            : "The capture %s is not a pcap file.\n", path.c_str());
+        munmap(map, capture.size);
+        return 1;
+    }
+    capture.nano = magic == 0xa1b23c4d || magic == 0x4d3cb2a1;
+    capture.linktype = read32(capture, capture.data + 20) & 0xffff;
+    return 0;
+}
+
+void close_capture(s_capture &capture) {
+    if (capture.data != NULL) {
+        munmap((void *)capture.data, capture.size);
+        capture.data = NULL;
+    }
+}
+
+uint64_t dispatch_packets(s_capture &capture, std::vector<std::vector<s_packet>> &shards, uint32_t &streams) {
+    std::unordered_map<std::string, uint32_t> connections; // connection key -> stream index
+    std::vector<bool> has_data; // the stream carried data, a new SYN starts a new stream
+    std::string key;
+    s_packet packet;
+    uint64_t count = 0;
+    size_t offset = 24;
+
+    //* record header: seconds, microseconds or nanoseconds, captured length, original length
+    while (offset + 16 <= capture.size) {
+        uint32_t caplen = read32(capture, capture.data + offset + 8);
+        if (offset + 16 + caplen > capture.size) {
+            fprintf(stderr, "The capture is truncated, the last packet is ignored.\n");
+            break;
+        }
+        uint64_t seconds = read32(capture, capture.data + offset);
+        uint32_t fraction = read32(capture, capture.data + offset + 4);
+        packet.time = seconds * 1000000 + (capture.nano ? fraction / 1000 : fraction);
+        count++;
+
+        if (decode_packet(capture, offset + 16, caplen, packet, key) == 0 && (packet.len > 0 || (packet.flags & 0x07))) {
+            auto found = connections.find(key);
+            bool syn = (packet.flags & 0x12) == 0x02;
+            //* a reused address and port pair starts a new connection with its SYN
+            if (found == connections.end() || (syn && has_data[found->second])) {
+                found = connections.insert_or_assign(key, (uint32_t)has_data.size()).first;
+                has_data.push_back(false);
+            }
+            packet.stream = found->second;
+            has_data[packet.stream] = has_data[packet.stream] || packet.len > 0;
+            shards[packet.stream % shards.size()].push_back(packet);
+            capture.first = std::min(capture.first, packet.time);
+            capture.last = std::max(capture.last, packet.time);
+        }
+        offset += 16 + caplen;
+    }
+    streams = has_data.size();
+    return count;
+}
+
+int decode_packet(const s_capture &capture, size_t offset, uint32_t caplen, s_packet &packet, std::string &key) {
+    const unsigned char *p = capture.data + offset;
+    size_t len = caplen, ip = 0, end;
+    uint16_t ethertype = 0;
+    int version;
+
+    //* link layer
+    switch (capture.linktype) {
+        case 1: // Ethernet, VLAN tags are skipped
+            ip = 14;
+            if (len < ip) {
+                return 1;
+            }
+            ethertype = net16(p + 12);
+            while ((ethertype == 0x8100 || ethertype == 0x88a8) && len >= ip + 4) {
+                ethertype = net16(p + ip + 2);
+                ip += 4;
+            }
+            break;
+        case 113: // Linux cooked capture
+            ip = 16;
+            if (len < ip) {
+                return 1;
+            }
+            ethertype = net16(p + 14);
+            break;
+        case 276: // Linux cooked capture v2
+            ip = 20;
+            if (len < ip) {
+                return 1;
+            }
+            ethertype = net16(p);
+            break;
+        case 0: // BSD loopback
+        case 108:
+            ip = 4;
+            break;
+        case 12: // raw IP
+        case 14:
+        case 101:
+            break;
+        default:
+            return 1;
+    }
+    if (len < ip + 20) {
+        return 1;
+    }
+    version = p[ip] >> 4;
+    if ((ethertype != 0 && ethertype != 0x0800 && ethertype != 0x86dd) || (version != 4 && version != 6)) {
+        return 1;
+    }
+
+    //* network layer, fragments and IPv6 extension headers are not supported
+    size_t tcp, addr_len = version == 4 ? 4 : 16;
+    const unsigned char *src, *dst;
+    if (version == 4) {
+        tcp = ip + (p[ip] & 0x0f) * 4;
+        end = std::min(len, ip + net16(p + ip + 2));
+        if (p[ip + 9] != 6 || (net16(p + ip + 6) & 0x3fff) != 0) {
+            return 1;
+        }
+        src = p + ip + 12;
+        dst = p + ip + 16;
+    } else {
+        if (len < ip + 40 || p[ip + 6] != 6) {
+            return 1;
+        }
+        tcp = ip + 40;
+        end = std::min(len, tcp + net16(p + ip + 4));
+        src = p + ip + 8;
+        dst = p + ip + 24;
+    }
+
+    //* transport layer
+    if (end < tcp + 20) {
+        return 1;
+    }
+    uint16_t sport = net16(p + tcp), dport = net16(p + tcp + 2);
+    size_t payload = tcp + (p[tcp + 12] >> 4) * 4;
+    if (dport == capture.port) {
+        packet.to_server = true;
+    } else if (sport == capture.port) {
+        packet.to_server = false;
+    } else {
+        return 1;
+    }
+    packet.seq = net32(p + tcp + 4);
+    packet.flags = p[tcp + 13];
+    packet.payload = offset + std::min(payload, end);
+    packet.len = payload < end ? end - payload : 0;
+
+    //* the client side first, so both directions have the same key
+    const unsigned char *client = packet.to_server ? src : dst, *server = packet.to_server ? dst : src;
+    key.assign(1, (char)version);
+    key.append((const char *)client, addr_len);
+    key.append((const char *)(packet.to_server ? p + tcp : p + tcp + 2), 2);
+    key.append((const char *)server, addr_len);
+    key.append((const char *)(packet.to_server ? p + tcp + 2 : p + tcp), 2);
+    return 0;
+}
+
+void reassemble_packets(const s_capture &capture, s_reassembly &reassembly, const std::vector<s_packet> &packets) {
+    for (const s_packet &packet : packets) {
+        s_tcp_stream &stream = reassembly.streams[packet.stream];
+        stream.index = packet.stream;
+        reassemble(capture, reassembly, stream, packet);
+        //* closed connections are released, the state of a long capture does not stay in memory
+        if ((packet.flags & 0x04) || (stream.dirs[0].fin && stream.dirs[1].fin && stream.dirs[0].pending.empty() && stream.dirs[1].pending.empty())) {
+            finish_stream(capture, reassembly, stream);
+            reassembly.streams.erase(packet.stream);
+        }
+    }
+    for (auto &entry : reassembly.streams) {
+        finish_stream(capture, reassembly, entry.second);
+    }
+    reassembly.streams.clear();
+}
+
+void finish_stream(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream) {
+    //* segments still waiting were lost by the capture
+    drain_pending(capture, reassembly, stream, true, true);
+    drain_pending(capture, reassembly, stream, false, true);
+    if (reassembly.on_close) {
+        reassembly.on_close(stream.index);
+    }
+}
+
+void reassemble(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream, const s_packet &packet) {
+    s_direction &dir = stream.dirs[packet.to_server];
+
+    //* the data starts after the SYN, or with the first segment if the capture started later
+    if (!dir.started) {
+        dir.started = true;
+        dir.base = dir.next = packet.seq + ((packet.flags & 0x02) ? 1 : 0);
+    }
+    dir.fin = dir.fin || (packet.flags & 0x01);
+    if (packet.len == 0) {
+        return;
+    }
+
+    int32_t ahead = (int32_t)(packet.seq - dir.next);
+    if (ahead > 0) {
+        //* out of order, it waits for the missing segments (or is skipped to if they never come)
+        if (dir.pending.emplace(packet.seq - dir.base, packet).second) {
+            dir.pending_bytes += packet.len;
+        }
+        if (dir.pending_bytes > CAPTURE_MAX_PENDING) {
+            drain_pending(capture, reassembly, stream, packet.to_server, true);
+        }
+        return;
+    }
+    //* retransmitted data is cut off
+    uint32_t seen = -ahead;
+    if (seen >= packet.len) {
+        return;
+    }
+    consume(reassembly, stream, packet.to_server, (const char *)capture.data + packet.payload + seen, packet.len - seen, packet.time);
+    dir.next = packet.seq + packet.len;
+    drain_pending(capture, reassembly, stream, packet.to_server, false);
+}
+
+void drain_pending(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream, bool to_server, bool skip) {
+    s_direction &dir = stream.dirs[to_server];
+
+    while (!dir.pending.empty()) {
+        s_packet packet = dir.pending.begin()->second;
+        int32_t ahead = (int32_t)(packet.seq - dir.next);
+        if (ahead > 0) {
+            if (!skip) {
+                break;
+            }
+            //* the capture lost a segment, the framing starts again with the next message
+            reassembly.gaps++;
+            dir.synced = false;
+            dir.framer = s_framer();
+            dir.message.clear();
+            dir.message_size = 0;
+            dir.next = packet.seq;
+            ahead = 0;
+        }
+        dir.pending.erase(dir.pending.begin());
+        dir.pending_bytes -= packet.len;
+        uint32_t seen = -ahead;
+        if (seen < packet.len) {
+            consume(reassembly, stream, to_server, (const char *)capture.data + packet.payload + seen, packet.len - seen, packet.time);
+            dir.next = packet.seq + packet.len;
+        }
+    }
+}
+
+void consume(s_reassembly &reassembly, s_tcp_stream &stream, bool to_server, const char *data, size_t len, uint64_t time) {
+    s_direction &dir = stream.dirs[to_server];
+
+    //* after a missing segment, the data up to the start of the next message cannot be framed
+    if (!dir.synced) {
+        const char *start = (const char *)memchr(data, '(', len);
+        if (start == NULL) {
+            return;
+        }
+        len -= start - data;
+        data = start;
+        dir.synced = true;
+    }
+
+    while (len > 0) {
+        size_t end = frame_reply(dir.framer, data, len);
+        size_t part = end == std::string::npos ? len : end;
+        //* only the beginning of a large message is kept, it is enough to tell what it is
+        if (dir.message_size + part <= reassembly.max_kept) {
+            dir.message.append(data, part);
+        } else if (dir.message.size() < CAPTURE_HEAD) {
+            dir.message.append(data, std::min(part, CAPTURE_HEAD - dir.message.size()));
+        } else if (dir.message.size() > CAPTURE_HEAD) {
+            dir.message.resize(CAPTURE_HEAD);
+        }
+        dir.message_size += part;
+        if (end == std::string::npos) {
+            break;
+        }
+        reassembly.on_message(stream.index, to_server, dir, time);
+        dir.framer = s_framer();
+        dir.message.clear();
+        dir.message_size = 0;
+        data += end;
+        len -= end;
+    }
+}
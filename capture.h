@@ -0,0 +1,159 @@
+/**
+ * @file capture.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - reading captured protocol traffic, header.
+ *
+ **/
+
+#ifndef _CAPTURE_H_
+#define _CAPTURE_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "protocol.h"
+
+#define CAPTURE_HEAD 64 // bytes of a message kept to classify it when it is too large to be kept whole
+#define CAPTURE_MAX_PENDING (1 << 20) // bytes of out-of-order segments kept before a missing segment is skipped
+
+struct s_capture {
+    const unsigned char *data = NULL; // mapped pcap file
+    size_t size = 0;
+    bool swapped = false; // written with the other byte order
+    bool nano = false; // timestamps in nanoseconds instead of microseconds
+    uint32_t linktype = 0;
+    uint16_t port = 32323; // server port, the traffic is told apart by it
+    uint64_t first = UINT64_MAX; // time of the first packet of the protocol, microseconds
+    uint64_t last = 0; // time of the last packet of the protocol
+};
+
+struct s_packet {
+    uint64_t time; // capture time in microseconds
+    size_t payload; // offset of the TCP payload in the capture
+    uint32_t len; // length of the payload
+    uint32_t seq; // TCP sequence number
+    uint32_t stream; // index of the TCP connection
+    bool to_server; // sent by the client
+    uint8_t flags; // TCP flags
+};
+
+struct s_direction {
+    bool started = false; // the first sequence number is known
+    uint32_t base = 0; // first sequence number
+    uint32_t next = 0; // next expected sequence number
+    std::map<uint32_t, s_packet> pending; // out-of-order segments by offset from the first sequence number
+    size_t pending_bytes = 0;
+    bool synced = true; // false after a missing segment until the next message starts
+    s_framer framer; // framing of the current message
+    std::string message = ""; // current message, only its head if it is too large to be kept
+    size_t message_size = 0; // bytes of the current message
+    bool fin = false; // the side closed the connection
+};
+
+struct s_tcp_stream {
+    uint32_t index = 0; // index of the TCP connection
+    s_direction dirs[2]; // from the server, to the server
+};
+
+struct s_reassembly {
+    std::unordered_map<uint32_t, s_tcp_stream> streams; // open connections by index
+    size_t max_kept = SIZE_MAX; // larger messages keep only their head
+    uint64_t gaps = 0; // segments missing from the capture
+    // complete request (to_server) or reply, time of the segment completing it
+    std::function<void(uint32_t stream, bool to_server, const s_direction &dir, uint64_t time)> on_message;
+    std::function<void(uint32_t stream)> on_close; // the connection was closed or the capture ended, optional
+};
+
+/**
+ * Map the capture and read its header.
+ * @param capture Capture state.
+ * @param path Path to the pcap file.
+ * @return 1 if an error occurs, else 0.
+ */
+int open_capture(s_capture &capture, std::string path);
+
+/**
+ * Unmap the capture.
+ * @param capture Capture state.
+ */
+void close_capture(s_capture &capture);
+
+/**
+ * Read the packets of the capture and assign the ones of the protocol to shards by their TCP connection.
+ * @param capture Capture state.
+ * @param shards Packets of each shard, appended to.
+ * @param streams Set to the number of TCP connections.
+ * @return Number of packets in the capture.
+ */
+uint64_t dispatch_packets(s_capture &capture, std::vector<std::vector<s_packet>> &shards, uint32_t &streams);
+
+/**
+ * Decode the link, IP and TCP headers of a packet.
+ * @param capture Capture state.
+ * @param offset Offset of the captured packet data.
+ * @param caplen Length of the captured packet data.
+ * @param packet Decoded packet, the stream is not set.
+ * @param key Connection key (client address and port, server address and port).
+ * @return 1 if it is not a TCP packet of the protocol, else 0.
+ */
+int decode_packet(const s_capture &capture, size_t offset, uint32_t caplen, s_packet &packet, std::string &key);
+
+/**
+ * Reassemble the streams of the packets in capture order and pass on their messages.
+ * @param capture Capture state.
+ * @param reassembly Reassembly state with the callbacks.
+ * @param packets Packets of whole connections, in capture order.
+ */
+void reassemble_packets(const s_capture &capture, s_reassembly &reassembly, const std::vector<s_packet> &packets);
+
+/**
+ * Finish a connection, the missing segments are skipped.
+ * @param capture Capture state.
+ * @param reassembly Reassembly state.
+ * @param stream Connection.
+ */
+void finish_stream(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream);
+
+/**
+ * Pass a segment to the reassembly of its direction, out-of-order segments wait for the missing ones.
+ * @param capture Capture state.
+ * @param reassembly Reassembly state.
+ * @param stream Connection of the segment.
+ * @param packet Segment.
+ */
+void reassemble(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream, const s_packet &packet);
+
+/**
+ * Pass the waiting segments that are next in order to the framing.
+ * @param capture Capture state.
+ * @param reassembly Reassembly state.
+ * @param stream Connection of the segments.
+ * @param to_server Direction of the segments.
+ * @param skip True to skip the missing segments (the capture lost them), else only the ones in order are passed.
+ */
+void drain_pending(const s_capture &capture, s_reassembly &reassembly, s_tcp_stream &stream, bool to_server, bool skip);
+
+/**
+ * Frame the in-order data of one direction into messages.
+ * @param reassembly Reassembly state.
+ * @param stream Connection of the data.
+ * @param to_server True for requests, false for replies.
+ * @param data In-order data.
+ * @param len Length of the data.
+ * @param time Capture time of the segment.
+ */
+void consume(s_reassembly &reassembly, s_tcp_stream &stream, bool to_server, const char *data, size_t len, uint64_t time);
+
+#endif /* _CAPTURE_H_ */
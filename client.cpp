@@ -13,6 +13,52 @@
  * -p <port>, --port <port>
  *    Server port to connect to
  *    Server port to connect to
+ * -c <count>, --connections <count>
+ *    Number of connections used to fetch several messages
+ * -u, --unordered
+ *    Print fetched messages as they complete instead of in order
+ * --no-cache
+ *    Fetch messages from the server only, without using the cache
+ * --verify-cache
+ *    Fetch messages from the server and check the cached copies
+ * --cache-dir <dir>
+ *    Directory of the fetched messages cache (per server and user),
+ *    $XDG_CACHE_HOME/isa-client or ~/.cache/isa-client by default
+ * --body-file <file>
+ *    Stream the body of send from the file, - for stdin
+ * --connect-timeout <ms>
+ *    Time to connect to the server over all its addresses, 10000 by default, 0 without timeout
+ * --read-timeout <ms>
+ *    Time the server may send no reply data for while a reply is awaited, 30000 by default
+ * --write-timeout <ms>
+ *    Time the server may stop reading a request for while it is sent, 30000 by default
+ * --dns-ttl <s>
+ *    Seconds the resolved server addresses are cached for (in the cache directory), 300 by default, 0 not cached
+ * --deadline <ms>
+ *    Time the whole command (or a line of a session) may take, the requests still pending then fail, 0 (default) without deadline
+ * --retries <count>
+ *    Times list and fetch are sent again after a connection failure, 2 by default,
+ *    unless a part of the reply was printed (mutating commands are never sent again)
+ * --retry-backoff <ms>
+ *    Backoff before the first retry, doubled for each next one, the delay is drawn at random up to it, 100 by default
+ * --hedge <ms>
+ *    Send list and fetch again on another connection if they are not answered in time, the first reply is used,
+ *    0 (default) not hedged
+ * --hedge-percentile <p>
+ *    Percentile of the measured replies used as the hedge time instead once enough replies were measured, 95 by default
+ * --format <format>
+ *    Output format of the replies: text (default), ndjson (one JSON object per line)
+ *    or tsv (one tab separated line), lists and fetched messages are one record per message
+ * --agent <path>
+ *    Forward the requests through the agent listening on the socket, if it is running
+ *    ($ISA_AGENT, else isa-agent.sock in $XDG_RUNTIME_DIR or /tmp/isa-agent-<uid>.sock by default)
+ * --no-agent
+ *    Connect to the server directly even if the agent is running
+ * --user <name>
+ *    Account of the agent used by the commands (and the cache), the last one logged in by default
+ * --trace[=<file>]
+ *    Write the phase timing of each request as one JSON line to stderr or appended to the file,
+ *    also enabled by the ISA_TRACE environment variable (1 for stderr, or a file path)
  * --help, -h
  *    Show this help
  * Supported commands:
@@ -20,94 +66,715 @@
  *  login <username> <password>
  *  list
  *  send <recipient> <subject> <body>
+ *  send <recipient> <subject> -
+ *  send --body-file <file> <recipient> <subject>
+ *    Stream the body from stdin or the file, it is not kept in memory
+ *  send --batch <file>|-
+ *    Send one message per record of the file or stdin, CSV (recipient,subject,body, an optional
+ *    header line) or NDJSON ({"recipient":...,"subject":...,"body":...}), over the connection pool,
+ *    the result of each record is written with its number as it completes
  *  fetch <id>
+ *  fetch <from>-<to>|<id>,<id>...|all
+ *    Fetch several messages, ranges and ids can be combined (e.g. 1-5,9), at most 1000000 ids,
+ *    all fetches every message in the list
+ *  sync
+ *    Fetch only the messages added since the last sync into the cache,
+ *    all of them again if the mailbox changed
  *  logout
+ *  session [<script>]
+ *    Read commands (one per line) from the script or stdin
+ *    and run them against the server over one connection
+ *  batch [<script>]
+ *    Like session, but the requests are sent back to back
+ *    without waiting for the replies
  */
 
 #include "client.h"
 
-#define MAXDATASIZE 32818 // max number of bytes we can get at once 
+static std::string cached_addresses = ""; // address cache file the server addresses were read from
 
 int main(int argc, char *argv[])
 {
-    int sockfd;  
-    struct addrinfo hints, *server_info, *p;
-    int rv;
+    struct addrinfo *server_info;
+    s_engine engine;
+    int result = 1;
 
     parseargs(argc, argv);
 
-    /**
-     * Parts of the following code (network connection setup) were taken over from the "Beej's Guide to Network Programming" and edited accordingly.
-     * The C source code presented in this document is granted to the public domain, and is completely free of any license restriction.
-     * https://beej.us/guide/bgnet/html/
-    **/
-    //* connection setup
-    memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_UNSPEC; // IPv4 or IPv6
-    hints.ai_socktype = SOCK_STREAM; // TCP
-    if ((rv = getaddrinfo(args.addr.c_str(), args.port.c_str(), &hints, &server_info)) != 0) {
-        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
+    std::string command = argv[optind];
+    if (command == "session") {
+        return run_session(argc, argv);
+    } else if (command == "batch") {
+        return run_batch(argc, argv);
+    } else if (command == "fetch" && argc == optind + 2 && strpbrk(argv[optind + 1], "-,") != NULL) {
+        return run_fetch(argc, argv);
+    } else if (command == "fetch" && argc == optind + 2 && strcmp(argv[optind + 1], "all") == 0) {
+        return run_fetch(argc, argv);
+    } else if (command == "sync" && argc == optind + 1) {
+        return run_fetch(argc, argv);
+    } else if (command == "send" && args.send_batch != "") {
+        return run_send_batch(argc, argv);
+    }
+
+    long id = command == "fetch" && argc == optind + 2 ? message_id(argv[optind + 1]) : 0;
+    //* the arguments are sent as they are, without copying them into one string
+    s_message message;
+    if (build_request(argc, argv, command, message) != 0) {
+        return 1;
+    }
+
+    //* fetched messages do not change, a cached one is printed without asking the server
+    s_cache cache;
+    s_cached_message cached;
+    if (id > 0 && open_cache(cache) == 0 && args.cache == 1 && cache_get(cache, id, cached) == 0) {
+        if (args.format == FORMAT_TEXT) {
+            printf("%s\n", cached_response(cached).c_str());
+        } else {
+            std::string out;
+            record_message(out, id, cached.sender, cached.subject, cached.body);
+            record_write(out);
+        }
+        cache_close(cache);
+        return 0;
+    }
+
+    int rv = open_engine(engine, &server_info);
+    if (rv != 0) {
+        cache_close(cache);
+        return rv;
+    }
+
+    //* connect, send the request, print response and resolve login tokens
+    submit_request(engine, engine_open(engine), std::move(message), command, result, cache.data_fd != -1 ? &cache : NULL, id);
+    engine_run(engine);
+
+    engine_free(engine);
+    free_server(server_info);
+    cache_close(cache);
+
+    report_failure(result);
+    return result != 0 ? 2 : 0;
+}
+
+int run_session(int argc, char** argv) {
+    struct addrinfo *server_info;
+    std::ifstream script;
+    std::string line;
+    s_engine engine;
+    int rv = 0;
+
+    std::istream *input = open_script(argc, argv, script);
+    if (input == NULL) {
         return 1;
     }
-    //* loop through all the results and connect to the first we can
-    for(p = server_info; p != NULL; p = p->ai_next) {
-        sockfd = socket(p->ai_family, p->ai_socktype, p->ai_protocol);
-        //* invalid socket, check next list value
-        if (sockfd == -1) {
-            perror("client: socket");
+
+    //* resolve the server only once, reconnects use the resolved addresses
+    if ((rv = open_engine(engine, &server_info)) != 0) {
+        return rv;
+    }
+    int conn = engine_open(engine);
+    session.active = true;
+
+    while (std::getline(*input, line)) {
+        std::vector<std::string> words = split_command_line(line);
+        if (words.empty() || words[0][0] == '#') {
             continue;
         }
-        //* unable to connect, check next list value
-        if (connect(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
-            close(sockfd);
-            perror("client: connect");
+        s_message message;
+        message_own(message, get_line_message(words, argv[0]));
+        if (message.size == 0) {
+            rv = 1;
             continue;
         }
-        break;
+
+        //* the open connection is reused, the engine reconnects once if the server dropped it
+        int result = 1;
+        engine.deadline = args.deadline > 0 ? engine_now() + args.deadline : 0;
+        submit_request(engine, conn, std::move(message), words[0], result, NULL, fetched_id(words));
+        if (engine_run(engine) != 0) {
+            rv = 2;
+            break;
+        }
+        report_failure(result);
+        if (result != 0) {
+            rv = 2;
+        }
     }
 
-    if (p == NULL) {
-        fprintf(stderr, "Client failed to connect to the server.\n");
-        return 2;
+    engine_free(engine);
+    free_server(server_info);
+    return rv;
+}
+
+int run_batch(int argc, char** argv) {
+    struct addrinfo *server_info;
+    std::ifstream script;
+    std::string line;
+    std::vector<std::vector<std::string>> lines;
+    s_engine engine;
+    int rv = 0;
+
+    std::istream *input = open_script(argc, argv, script);
+    if (input == NULL) {
+        return 1;
+    }
+    while (std::getline(*input, line)) {
+        std::vector<std::string> words = split_command_line(line);
+        if (!words.empty() && words[0][0] != '#') {
+            lines.push_back(words);
+        }
     }
 
-    //* connected - free the structure with server info
-    freeaddrinfo(server_info);
+    if ((rv = open_engine(engine, &server_info)) != 0) {
+        return rv;
+    }
+    int conn = engine_open(engine);
+    session.active = true;
+    //* the replies are printed in the order of the requests on one connection, a read is not sent again out of order
+    args.retries = 0;
+    args.hedge = 0;
 
-    // end of code including parts taken over from the "Beej's Guide to Network Programming"
+    size_t group_start = 0;
+    while (group_start < lines.size()) {
+        //* login and logout change the token used by the following requests,
+        //* so the requests after them are built once their reply is resolved
+        size_t group_end = group_start;
+        while (group_end < lines.size()) {
+            int command = find_command(lines[group_end++][0]);
+            if (command != -1 && command_table[command].effect != EFFECT_NONE) {
+                break;
+            }
+        }
+        std::vector<std::string> commands;
+        std::vector<long> ids;
+        std::vector<s_message> messages;
+        for (size_t i = group_start; i < group_end; i++) {
+            s_message message;
+            message_own(message, get_line_message(lines[i], argv[0]));
+            if (message.size == 0) {
+                rv = 1;
+                continue;
+            }
+            commands.push_back(lines[i][0]);
+            ids.push_back(fetched_id(lines[i]));
+            messages.push_back(std::move(message));
+        }
+        group_start = group_end;
 
-    std::string command = argv[optind];
-    std::string message = get_message(argc, argv, command);
-    std::string response;
+        //* the engine writes the requests back to back and matches the replies in order,
+        //* it stops pipelining if the server answers one request per connection
+        std::vector<int> results(messages.size(), 1);
+        engine.deadline = args.deadline > 0 ? engine_now() + args.deadline : 0;
+        for (size_t i = 0; i < messages.size(); i++) {
+            submit_request(engine, conn, std::move(messages[i]), commands[i], results[i], NULL, ids[i]);
+        }
+        if (engine_run(engine) != 0) {
+            rv = 2;
+            break;
+        }
+        size_t unanswered = 0;
+        int failure = 0;
+        for (int result : results) {
+            if (result == 2) {
+                rv = 2;
+            } else if (result != 0) {
+                unanswered++;
+                failure = std::max(failure, result);
+            }
+        }
+        if (unanswered > 0) {
+            report_failure(failure);
+            fprintf(stderr, "%zu request(s) were not answered by the server.\n", unanswered);
+            rv = 2;
+            break;
+        }
+    }
+
+    engine_free(engine);
+    free_server(server_info);
+    return rv;
+}
 
-    if (message == "") {
-        close(sockfd);
+int run_fetch(int argc, char** argv) {
+    struct addrinfo *server_info;
+    s_engine engine;
+    s_fetch fetch;
+    bool sync = strcmp(argv[optind], "sync") == 0;
+    std::string spec = sync ? "all" : argv[optind + 1];
+    std::vector<uint32_t> listed; // fingerprints of all listed messages
+    size_t unchanged = 0; // messages synced before
+
+    fetch.program = argv[0];
+    int invalid = spec != "all" ? parse_ids(spec, fetch.ranges, fetch.count) : 0;
+    if (invalid == 1) {
+        fprintf(stderr, "Invalid message ids %s. See --help.\n", spec.c_str());
+        return 1;
+    } else if (invalid == 2) {
+        fprintf(stderr, "Too many message ids %s, at most %d can be fetched at once.\n", spec.c_str(), FETCH_MAX_IDS);
+        return 1;
+    }
+    //! the synced messages are kept in the cache of the logged in user
+    if (open_cache(fetch.cache) != 0 && sync) {
+        fprintf(stderr, "Sync needs the cache of a logged in user. See --help.\n");
         return 1;
     }
 
-    if (send_data(message, sockfd) != 0) {
-        close(sockfd);
-        return 2;
+    int opened = open_engine(engine, &server_info);
+    if (opened != 0) {
+        cache_close(fetch.cache);
+        return opened;
+    }
+    std::vector<int> conns;
+    for (int i = 0; i < args.connections; i++) {
+        conns.push_back(engine_open(engine));
     }
+    session.active = true; // the token file is read only once
 
-    response = receive_data(sockfd);
-    if (response == "") {
-        close(sockfd);
-        return 2;
+    //* all messages, the count is taken from the list
+    if (spec == "all") {
+        std::vector<std::string> words = {"list"};
+        int status = 1;
+        std::string reply;
+        std::string line = get_line_message(words, fetch.program);
+        submit_read(engine, conns[0], [line, &status, &reply]() {
+            s_engine_request request;
+            message_own(request.message, line);
+            request.read_only = true;
+            request.on_done = [&status, &reply](int done_status, std::string done_reply) {
+                status = done_status;
+                reply = done_reply;
+            };
+            return request;
+        });
+        engine_run(engine);
+
+        s_reply parsed;
+        parsed.newlines = true; // the fingerprints are of the fields as cached
+        int malformed = status == 0 ? parse_response(reply, parsed) : 1;
+        if (status != 0 || malformed != 0 || !parsed.ok) {
+            if (status == 0 && malformed == 0 && !parsed.fields.empty() && args.format != FORMAT_TEXT) {
+                std::string out;
+                record_status(out, false, parsed.fields[0]);
+                record_write(out);
+            } else if (status == 0 && malformed == 0 && !parsed.fields.empty()) {
+                fputs("ERROR: ", stdout);
+                print_text(parsed.fields[0]);
+                fputs("\n", stdout);
+            } else if (status == 1 || status == 3 || status == 4) {
+                report_failure(status);
+            } else {
+                fprintf(stderr, "Invalid server response.\n");
+            }
+            engine_free(engine);
+            free_server(server_info);
+            cache_close(fetch.cache);
+            return 2;
+        }
+        fetch.count = parsed.fields.size() / 2;
+        if (fetch.count > 0) {
+            fetch.ranges.push_back({1, (long)fetch.count});
+        }
+        for (size_t i = 1; i <= fetch.count; i++) {
+            listed.push_back(cache_fingerprint(parsed.fields[2 * i - 2], parsed.fields[2 * i - 1]));
+        }
     }
 
-    //* print response and resolve login tokens
-    std::string terminal = terminal_response(response, command);
-    printf("%s\n", terminal.c_str());
+    //* only the messages listed after the ones seen by the last sync are fetched
+    if (sync) {
+        std::vector<uint32_t> saved;
+        cache_sync_load(fetch.cache, saved);
+        if (saved.size() <= listed.size() && std::equal(saved.begin(), saved.end(), listed.begin())) {
+            unchanged = saved.size();
+        } else {
+            //* messages were removed or changed (e.g. the server was reset), the cached copies are fetched again
+            fprintf(stderr, "The mailbox changed since the last sync, all messages are synced again.\n");
+            args.cache = 2;
+        }
+        fetch.offset = unchanged;
+        fetch.count -= unchanged;
+        fetch.fingerprints.assign(listed.begin() + unchanged, listed.end());
+    }
 
-    close(sockfd);
+    //* each connection keeps a window of requests in flight, the next id is requested as one completes
+    for (size_t window = 1; window <= FETCH_WINDOW; window++) {
+        for (int conn : conns) {
+            fetch_next(engine, conn, fetch, window);
+        }
+    }
+    int rv = engine_run(engine) != 0 ? 2 : 0;
+
+    //* the sync state covers the messages fetched without a gap, the rest is fetched by the next sync
+    size_t synced = fetch.synced;
+    if (sync) {
+        listed.resize(unchanged + synced);
+        cache_sync_save(fetch.cache, listed, unchanged);
+    }
+
+    engine_free(engine);
+    free_server(server_info);
+    cache_close(fetch.cache);
+
+    //* collected errors are reported at the end
+    fflush(stdout);
+    for (auto &error : fetch.errors) {
+        fprintf(stderr, "%s\n", error.c_str());
+    }
+    if (fetch.unreachable) {
+        report_failure(3);
+    }
+    size_t failed = fetch.failed + fetch.count - fetch.next;
+    if (failed > 0) {
+        fprintf(stderr, "%zu of %zu message(s) could not be fetched.\n", failed, fetch.count);
+        rv = 2;
+    } else if (sync) {
+        //* machine-readable output has the records of the messages only
+        fprintf(args.format == FORMAT_TEXT ? stdout : stderr, "SUCCESS: %zu new message(s) synced\n", synced);
+    }
+    return rv;
+}
+
+int parse_ids(std::string spec, std::vector<std::pair<long, long>> &ranges, size_t &count) {
+    size_t start = 0;
 
+    while (start <= spec.size()) {
+        size_t end = spec.find(',', start);
+        if (end == std::string::npos) {
+            end = spec.size();
+        }
+        std::string item = spec.substr(start, end - start);
+        size_t dash = item.find('-');
+        std::string first = item.substr(0, dash);
+        std::string last = dash == std::string::npos ? first : item.substr(dash + 1);
+        //! ids are positive numbers, ranges go upwards
+        if (first.empty() || last.empty() || first.find_first_not_of("0123456789") != std::string::npos
+                || last.find_first_not_of("0123456789") != std::string::npos || first.size() > 9 || last.size() > 9) {
+            return 1;
+        }
+        long from = atol(first.c_str()), to = atol(last.c_str());
+        if (from < 1 || to < from) {
+            return 1;
+        }
+        //! the ids are requested one by one, a huge range is a mistake
+        if ((size_t)(to - from) >= FETCH_MAX_IDS - count) {
+            return 2;
+        }
+        ranges.push_back({from, to});
+        count += to - from + 1;
+        start = end + 1;
+    }
     return 0;
 }
 
+void fetch_next(s_engine &engine, int conn, s_fetch &fetch, size_t window) {
+    //* ordered output keeps at most a few windows of responses waiting to be printed
+    size_t ahead = (size_t)args.connections * FETCH_WINDOW * 2;
+
+    while (engine.conns[conn].queue.size() < window && fetch.next < fetch.count && !fetch.unreachable) {
+        if (!args.unordered && fetch.next >= fetch.printed + ahead) {
+            fetch.idle.push_back(conn);
+            return;
+        }
+        //* the ids are taken from the ranges as they are requested
+        size_t position = fetch.next++;
+        long id = fetch.ranges[fetch.range].first + fetch.offset;
+        if (id == fetch.ranges[fetch.range].second) {
+            fetch.range++;
+            fetch.offset = 0;
+        } else {
+            fetch.offset++;
+        }
+        std::string shown = std::to_string(id);
+        fetch.output.emplace_back();
+        fetch.done.push_back(false);
+        fetch.fetched.push_back(false);
+        s_cached_message cached;
+        //* a synced message is cached under its id only if it is the listed one
+        if (args.cache == 1 && cache_get(fetch.cache, id, cached) == 0 && (fetch.fingerprints.empty()
+                || cache_fingerprint(cached.sender, cached.subject) == fetch.fingerprints[position])) {
+            std::string output;
+            if (args.format == FORMAT_TEXT) {
+                output = shown + ": " + cached_response(cached) + "\n";
+            } else {
+                record_message(output, id, cached.sender, cached.subject, cached.body);
+            }
+            fetch_done(fetch, position, std::move(output));
+            continue;
+        }
+        std::vector<std::string> words = {"fetch", shown};
+        submit_read(engine, conn, [&engine, &fetch, conn, position, id, shown, line = get_line_message(words, fetch.program)]() {
+            s_engine_request request;
+            message_own(request.message, line);
+            request.read_only = true;
+            request.on_done = [&engine, &fetch, conn, position, id = shown](int status, std::string reply) {
+                std::string output = "";
+                //* per-message errors are collected, the other messages are still fetched
+                if ((status == 0 || (status == 2 && reply != "")) && args.format != FORMAT_TEXT) {
+                    s_reply parsed;
+                    if (status != 0 || parse_response(reply, parsed) != 0 || (!parsed.ok && parsed.fields.empty())) {
+                        fetch.errors.push_back(id + ": ERROR: invalid server response");
+                    } else if (!parsed.ok) {
+                        fetch.errors.push_back(id + ": ERROR: " + std::string(parsed.fields[0]));
+                    } else if (record_response(reply, "fetch", message_id(id), output) != 0) {
+                        fetch.errors.push_back(id + ": ERROR: invalid server response");
+                    }
+                } else if (status == 0 || (status == 2 && reply != "")) {
+                    output = terminal_response(reply, "fetch");
+                    if (output == "" || status != 0) {
+                        fetch.errors.push_back(id + ": ERROR: invalid server response");
+                        output = "";
+                    } else if (output.compare(0, 7, "ERROR: ") == 0) {
+                        fetch.errors.push_back(id + ": " + output);
+                        output = "";
+                    }
+                } else if (status == 3) {
+                    fetch.unreachable = true;
+                } else if (status == 4) {
+                    fetch.errors.push_back(id + ": ERROR: the server did not answer in time");
+                } else {
+                    fetch.errors.push_back(id + ": ERROR: connection closed before the reply");
+                }
+                if (output == "") {
+                    fetch.failed++;
+                } else if (args.format == FORMAT_TEXT) {
+                    output = id + ": " + output + "\n";
+                }
+                fetch_done(fetch, position, output);
+
+                //* continue on this connection and on the ones waiting for the output
+                std::vector<int> waiting;
+                waiting.swap(fetch.idle);
+                fetch_next(engine, conn, fetch, FETCH_WINDOW);
+                for (int idle : waiting) {
+                    if (idle != conn) {
+                        fetch_next(engine, idle, fetch, FETCH_WINDOW);
+                    }
+                }
+            };
+            if (fetch.cache.data_fd != -1) {
+                cache_reply(request, fetch.cache, id);
+            }
+            return request;
+        });
+    }
+}
+
+void fetch_done(s_fetch &fetch, size_t position, std::string output) {
+    size_t slot = position - fetch.base;
+
+    fetch.fetched[slot] = !output.empty();
+    fetch.done[slot] = true;
+    if (args.unordered) {
+        fwrite(output.data(), 1, output.size(), stdout);
+        fetch.printed++;
+    } else {
+        fetch.output[slot] = std::move(output);
+    }
+    //* print the responses that are next in order, the completed positions at the front are dropped
+    while (!fetch.done.empty() && fetch.done.front()) {
+        if (!args.unordered) {
+            fwrite(fetch.output.front().data(), 1, fetch.output.front().size(), stdout);
+            fetch.printed++;
+        }
+        fetch.gap = fetch.gap || !fetch.fetched.front();
+        fetch.synced += !fetch.gap;
+        fetch.output.pop_front();
+        fetch.done.pop_front();
+        fetch.fetched.pop_front();
+        fetch.base++;
+    }
+}
+
+int run_send_batch(int argc, char** argv) {
+    struct addrinfo *server_info;
+    std::ifstream file;
+    s_engine engine;
+    s_bulk bulk;
+
+    bulk.input = &std::cin;
+    if (args.send_batch != "-") {
+        file.open(args.send_batch);
+        if (file.fail()) {
+            fprintf(stderr, "Error while opening the records %s.\n", args.send_batch.c_str());
+            return 1;
+        }
+        bulk.input = &file;
+    }
+    bulk.format = record_detect(*bulk.input);
+
+    int opened = open_engine(engine, &server_info);
+    if (opened != 0) {
+        return opened;
+    }
+    std::vector<int> conns;
+    for (int i = 0; i < args.connections; i++) {
+        conns.push_back(engine_open(engine));
+    }
+    session.active = true; // the token file is read only once
+    bulk.token = get_token();
+
+    //* the records are read as the requests complete, only the windows of the connections are kept
+    for (size_t window = 1; window <= FETCH_WINDOW; window++) {
+        for (int conn : conns) {
+            bulk_next(engine, conn, bulk, window);
+        }
+    }
+    int rv = engine_run(engine) != 0 ? 2 : 0;
+
+    engine_free(engine);
+    free_server(server_info);
+
+    fflush(stdout);
+    if (bulk.unreachable) {
+        report_failure(3);
+        fprintf(stderr, "The records after %zu were not sent.\n", bulk.read);
+    }
+    if (bulk.failed > 0 || bulk.unreachable) {
+        fprintf(stderr, "%zu of %zu record(s) could not be sent.\n", bulk.failed, bulk.read);
+        rv = 2;
+    } else {
+        //* machine-readable output has the results of the records only
+        fprintf(args.format == FORMAT_TEXT ? stdout : stderr, "SUCCESS: %zu message(s) sent\n", bulk.sent);
+    }
+    return rv;
+}
+
+void bulk_next(s_engine &engine, int conn, s_bulk &bulk, size_t window) {
+    static const std::vector<std::string_view> names = {"recipient", "subject", "body"};
+    static const int send = find_command("send");
+
+    while (engine.conns[conn].queue.size() < window && !bulk.end && !bulk.unreachable) {
+        std::vector<std::string> fields;
+        int rv = record_read(*bulk.input, bulk.format, names, fields);
+        if (rv == 1) {
+            bulk.end = true;
+            break;
+        }
+        //* an optional CSV header names the columns
+        if (bulk.read == 0 && rv == 0 && bulk.format == RECORD_CSV && fields.size() == 3 && fields[0] == names[0] && fields[1] == names[1] && fields[2] == names[2]) {
+            continue;
+        }
+        size_t id = ++bulk.read;
+        if (rv != 0 || fields.size() != names.size()) {
+            bulk.failed++;
+            bulk_result(id, false, "invalid record");
+            continue;
+        }
+
+        //* the fields are escaped into the request when needed, they are kept with it
+        std::shared_ptr<std::vector<std::string>> values = std::make_shared<std::vector<std::string>>(std::move(fields));
+        s_request_args request;
+        request.values.assign(values->begin(), values->end());
+        request.token = bulk.token;
+        s_engine_request submitted;
+        encode_request(send, request, submitted.message);
+        submitted.on_done = [&engine, &bulk, conn, id, values](int status, std::string reply) {
+            s_reply parsed;
+            if (status == 0 && parse_response(reply, parsed) == 0 && !parsed.fields.empty()) {
+                (parsed.ok ? bulk.sent : bulk.failed)++;
+                bulk_result(id, parsed.ok, parsed.fields[0]);
+            } else {
+                bulk.failed++;
+                bulk.unreachable = bulk.unreachable || status == 3;
+                bulk_result(id, false, status == 3 ? "failed to connect to the server" : status == 4 ? "the server did not answer in time"
+                    : status == 1 ? "connection closed before the reply" : "invalid server response");
+            }
+            bulk_next(engine, conn, bulk, FETCH_WINDOW);
+        };
+        engine_submit(engine, conn, std::move(submitted));
+    }
+}
+
+void bulk_result(size_t id, bool ok, std::string_view text) {
+    if (args.format == FORMAT_TEXT) {
+        printf("%zu: %s%.*s\n", id, ok ? "SUCCESS: " : "ERROR: ", (int)text.size(), text.data());
+        return;
+    }
+    std::string out;
+    record_result(out, id, ok, text);
+    record_write(out);
+}
+
+std::istream *open_script(int argc, char** argv, std::ifstream &script) {
+    //* commands are read from the script file if given, else from stdin
+    if (argc > optind + 2) {
+        fprintf(stderr, "Invalid command. See --help.\n");
+        return NULL;
+    }
+    if (argc == optind + 2) {
+        script.open(argv[optind + 1]);
+        if (script.fail()) {
+            fprintf(stderr, "Error while opening the script %s.\n", argv[optind + 1]);
+            return NULL;
+        }
+        return &script;
+    }
+    return &std::cin;
+}
+
+std::string get_line_message(std::vector<std::string> &words, char *program) {
+    //* build argv for get_message as if the command was given on the command line
+    std::vector<char*> cmd_argv;
+    cmd_argv.push_back(program);
+    for (auto &word : words) {
+        cmd_argv.push_back(&word[0]);
+    }
+    cmd_argv.push_back(NULL);
+    optind = 1;
+    std::string message = get_message(words.size() + 1, cmd_argv.data(), words[0]);
+    //* unknown commands are already reported by get_message
+    if (message == "" && find_command(words[0]) != -1) {
+        fprintf(stderr, "Invalid arguments of command %s. See --help.\n", words[0].c_str());
+    }
+    return message;
+}
+
+std::vector<std::string> split_command_line(std::string line) {
+    std::vector<std::string> words;
+    std::string word;
+    bool in_word = false;
+    char quote = '\0';
+
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quote == '\'') {
+            if (c == '\'') { quote = '\0'; } else { word += c; }
+        } else if (quote == '"') {
+            if (c == '\\' && i + 1 < line.size() && (line[i+1] == '"' || line[i+1] == '\\')) {
+                word += line[++i];
+            } else if (c == '"') {
+                quote = '\0';
+            } else {
+                word += c;
+            }
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+            in_word = true;
+        } else if (c == '\\' && i + 1 < line.size()) {
+            word += line[++i];
+            in_word = true;
+        } else if (isspace((unsigned char)c)) {
+            if (in_word) {
+                words.push_back(word);
+                word = "";
+                in_word = false;
+            }
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (in_word) {
+        words.push_back(word);
+    }
+    return words;
+}
+
 void parseargs(int argc, char** argv) {
     int arg;
     extern char *optarg;
+    std::string trace = "";
+    bool traced = false;
+    bool direct = false; // the agent is not used
 
     //! arguments count check
     if (argc < 2) {
@@ -120,11 +787,32 @@ void parseargs(int argc, char** argv) {
         static struct option long_options[] = {
                 {"address", 1,  0, 'a'},
                 {"port", 1,  0, 'p'},
+                {"connections", 1, 0, 'c'},
+                {"unordered", 0, 0, 'u'},
+                {"no-cache", 0, 0, 'N'},
+                {"verify-cache", 0, 0, 'V'},
+                {"cache-dir", 1, 0, 'D'},
+                {"body-file", 1, 0, 'B'},
+                {"batch", 1, 0, 'S'},
+                {"trace", 2, 0, 'T'},
+                {"connect-timeout", 1, 0, 'C'},
+                {"read-timeout", 1, 0, 'R'},
+                {"write-timeout", 1, 0, 'W'},
+                {"dns-ttl", 1, 0, 'L'},
+                {"deadline", 1, 0, 'E'},
+                {"retries", 1, 0, 'r'},
+                {"retry-backoff", 1, 0, 'K'},
+                {"hedge", 1, 0, 'H'},
+                {"hedge-percentile", 1, 0, 'P'},
+                {"format", 1, 0, 'F'},
+                {"agent", 1, 0, 'G'},
+                {"no-agent", 0, 0, 'n'},
+                {"user", 1, 0, 'U'},
                 {"help", 0, 0, 'h'},
                 {0, 0, 0, 0}
         };
         int index = 0;
-        arg = getopt_long(argc, argv, "a:p:h", long_options, &index);
+        arg = getopt_long(argc, argv, "a:p:c:uh", long_options, &index);
         if (arg == -1) {
             // end of arguments
             break;
@@ -136,6 +824,79 @@ void parseargs(int argc, char** argv) {
             case 'p':
                 args.port = optarg; 
                 break;
+            case 'c':
+                args.connections = std::max(1, atoi(optarg));
+                break;
+            case 'u':
+                args.unordered = true;
+                break;
+            case 'N':
+                args.cache = 0;
+                break;
+            case 'V':
+                args.cache = 2;
+                break;
+            case 'D':
+                args.cache_dir = optarg;
+                break;
+            case 'B':
+                args.body_file = optarg;
+                break;
+            case 'S':
+                args.send_batch = optarg;
+                break;
+            case 'T':
+                trace = optarg != NULL ? optarg : "";
+                traced = true;
+                break;
+            case 'C':
+                args.connect_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'R':
+                args.read_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'W':
+                args.write_timeout = std::max(0, atoi(optarg));
+                break;
+            case 'L':
+                args.dns_ttl = std::max(0, atoi(optarg));
+                break;
+            case 'E':
+                args.deadline = std::max(0, atoi(optarg));
+                break;
+            case 'r':
+                args.retries = std::max(0, atoi(optarg));
+                break;
+            case 'K':
+                args.retry_backoff = std::max(0, atoi(optarg));
+                break;
+            case 'H':
+                args.hedge = std::max(0, atoi(optarg));
+                break;
+            case 'P':
+                args.hedge_percentile = std::min(100.0, std::max(0.0, atof(optarg)));
+                break;
+            case 'F':
+                if (strcmp(optarg, "text") == 0) {
+                    args.format = FORMAT_TEXT;
+                } else if (strcmp(optarg, "ndjson") == 0) {
+                    args.format = FORMAT_NDJSON;
+                } else if (strcmp(optarg, "tsv") == 0) {
+                    args.format = FORMAT_TSV;
+                } else {
+                    fprintf(stderr, "Invalid format %s. See --help.\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'G':
+                args.agent = optarg;
+                break;
+            case 'n':
+                direct = true;
+                break;
+            case 'U':
+                args.user = optarg;
+                break;
             case 'h':
                 p_help();
                 break;
@@ -149,255 +910,328 @@ void parseargs(int argc, char** argv) {
         fprintf(stderr, "Invalid command. See --help.\n");
         exit(1);
     }
+    //! the body file is the body of one send command
+    if (args.body_file != "" && strcmp(argv[optind], "send") != 0) {
+        fprintf(stderr, "--body-file can only be used with send. See --help.\n");
+        exit(1);
+    }
+    if (args.send_batch != "" && (strcmp(argv[optind], "send") != 0 || args.body_file != "" || argc != optind + 1)) {
+        fprintf(stderr, "--batch is used as send --batch <file>, without other arguments. See --help.\n");
+        exit(1);
+    }
+    //* the requests go through the agent only while it is running
+    if (!direct && args.agent == "") {
+        args.agent = agent_socket_path();
+    }
+    if (direct || (args.agent != "" && agent_probe(args.agent) != 0)) {
+        args.agent = "";
+    }
+    //* the option takes precedence over the environment
+    if ((traced ? trace_open(trace) : trace_open_env()) != 0) {
+        exit(1);
+    }
 
 }
 
 void p_help() {
     printf("usage: client [ <option> ... ] <command> [<args>] ... \n <option> is one of -a <addr>, --address <addr>\n");
-    printf("Server hostname or address to connect to\n-p <port>, --port <port>\n -p <port>, --port <port>\nServer port to connect to\n--help, -h\nShow this help\n");
+    printf("Server hostname or address to connect to\n-p <port>, --port <port>\n -p <port>, --port <port>\nServer port to connect to\n-c <count>, --connections <count>\nNumber of connections used to fetch several messages\n-u, --unordered\nPrint fetched messages as they complete instead of in order\n--no-cache\nFetch messages from the server only, without using the cache\n--verify-cache\nFetch messages from the server and check the cached copies\n--cache-dir <dir>\nDirectory of the fetched messages cache\n--body-file <file>\nStream the body of send from the file, - for stdin\n");
+    printf("--connect-timeout <ms>\nTime to connect to the server over all its addresses (default 10000, 0 without timeout)\n--read-timeout <ms>\nTime the server may send no reply data for (default 30000)\n--write-timeout <ms>\nTime the server may stop reading a request for (default 30000)\n--dns-ttl <s>\nSeconds the resolved server addresses are cached for (default 300, 0 not cached)\n");
+    printf("--deadline <ms>\nTime the whole command may take (default 0, without deadline)\n--retries <count>\nTimes list and fetch are sent again after a connection failure (default 2)\n--retry-backoff <ms>\nBackoff before the first retry, doubled and jittered (default 100)\n--hedge <ms>\nSend list and fetch again on another connection if not answered in time (default 0, not hedged)\n--hedge-percentile <p>\nPercentile of the measured replies used as the hedge time once known (default 95)\n");
+    printf("--format <format>\nOutput format of the replies: text (default), ndjson or tsv, one record per listed or fetched message\n");
+    printf("--agent <path>\nForward the requests through the agent on the socket if it is running\n--no-agent\nConnect to the server directly\n--user <name>\nAccount of the agent used by the commands (default the last one logged in)\n");
+    printf("--trace[=<file>]\nWrite the phase timing of each request as one JSON line to stderr or the file (also ISA_TRACE=1|<file>)\n--help, -h\nShow this help\n");
     printf("Multiple single-letter switches can be combined after\none `-`. For example, `-h-` is the same as `-h --`.\n");
-    printf("\nSupported commands:\nregister <username> <password>\nlogin <username> <password>\nlist\nsend <recipient> <subject> <body>\nfetch <id>\nlogout\n");
+    printf("\nSupported commands:\nregister <username> <password>\nlogin <username> <password>\nlist\nsend <recipient> <subject> <body>|-\nsend --body-file <file> <recipient> <subject>\nsend --batch <file>|-\nfetch <id>\nfetch <from>-<to>|<id>,<id>...|all\nsync\nlogout\nsession [<script>]\nbatch [<script>]\n");
     exit(0);
 }
 
-int send_data(std::string message, int sockfd) {
-    char buf[MAXDATASIZE];
-    int msg_len = message.length();
-    int numbytes = 0;
-    do {
-        message.copy(buf, MAXDATASIZE-1, 0);
-        message.erase(0, MAXDATASIZE-1);
-        if ((numbytes += send(sockfd, buf, msg_len, 0)) == -1) {
-            perror("Error sending the message.\n");
-            return 1;
-        }
-        memset(buf, '\0', MAXDATASIZE);
-    } while (numbytes < msg_len);
-    return 0;
-}
+void submit_request(s_engine &engine, int conn, s_message message, std::string command, int &result, s_cache *cache, long id) {
+    int index = find_command(command);
 
-std::string receive_data(int sockfd) {
-    char buf[MAXDATASIZE];
-    std::string response = "";
-    int numbytes = 0;
-        do {
-            if ((numbytes = recv(sockfd, buf, MAXDATASIZE-1, 0)) == -1) {
-                perror("Error receiving the message.\n");
-                return "";
-            } else if (numbytes > 0) {
-                response += buf;
-            }
-            memset(buf, '\0', MAXDATASIZE);
-        } while (numbytes > 0);
-        return response;
+    //* a read-only request may be sent several times, each attempt gets its own decoder
+    if (index != -1 && command_table[index].read_only) {
+        submit_read(engine, conn, [message = std::move(message), command, &result, cache, id]() {
+            return command_request(message, command, result, cache, id);
+        });
+        return;
+    }
+    engine_submit(engine, conn, command_request(std::move(message), command, result, cache, id));
 }
 
-std::string get_message(int argc, char** argv, std::string command) {
-    std::string msg = "(";
-    
-    if (command == "register" || command == "login") {
-        if (argc != optind + 3) { //* 2 arguments + 1 (index -> count)
-            return "";
-        }
-        std::string nickname = char_to_escaped(argv[++optind]);
-        std::string password = encoding::Base64::Encode(argv[++optind]);
-        msg += command + " \"" + nickname + "\" \"" + password + "\")";
+s_engine_request command_request(s_message message, std::string command, int &result, s_cache *cache, long id) {
+    s_engine_request request;
 
-    } else if (command == "list" or command == "logout") {
-        if (argc != optind + 1) { //* 0 arguments + 1 (index -> count)
-            return "";
+    request.message = std::move(message);
+    //* lists and messages may be long, they are printed while being received
+    int index = find_command(command);
+    e_layout layout = index != -1 ? command_table[index].layout : REPLY_TEXT;
+    request.read_only = index != -1 && command_table[index].read_only;
+    if (layout != REPLY_TEXT) {
+        request.decoder = args.format == FORMAT_TEXT ? stream_decoder(layout) : record_decoder(layout, id);
+    }
+    std::shared_ptr<s_decoder> decoder = request.decoder;
+    request.on_done = [command, decoder, layout, id, &result](int status, std::string reply) {
+        if (decoder && args.format != FORMAT_TEXT) {
+            record_end(*decoder, layout, status);
+            fflush(stdout);
         }
-        std::string token = get_token();
-        msg += command + " " + token + ")";
-
-    } else if (command == "fetch") {
-        if (argc != optind + 2) { //* 1 argument + 1 (index -> count)
-            return "";
+        if (decoder) {
+            if (status == 0 && args.format == FORMAT_TEXT) {
+                fputs("\n", stdout);
+                fflush(stdout);
+            } else if (status == 2 && decoder->failed) {
+                fprintf(stderr, "Invalid server response.\n");
+            } else if (status == 2) {
+                fprintf(stderr, args.format == FORMAT_TEXT ? "\nConnection closed before the end of the response.\n" : "Connection closed before the end of the response.\n");
+            }
+            result = status;
+            return;
         }
-        std::string msg_id = argv[++optind];
-        std::string token = get_token();
-        msg += command + " " + token + " " + msg_id + ")";
-
-    } else if (command == "send") {
-        if (argc != optind + 4) { //* 3 arguments + 1 (index -> count)
-            return "";
+        //* an incomplete reply is reported as invalid
+        if ((status == 0 || (status == 2 && reply != "")) && args.format != FORMAT_TEXT) {
+            std::string out;
+            int rv = record_response(reply, command, id, out);
+            record_write(out);
+            fflush(stdout);
+            result = status == 0 && rv == 0 ? 0 : 2;
+            return;
         }
-        std::string token = get_token();
-        std::string recipient = char_to_escaped(argv[++optind]);
-        std::string subject = char_to_escaped(argv[++optind]);
-        std::string body = char_to_escaped(argv[++optind]);
-        msg += command + " " + token + " \"" + recipient + "\" \"" + subject + "\" \"" + body + "\")";
-
-    } else {
-        fprintf(stderr, "Invalid command. See --help.\n");
-        return "";
+        if (status == 0 || (status == 2 && reply != "")) {
+            std::string terminal = terminal_response(reply, command);
+            printf("%s\n", terminal.c_str());
+            fflush(stdout);
+            result = status == 0 && terminal != "" ? 0 : 2;
+            return;
+        }
+        result = status;
+    };
+    if (cache != NULL && id > 0) {
+        cache_reply(request, *cache, id);
     }
-    return msg;
+    return request;
 }
 
-std::string terminal_response(std::string server_response, std::string command) {
-    std::string message, token;
-    bool ok = false;
-    std::vector<std::string> response_array;
-
-    //* get response state
-    std::string state = server_response.substr(0, server_response.find(' '));
-    server_response.erase(0, server_response.find(' '));
-    if (state == "(ok") {
-        message += "SUCCESS: ";
-        ok = true;
-    } else if (state == "(err") {
-        message += "ERROR: ";
-    } else {
-        fprintf(stderr, "Invalid server response.\n");
-        return "";
-    }
-    
-    //* get response according to the command
-    if (command == "list") {
-        //* get all parts of response as an array
-        response_array = split_response(server_response, true);
-        if (!ok) {
-            message += response_array[0];
-            return message;
-        }
-        message += "\n";
-        //* print all messages
-        int msg_index = 1;
-        for (int i = 1; i < (int)response_array.size(); i+=2) {
-            message += std::to_string(msg_index) + ":\n"; // message index
-            message += "  From: " + response_array[i] + "\n"; // sender
-            message += "  Subject: " + response_array[i+1] + "\n"; // subject
-            msg_index++;
-        }
-    } else if (command == "fetch") {
-        //* get all parts of response as an array
-        response_array = split_response(server_response, true);
-        if (!ok) {
-            message += response_array[0];
-            return message;
-        }
-        message += "\n\nFrom: " + response_array[0] + "\n"; // sender
-        message += "Subject: " + response_array[1] + "\n\n"; // subject
-        message += response_array[2]; // message
-    } else {
-        //* get all parts of response as an array
-        response_array = split_response(server_response, false);
-        if (response_array.size() < 1) {
-            fprintf(stderr, "Invalid server response.\n");
-            return "";
-        }
-        message += response_array[0];
+std::shared_ptr<s_decoder> stream_decoder(e_layout layout) {
+    std::shared_ptr<s_decoder> decoder = std::make_shared<s_decoder>();
+    s_decoder *state = decoder.get();
+
+    //* print the parts of the response in the same form as terminal_response, the fields are decoded
+    //* whole (as they are cached) and a newline is printed as it was sent
+    decoder->newlines = true;
+    if (layout == REPLY_MESSAGE) {
+        decoder->stream_field = COMMAND_BODY_FIELD; // message body
     }
+    decoder->on_state = [layout](bool ok) {
+        fputs(ok ? "SUCCESS: " : "ERROR: ", stdout);
+        if (ok && layout == REPLY_LIST) {
+            fputs("\n", stdout);
+        }
+    };
+    decoder->on_field = [layout, state, field_index = (size_t)0, msg_index = 1](std::string_view field) mutable {
+        if (state->state == 1 && layout == REPLY_LIST) {
+            if (field_index % 2 == 0) {
+                printf("%d:\n  From: ", msg_index++); // message index, sender
+            } else {
+                fputs("  Subject: ", stdout); // subject
+            }
+            print_text(field);
+            fputs("\n", stdout);
+        } else if (state->state == 1 && layout == REPLY_MESSAGE) {
+            fputs(field_index == 0 ? "\n\nFrom: " : "Subject: ", stdout); // sender, subject
+            print_text(field);
+            fputs(field_index == 0 ? "\n" : "\n\n", stdout);
+        } else if (field_index == 0) {
+            print_text(field);
+        }
+        field_index++;
+    };
+    decoder->on_body = [](std::string_view part) {
+        print_text(part); // message
+    };
+    return decoder;
+}
+
+void print_text(std::string_view text) {
+    size_t start = 0, end;
 
-    //* resolve login token
-    if (response_array.size() > 1) {
-        token = response_array[1];
+    while ((end = text.find('\n', start)) != std::string_view::npos) {
+        fwrite(text.data() + start, 1, end - start, stdout);
+        fputs("\\n", stdout);
+        start = end + 1;
     }
-    if (resolve_tokens(ok, command, token) != 0) {
-        return "";
+    fwrite(text.data() + start, 1, text.size() - start, stdout);
+}
+
+long message_id(std::string id) {
+    //! only plain positive numbers are cached
+    if (id.empty() || id.size() > 9 || id.find_first_not_of("0123456789") != std::string::npos) {
+        return 0;
     }
-    
-    return message;
+    return atol(id.c_str());
 }
 
-std::vector<std::string> split_response(std::string server_response, bool list_fetch) {
-    size_t pos = 0;
-    std::string substring;
-    std::vector<std::string> response_array {};
-    server_response.pop_back(); // erase )
+long fetched_id(const std::vector<std::string> &words) {
+    return words.size() == 2 && words[0] == "fetch" ? message_id(words[1]) : 0;
+}
 
-    server_response = escaped_to_special(server_response);
+int resolve_cached(struct addrinfo **server_info) {
+    struct in6_addr numeric;
+    std::vector<std::string> addresses;
 
-    while ((pos = server_response.find(" \"")) != std::string::npos) {
-        substring = server_response.substr(0, pos);
-        if (substring != "") {
-            substring.pop_back(); // erase the '"' at the end
-            response_array.push_back(substring);
+    //* literal addresses need no lookup
+    if (args.dns_ttl == 0 || inet_pton(AF_INET, args.addr.c_str(), &numeric) == 1 || inet_pton(AF_INET6, args.addr.c_str(), &numeric) == 1) {
+        return resolve_server(server_info);
+    }
+    std::string path = cache_path(args.cache_dir, "addresses", args.addr + ":" + args.port);
+    if (cache_addresses_load(path, addresses) == 0) {
+        *server_info = NULL;
+        for (auto address = addresses.rbegin(); address != addresses.rend(); address++) {
+            *server_info = server_address((const struct sockaddr *)address->data(), address->size(), *server_info);
         }
-        server_response.erase(0, pos + 2); // 2 characters as delimiter
+        cached_addresses = path;
+        return 0;
+    }
+    if (resolve_server(server_info) != 0) {
+        return 1;
+    }
+    for (struct addrinfo *p = *server_info; p != NULL; p = p->ai_next) {
+        addresses.emplace_back((const char *)p->ai_addr, p->ai_addrlen);
     }
-    server_response.pop_back(); // erase the quote at the end
-    response_array.push_back(server_response);
+    cache_addresses_save(path, addresses, args.dns_ttl);
+    return 0;
+}
 
-    std::regex list_fetch01 ("\"\\)( )?(\\()?[0-9]*$");
-    std::regex list_fetch02 ("^( )*(\\()?(\")?");
+int agent_probe(std::string path) {
+    struct sockaddr_un addr;
+    socklen_t addrlen = agent_address(path, addr);
 
-    for (int i = 0; i < (int)response_array.size(); i++) {
-        response_array[i] = special_to_char(response_array[i]);
-        if (list_fetch) {
-            response_array[i] = std::regex_replace(response_array[i], list_fetch01, "");
-            response_array[i] = std::regex_replace(response_array[i], list_fetch02, "");
-        }
+    if (addrlen == 0) {
+        return 1;
     }
-
-    return response_array;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return 1;
+    }
+    int rv = connect(fd, (struct sockaddr *)&addr, addrlen) == 0 ? 0 : 1;
+    close(fd);
+    return rv;
 }
 
-std::string replace_all(std::string msg, std::string replaced, std::string replace) {
-    size_t index = 0;
-    while((index = msg.find(replaced, index)) != std::string::npos) {
-        msg.replace(index, replaced.size(), replace);
-        index += replace.size();
+int open_engine(s_engine &engine, struct addrinfo **server_info) {
+    struct sockaddr_un addr;
+
+    //* the agent is connected to instead of the server, it needs no lookup
+    if (args.agent != "") {
+        *server_info = server_address((struct sockaddr *)&addr, agent_address(args.agent, addr), NULL);
+    } else if (resolve_cached(server_info) != 0) {
+        return 1;
+    }
+    if (engine_init(engine, *server_info) != 0) {
+        free_server(*server_info);
+        return 2;
     }
-    return msg;
+    engine.connect_timeout = args.connect_timeout;
+    engine.read_timeout = args.read_timeout;
+    engine.write_timeout = args.write_timeout;
+    engine.deadline = args.deadline > 0 ? engine_now() + args.deadline : 0;
+    if (args.agent != "") {
+        engine.envelope = "(agent \"" + char_to_escaped(args.addr) + "\" \"" + char_to_escaped(args.port) + "\" \"" + char_to_escaped(args.user) + "\") ";
+    }
+    return 0;
 }
 
-std::string escaped_to_special(std::string input_msg) {
-    input_msg = replace_all(input_msg, "\\\\", "<char92>");
-    input_msg = replace_all(input_msg, "\\\"", "<char34>");
-    input_msg = replace_all(input_msg, "\n", "<char10>");
-    return input_msg;
+void report_failure(int status) {
+    if (status == 3) {
+        fprintf(stderr, "Client failed to connect to the server.\n");
+        //* the server may have moved, it is resolved again next time
+        if (cached_addresses != "") {
+            unlink(cached_addresses.c_str());
+        }
+    } else if (status == 4) {
+        fprintf(stderr, "The server did not answer in time.\n");
+    } else if (status == 1) {
+        fprintf(stderr, "Connection closed before the reply.\n");
+    }
 }
 
-std::string special_to_char(std::string input_msg) {
-    input_msg = replace_all(input_msg, "<char92>", "\\");
-    input_msg = replace_all(input_msg, "<char34>", "\"");
-    input_msg = replace_all(input_msg, "<char10>", "\n");
-    return input_msg;
+int open_cache(s_cache &cache) {
+    if (args.cache == 0) {
+        return 1;
+    }
+    //* the user is known from the last login
+    std::string user = get_user();
+    if (user == "") {
+        return 1;
+    }
+    return cache_open(cache, cache_path(args.cache_dir, args.addr + ":" + args.port, user));
 }
 
-std::string char_to_escaped(std::string input_msg) {
-    input_msg = replace_all(input_msg, "\\", "\\\\");
-    input_msg = replace_all(input_msg, "\"", "\\\"");
-    input_msg = replace_all(input_msg, "\n", "\\n");
-    return input_msg;
+std::string cached_response(const s_cached_message &cached) {
+    //* the fields are cached decoded, a newline is shown as it was sent
+    std::string message = "SUCCESS: \n\nFrom: ";
+    message += replace_all(std::string(cached.sender), "\n", "\\n");
+    message += "\nSubject: ";
+    message += replace_all(std::string(cached.subject), "\n", "\\n");
+    message += "\n\n";
+    message += replace_all(std::string(cached.body), "\n", "\\n");
+    return message;
 }
 
-int resolve_tokens(bool state, std::string command, std::string token) {
-    if (state) {
-        if (command == "login") {
-            if (set_token(token) != 0) {
-                return 1;
+void cache_reply(s_engine_request &request, s_cache &cache, long id) {
+    std::shared_ptr<s_fetched> fetched = std::make_shared<s_fetched>();
+    std::shared_ptr<s_decoder> decoder = request.decoder;
+
+    //* streamed fields are copied as they are printed
+    if (decoder) {
+        s_decoder *state = decoder.get();
+        auto on_field = decoder->on_field;
+        auto on_body = decoder->on_body;
+        decoder->on_field = [on_field, state, fetched](std::string_view field) {
+            if (state->state == 1 && state->field_count < 2) {
+                (state->field_count == 0 ? fetched->sender : fetched->subject) = field;
             }
-        } else if (command == "logout") {
-            //* remove file with current user's token
-            std::remove("login-token");
-        }
+            on_field(field);
+        };
+        decoder->on_body = [on_body, fetched](std::string_view part) {
+            if (fetched->body.size() + part.size() <= CACHE_MAX_RECORD) {
+                fetched->body.append(part);
+            } else {
+                fetched->too_large = true;
+            }
+            on_body(part);
+        };
     }
-    return 0;
-}
 
-int set_token(std::string token) {
-    std::ofstream file("login-token"); //* write mode
-    if (file.fail()) {
-        fprintf(stderr, "Error while saving the login token.\n");
-        return 1;
-    }
-    file << "\"" << token << "\"";
-    file.close();
-    return 0;
-}
+    auto on_done = request.on_done;
+    request.on_done = [on_done, decoder, fetched, &cache, id](int status, std::string reply) {
+        s_reply parsed;
+        s_cached_message cached;
 
-std::string get_token() {
-    std::string token;
-    std::ifstream file("login-token"); //* read mode
-    if (file.fail()) {
-        printf("Not logged in.\n");
-        return "\"\"";
-    }
-    file >> token;
-    file.close();
-    if (token == "") { token = "\"\""; };
-    return token;
+        on_done(status, reply);
+        //* only complete successful replies are stored
+        if (status != 0) {
+            return;
+        }
+        if (decoder && (decoder->state != 1 || decoder->field_count < 3 || fetched->too_large)) {
+            return;
+        }
+        if (!decoder) {
+            parsed.newlines = true;
+            if (parse_response(reply, parsed) != 0 || !parsed.ok || parsed.fields.size() < 3) {
+                return;
+            }
+            fetched->sender = parsed.fields[0];
+            fetched->subject = parsed.fields[1];
+            fetched->body = parsed.fields[2];
+        }
+        //* verified copies are replaced if they differ
+        if (cache_get(cache, id, cached) == 0) {
+            if (cached.sender == fetched->sender && cached.subject == fetched->subject && cached.body == fetched->body) {
+                return;
+            }
+            fprintf(stderr, "Cached message %ld differs from the server, the cache is updated.\n", id);
+        }
+        cache_put(cache, id, fetched->sender, fetched->subject, fetched->body);
+    };
 }
@@ -6,40 +6,35 @@
  * 
  **/
 
-#include <getopt.h>
-#include <cstdio>
-#include <iostream>
-#include <set>
-#include <cstring>
-#include <string>
-#include <fstream> // files
-#include <regex>
-#include <unistd.h>
-#include "base64.h"
-
-// https://support.sas.com/documentation/onlinedoc/sasc/doc/lr2/lrv2ch15.htm
-#include <sys/types.h>
-#include <sys/uio.h>
-#include <errno.h>
-#include <sys/ioctl.h>
-#include <fcntl.h>
-#include <sys/socket.h>
-#include <netdb.h>
-#include <netinet/in_systm.h>
-#include <netinet/ip_icmp.h>
-#include <netinet/udp.h>
-#include <netinet/ip.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <arpa/nameser.h>
-#include <resolv.h>
-#include <net/if.h>
-
-
-struct s_args {
-    std::string addr = "127.0.0.1";
-    std::string port = "32323";
-} args;
+#include "engine.h"
+#include "cache.h"
+#include "record.h"
+#include "retry.h"
+
+#define FETCH_WINDOW 16 // max requests in flight on one connection when fetching several messages
+#define FETCH_MAX_IDS 1000000 // max number of message ids fetched by one command
+
+struct s_fetch {
+    std::vector<std::pair<long, long>> ranges; // requested message ids as ranges (from, to), in the given order
+    size_t count = 0; // number of requested message ids
+    size_t range = 0; // range of the next id to request
+    long offset = 0; // offset of the next id to request in its range
+    char *program = NULL; // program name, passed to get_message
+    std::deque<std::string> output; // responses from the first position not completed on, kept until printed in order
+    std::deque<bool> done; // response received, by the same positions
+    std::deque<bool> fetched; // message printed (not failed), by the same positions
+    size_t base = 0; // position of the front of output, done and fetched
+    size_t next = 0; // position of the next id to request
+    size_t printed = 0; // positions printed so far, in order unless unordered
+    size_t synced = 0; // positions fetched from the first one on without a gap
+    bool gap = false; // a message could not be fetched, the following ones are not synced
+    size_t failed = 0; // messages that could not be fetched
+    std::vector<std::string> errors; // error messages collected while fetching
+    std::vector<int> idle; // connections waiting for the ordered output to catch up
+    s_cache cache; // fetched messages cache of the user
+    std::vector<uint32_t> fingerprints; // listed sender and subject by position when syncing, a cached copy must match
+    bool unreachable = false; // the server could not be connected to, no more requests are sent
+};
 
 /**
  * Parse command line arguments.
@@ -54,93 +49,223 @@ void parseargs(int argc, char** argv);
 void p_help();
 
 /**
- * Send data to the server.
- * @param message Input message.
- * @param sockfd Network socket.
+ * Resolve the server address, the addresses are cached for the DNS TTL given by the arguments.
+ * @param server_info Server addresses in the order they are tried, freed by the caller with free_server.
  * @return 1 if an error occurs, else 0.
  */
-int send_data(std::string message, int sockfd);
+int resolve_cached(struct addrinfo **server_info);
+
+/**
+ * Check whether the agent is running.
+ * @param path Socket of the agent.
+ * @return 1 if it cannot be connected to, else 0.
+ */
+int agent_probe(std::string path);
+
+/**
+ * Resolve the server (or use the agent if it is running) and set up the engine with the timeouts given by the arguments.
+ * @param engine Client engine.
+ * @param server_info Server addresses, freed by the caller with free_server after engine_free.
+ * @return 1 if the server cannot be resolved, 2 if the engine cannot be set up, else 0.
+ */
+int open_engine(s_engine &engine, struct addrinfo **server_info);
 
 /**
- * Receive data from the server.
- * @param sockfd Network socket.
- * @return Empty string if an error occurs, else the server output message.
+ * Report a request that failed without a reply.
+ * @param status Completion status of the engine (1, 3 or 4), 3 (not connected) forgets the cached addresses.
  */
-std::string receive_data(int sockfd);
+void report_failure(int status);
 
 /**
- * Build the request that is sent to the server according to the program arguments.
+ * Fetch several messages over a pool of connections and print them in order (or as they complete),
+ * or sync the messages added since the last sync.
  * @param argc Number of arguments.
  * @param argv Array of arguments.
- * @param command The current command.
- * @return Server input message.
+ * @return 1 if the message ids are invalid, 2 if any message could not be fetched, else 0.
+ */
+int run_fetch(int argc, char** argv);
+
+/**
+ * Parse the message ids of fetch, a comma separated list of ids and ranges (e.g. 1-5,9).
+ * @param spec Message ids.
+ * @param ranges Parsed ranges of message ids (from, to), in the given order.
+ * @param count Number of message ids, increased.
+ * @return 1 if the ids are invalid, 2 if there are more than FETCH_MAX_IDS of them, else 0.
+ */
+int parse_ids(std::string spec, std::vector<std::pair<long, long>> &ranges, size_t &count);
+
+/**
+ * Request the next messages over the connection until its window is full.
+ * @param engine Client engine.
+ * @param conn Index of the connection.
+ * @param fetch Fetch state.
+ * @param window Max requests in flight on the connection.
+ */
+void fetch_next(s_engine &engine, int conn, s_fetch &fetch, size_t window);
+
+/**
+ * Store or print the response of one message.
+ * @param fetch Fetch state.
+ * @param position Position of the message id.
+ * @param output Printed response, empty if the message could not be fetched.
+ */
+void fetch_done(s_fetch &fetch, size_t position, std::string output);
+
+struct s_bulk {
+    std::istream *input = NULL; // records to send
+    int format = RECORD_CSV; // format of the records
+    std::string token = ""; // login token, read once
+    size_t read = 0; // records read so far, the number of the last one
+    size_t sent = 0; // messages sent
+    size_t failed = 0; // records that could not be sent
+    bool end = false; // all records were read
+    bool unreachable = false; // the server could not be connected to, no more records are read
+};
+
+/**
+ * Send the messages of the records read from a file or stdin over a pool of connections,
+ * writing the result of each record as it completes.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return 1 if the input cannot be opened, 2 if any record could not be sent, else 0.
  */
-std::string get_message(int argc, char** argv, std::string command);
+int run_send_batch(int argc, char** argv);
 
 /**
- * Perform actions according to the server response and build the printed response.
- * @param server_response The response sent by server.
+ * Read and send the next records over the connection until its window is full.
+ * @param engine Client engine.
+ * @param conn Index of the connection.
+ * @param bulk Bulk send state.
+ * @param window Max requests in flight on the connection.
+ */
+void bulk_next(s_engine &engine, int conn, s_bulk &bulk, size_t window);
+
+/**
+ * Write the result of one record.
+ * @param id Number of the record.
+ * @param ok The message was sent.
+ * @param text Reply or error message.
+ */
+void bulk_result(size_t id, bool ok, std::string_view text);
+
+struct s_fetched {
+    std::string sender = ""; // unescaped fields of the fetched message
+    std::string subject = "";
+    std::string body = "";
+    bool too_large = false; // the message is not cached
+};
+
+/**
+ * Run commands read from a script file or stdin, one command per line.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return 1 or 2 if any of the commands failed, else 0.
+ */
+int run_session(int argc, char** argv);
+
+/**
+ * Run commands read from a script file or stdin, sending the requests back to back.
+ * Requests following login or logout are sent once their reply is resolved.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @return 1 or 2 if any of the commands failed, else 0.
+ */
+int run_batch(int argc, char** argv);
+
+/**
+ * Open the script given as the command argument.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @param script File stream used if the script file is given.
+ * @return Script stream, stdin if no file is given, or NULL if an error occurs.
+ */
+std::istream *open_script(int argc, char** argv, std::ifstream &script);
+
+/**
+ * Build the request for one script line.
+ * @param words Command and its arguments.
+ * @param program Program name.
+ * @return Server input message, or empty string if an error occurs.
+ */
+std::string get_line_message(std::vector<std::string> &words, char *program);
+
+/**
+ * Split a session line to words, honouring quotes and backslash escapes.
+ * @param line Session line.
+ * @return Array of words.
+ */
+std::vector<std::string> split_command_line(std::string line);
+
+/**
+ * Submit the request, its reply is printed once received and login tokens are resolved.
+ * Read-only requests are retried and hedged as given by the arguments.
+ * @param engine Client engine.
+ * @param conn Index of the connection.
+ * @param message Server input message.
  * @param command The current command.
- * @return Parsed server response.
+ * @param result Set to 0 if the reply was printed, 1 if the connection was closed before the reply,
+ *               3 if the connection could not be established, else 2.
+ * @param cache Cache the fetched message is stored in, NULL if it is not cached.
+ * @param id Message id of fetch, also written into its record by the machine-readable formats.
  */
-std::string terminal_response(std::string server_response, std::string command);
+void submit_request(s_engine &engine, int conn, s_message message, std::string command, int &result, s_cache *cache, long id);
 
 /**
- * Parse the server response to individual parts of the message.
- * @param server_response The response sent by server.
- * @param list_fetch True if current command is "fetch" or "list".
- * @return Array of strings (parsed parts of the message).
+ * Build the request of a command, its reply is printed once received and login tokens are resolved.
+ * @param message Server input message.
+ * @param command The current command.
+ * @param result Set as by submit_request.
+ * @param cache Cache the fetched message is stored in, NULL if it is not cached.
+ * @param id Message id of fetch.
+ * @return Request to be submitted.
  */
-std::vector<std::string> split_response(std::string server_response, bool list_fetch);
+s_engine_request command_request(s_message message, std::string command, int &result, s_cache *cache, long id);
 
 /**
- * Replace all occurrences of a substring.
- * @param msg String.
- * @param replaced Substring that is being replaced.
- * @param replace String replacing the substring.
- * @return Edited string.
+ * Create a decoder printing the parts of the reply as soon as they are decoded, the message body is not buffered.
+ * @param layout Layout of the ok reply of the command (REPLY_LIST or REPLY_MESSAGE).
+ * @return Decoder with the printing callbacks.
  */
-std::string replace_all(std::string msg, std::string replaced, std::string replace);
+std::shared_ptr<s_decoder> stream_decoder(e_layout layout);
 
 /**
- * Change escaped characters to special form. For later message parsing purposes.
- * @param input_msg String.
- * @return Edited string.
+ * Print a decoded field as terminal_response shows it, a newline as the escape sequence it was sent as.
+ * @param text Decoded field or a part of it.
  */
-std::string escaped_to_special(std::string input_msg);
+void print_text(std::string_view text);
 
 /**
- * Change special form back to unescaped characters.
- * @param input_msg String.
- * @return Edited string.
+ * Get the message id if it can be cached.
+ * @param id Message id argument.
+ * @return Message id, or 0 if it is not a plain number.
  */
-std::string special_to_char(std::string input_msg);
+long message_id(std::string id);
 
 /**
- * Escape special characters.
- * @param input_msg String.
- * @return Edited string.
+ * Get the message id of a fetch script line.
+ * @param words Command and its arguments.
+ * @return Message id, or 0 if the line is not a fetch of a plain number.
  */
-std::string char_to_escaped(std::string input_msg);
+long fetched_id(const std::vector<std::string> &words);
 
 /**
- * Perform various token actions.
- * @param state True if server response was success.
- * @param command Current command.
- * @param token Token string.
- * @return 1 if an error occurs, else 0.
+ * Open the fetched messages cache of the logged in user on the server.
+ * @param cache Cache state.
+ * @return 1 if the cache is not used or an error occurs, else 0.
  */
-int resolve_tokens(bool state, std::string command, std::string token);
+int open_cache(s_cache &cache);
 
 /**
- * Write token into the file.
- * @param token Token string.
- * @return 1 if an error occurs, else 0.
+ * Build the printed response of a cached message, the same as terminal_response.
+ * @param cached Cached message.
+ * @return Printed response.
  */
-int set_token(std::string token);
+std::string cached_response(const s_cached_message &cached);
 
 /**
- * Read token from file.
- * @return Token string.
+ * Store the fetched message in the cache once the request completes.
+ * @param request Fetch request, its callbacks are wrapped.
+ * @param cache Cache of the user.
+ * @param id Message id.
  */
-std::string get_token();
+void cache_reply(s_engine_request &request, s_cache &cache, long id);
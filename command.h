@@ -0,0 +1,156 @@
+/**
+ * @file command.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - protocol command table.
+ *
+ * Each command is one entry of command_table: the arguments of its request in the order they
+ * are sent and the layout of its ok reply. The request encoders and the reply formatters are
+ * instantiated per entry from the table (request.cpp) and the names are looked up with a
+ * perfect hash computed at compile time, so a new command is a new entry.
+ **/
+
+#ifndef _COMMAND_H_
+#define _COMMAND_H_
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
+
+#define COMMAND_MAX_ARGS 4 // max number of arguments of a request
+#define COMMAND_SLOTS 16 // slots of the name hash table, a power of two above the number of commands
+
+enum e_arg : uint8_t {
+    ARG_STRING, // quoted escaped string
+    ARG_BASE64, // quoted base64 encoded string (password)
+    ARG_TOKEN, // login token of the session, not given by the user
+    ARG_INTEGER, // number sent as it is (message id)
+    ARG_BODY, // quoted escaped string that may be streamed from a file instead (message body)
+};
+
+enum e_layout : uint8_t {
+    REPLY_TEXT, // message of the server
+    REPLY_LIST, // pairs of sender and subject
+    REPLY_MESSAGE, // sender, subject and body
+};
+
+enum e_effect : uint8_t {
+    EFFECT_NONE,
+    EFFECT_LOGIN, // the first argument is the user, the second field of the reply is the new token
+    EFFECT_LOGOUT, // the token is dropped
+};
+
+struct s_command {
+    std::string_view name;
+    std::array<e_arg, COMMAND_MAX_ARGS> args; // arguments in the order they are sent
+    size_t count; // number of arguments
+    e_layout layout; // layout of the ok reply, an error reply is always a message
+    e_effect effect; // effect on the login token
+    bool read_only; // the request changes nothing on the server, it may be retried and hedged
+
+    constexpr s_command(std::string_view name, std::initializer_list<e_arg> list, e_layout layout, e_effect effect = EFFECT_NONE, bool read_only = false)
+        : name(name), args(), count(0), layout(layout), effect(effect), read_only(read_only) {
+        for (e_arg arg : list) {
+            args[count++] = arg;
+        }
+    }
+
+    /**
+     * Number of arguments given by the user, the token is added by the client.
+     */
+    constexpr size_t user_args() const {
+        size_t user = 0;
+        for (size_t i = 0; i < count; i++) {
+            user += args[i] != ARG_TOKEN;
+        }
+        return user;
+    }
+
+    /**
+     * Whether the request carries the login token.
+     */
+    constexpr bool uses_token() const {
+        return user_args() != count;
+    }
+};
+
+constexpr s_command command_table[] = {
+    {"register", {ARG_STRING, ARG_BASE64}, REPLY_TEXT},
+    {"login", {ARG_STRING, ARG_BASE64}, REPLY_TEXT, EFFECT_LOGIN},
+    {"list", {ARG_TOKEN}, REPLY_LIST, EFFECT_NONE, true},
+    {"send", {ARG_TOKEN, ARG_STRING, ARG_STRING, ARG_BODY}, REPLY_TEXT},
+    {"fetch", {ARG_TOKEN, ARG_INTEGER}, REPLY_MESSAGE, EFFECT_NONE, true},
+    {"logout", {ARG_TOKEN}, REPLY_TEXT, EFFECT_LOGOUT},
+};
+constexpr size_t COMMAND_COUNT = sizeof command_table / sizeof command_table[0];
+constexpr size_t COMMAND_BODY_FIELD = 2; // field of a REPLY_MESSAGE reply holding the body
+
+/**
+ * Hash a command name into a slot.
+ * @param name Command name.
+ * @param seed Seed of the hash.
+ * @return Slot.
+ */
+constexpr size_t command_hash(std::string_view name, uint32_t seed) {
+    uint32_t hash = seed;
+    for (char c : name) {
+        hash = (hash ^ (unsigned char)c) * 16777619u;
+    }
+    return (hash >> 16) & (COMMAND_SLOTS - 1);
+}
+
+/**
+ * Find the first seed that puts every command into its own slot.
+ * @return Seed, 0 if there is none.
+ */
+constexpr uint32_t command_find_seed() {
+    for (uint32_t seed = 1; seed < 1000; seed++) {
+        bool used[COMMAND_SLOTS] = {};
+        bool unique = true;
+        for (const s_command &command : command_table) {
+            size_t slot = command_hash(command.name, seed);
+            unique = unique && !used[slot];
+            used[slot] = true;
+        }
+        if (unique) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+constexpr uint32_t COMMAND_SEED = command_find_seed();
+static_assert(COMMAND_SEED != 0, "no perfect hash of the command names, raise COMMAND_SLOTS");
+
+/**
+ * Build the slots of the name hash table.
+ * @return Index of the command in command_table by slot, -1 for an empty slot.
+ */
+constexpr std::array<int8_t, COMMAND_SLOTS> command_build_slots() {
+    std::array<int8_t, COMMAND_SLOTS> slots = {};
+    for (size_t i = 0; i < COMMAND_SLOTS; i++) {
+        slots[i] = -1;
+    }
+    for (size_t i = 0; i < COMMAND_COUNT; i++) {
+        slots[command_hash(command_table[i].name, COMMAND_SEED)] = i;
+    }
+    return slots;
+}
+
+constexpr std::array<int8_t, COMMAND_SLOTS> command_slots = command_build_slots();
+
+/**
+ * Look up a command by its name.
+ * @param name Command name.
+ * @return Index in command_table, -1 if the command is unknown.
+ */
+constexpr int find_command(std::string_view name) {
+    int index = command_slots[command_hash(name, COMMAND_SEED)];
+    return index != -1 && command_table[index].name == name ? index : -1;
+}
+
+static_assert(find_command("fetch") == 4 && find_command("fetc") == -1, "command lookup");
+
+#endif /* _COMMAND_H_ */
@@ -0,0 +1,717 @@
+/**
+ * @file engine.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - event-driven client engine.
+ *
+ * All connections use non-blocking sockets served by one epoll loop. Each connection goes
+ * through connect -> send -> receive -> parse for its queued requests, the requests are
+ * written back to back and the replies are matched in order, the completion callback of
+ * a request is called once its reply is framed (or decoded while it is received).
+ *
+ * Connecting follows RFC 8305 (happy eyeballs): the addresses alternate between the address
+ * families, the next one is tried in parallel once the previous ones did not connect within
+ * the attempt delay (or failed), and the first connection established is kept. The connect,
+ * write and read timeouts are deadlines of the connections checked by the poll loop, together
+ * with the timers and the deadline of the whole command.
+ */
+
+#include "engine.h"
+
+int engine_init(s_engine &engine, struct addrinfo *server_info) {
+    engine.server_info = server_info;
+    if ((engine.epfd = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        perror("epoll_create1");
+        return 1;
+    }
+    return 0;
+}
+
+void engine_free(s_engine &engine) {
+    for (auto &conn : engine.conns) {
+        engine_cancel(conn);
+        if (conn.fd != -1) {
+            close(conn.fd);
+            conn.fd = -1;
+        }
+    }
+    if (engine.wakefd != -1) {
+        close(engine.wakefd);
+        engine.wakefd = -1;
+    }
+    if (engine.epfd != -1) {
+        close(engine.epfd);
+        engine.epfd = -1;
+    }
+}
+
+int engine_waker(s_engine &engine, std::function<void()> on_wake) {
+    struct epoll_event event;
+
+    if ((engine.wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+        perror("eventfd");
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.u64 = ENGINE_WAKE;
+    if (epoll_ctl(engine.epfd, EPOLL_CTL_ADD, engine.wakefd, &event) == -1) {
+        perror("epoll_ctl");
+        close(engine.wakefd);
+        engine.wakefd = -1;
+        return 1;
+    }
+    engine.on_wake = on_wake;
+    return 0;
+}
+
+void engine_wake(s_engine &engine) {
+    uint64_t one = 1;
+
+    //* the counter only has to become nonzero, a full counter is already a wake-up
+    if (write(engine.wakefd, &one, sizeof one) == -1 && errno != EAGAIN) {
+        perror("eventfd");
+    }
+}
+
+int engine_open(s_engine &engine) {
+    engine.conns.emplace_back();
+    return engine.conns.size() - 1;
+}
+
+void engine_submit(s_engine &engine, int index, s_engine_request request) {
+    s_engine_conn &conn = engine.conns[index];
+
+    //* an idle kept connection may have been closed by the server meanwhile
+    if (conn.fd != -1 && !conn.connecting && conn.queue.empty() && connection_closed(conn.fd)) {
+        engine_closed(engine, index, 1);
+    }
+    if (trace_fd != -1 && !request.trace && !request.message.parts.empty()) {
+        request.trace = trace_begin(message_part(request.message, 0));
+        request.trace->reused = conn.fd != -1;
+    }
+    if (engine.envelope != "") {
+        message_prepend(request.message, engine.envelope);
+    }
+    conn.queue.push_back(std::move(request));
+    engine.pending++;
+
+    if (conn.fd == -1 && !conn.connecting) {
+        if (engine_connect(engine, index) != 0) {
+            engine_closed(engine, index, 3);
+        }
+    } else {
+        engine_write(engine, index);
+    }
+}
+
+void engine_after(s_engine &engine, int delay, bool hold, std::function<void()> fire) {
+    engine.timers.push_back({engine_now() + std::max(delay, 0), hold, std::move(fire)});
+    if (hold) {
+        engine.held++;
+    }
+}
+
+int engine_run(s_engine &engine) {
+    while (engine.pending > engine.detached || engine.held > 0) {
+        if (engine_poll(engine, -1) != 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int engine_timeout(const s_engine &engine, int timeout) {
+    //* wake up for the nearest deadline
+    if (engine.timed > 0) {
+        uint64_t now = engine_now(), nearest = UINT64_MAX;
+        for (const auto &conn : engine.conns) {
+            if (conn.deadline != 0) {
+                nearest = std::min(nearest, conn.deadline);
+            }
+        }
+        int wait = nearest <= now ? 0 : (int)std::min<uint64_t>(nearest - now, INT_MAX);
+        if (timeout == -1 || wait < timeout) {
+            timeout = wait;
+        }
+    }
+    if (!engine.timers.empty() || (engine.deadline != 0 && engine.pending > 0)) {
+        uint64_t now = engine_now(), nearest = engine.pending > 0 && engine.deadline != 0 ? engine.deadline : UINT64_MAX;
+        for (const auto &timer : engine.timers) {
+            nearest = std::min(nearest, timer.due);
+        }
+        int wait = nearest <= now ? 0 : (int)std::min<uint64_t>(nearest - now, INT_MAX);
+        if (timeout == -1 || wait < timeout) {
+            timeout = wait;
+        }
+    }
+    return timeout;
+}
+
+int engine_poll(s_engine &engine, int timeout) {
+    struct epoll_event events[ENGINE_MAXEVENTS];
+
+    int count = epoll_wait(engine.epfd, events, ENGINE_MAXEVENTS, engine_timeout(engine, timeout));
+    if (count == -1) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        perror("epoll_wait");
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (events[i].data.u64 == ENGINE_WAKE) {
+            uint64_t wakes;
+            if (read(engine.wakefd, &wakes, sizeof wakes) == sizeof wakes) {
+                engine.on_wake();
+            }
+            continue;
+        }
+        int index = events[i].data.u64 & 0xffffffff;
+        uint32_t generation = events[i].data.u64 >> 32;
+        uint32_t flags = events[i].events;
+        if (engine.conns[index].connecting) {
+            engine_connected(engine, index, generation);
+            continue;
+        }
+        //! events of a socket closed while handling the previous events
+        if (engine.conns[index].fd == -1 || engine.conns[index].generation != generation) {
+            continue;
+        }
+        if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            engine_read(engine, index);
+        }
+        if ((flags & EPOLLOUT) && engine.conns[index].fd != -1 && engine.conns[index].generation == generation) {
+            engine_write(engine, index);
+        }
+    }
+    if (engine.timed > 0) {
+        engine_expire(engine);
+    }
+    if (!engine.timers.empty() || (engine.deadline != 0 && engine.pending > 0)) {
+        engine_fire(engine);
+    }
+    return 0;
+}
+
+/**
+ * Parts of the following code (network connection setup) were taken over from the "Beej's Guide to Network Programming" and edited accordingly.
+ * The C source code presented in this document is granted to the public domain, and is completely free of any license restriction.
+ * https://beej.us/guide/bgnet/html/
+**/
+int engine_connect(s_engine &engine, int index) {
+    s_engine_conn &conn = engine.conns[index];
+
+    conn.addr = NULL;
+    conn.connect_deadline = engine.connect_timeout > 0 ? engine_now() + engine.connect_timeout : 0;
+    for (auto &request : conn.queue) {
+        if (request.trace) {
+            trace_mark(request.trace->connect);
+        }
+    }
+    return engine_attempt(engine, index);
+}
+
+int engine_attempt(s_engine &engine, int index) {
+    s_engine_conn &conn = engine.conns[index];
+    int sockfd;
+
+    //* loop through the remaining results and start connecting to the first we can
+    for (conn.addr = conn.addr == NULL ? engine.server_info : conn.addr->ai_next; conn.addr != NULL; conn.addr = conn.addr->ai_next) {
+        struct addrinfo *p = conn.addr;
+        sockfd = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, p->ai_protocol);
+        //* invalid socket, check next list value
+        if (sockfd == -1) {
+            perror("client: socket");
+            continue;
+        }
+        //* unable to connect, check next list value
+        if (connect(sockfd, p->ai_addr, p->ai_addrlen) == -1 && errno != EINPROGRESS) {
+            perror("client: connect");
+            close(sockfd);
+            continue;
+        }
+        uint32_t generation = ++conn.sockets;
+        struct epoll_event event;
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+        event.data.u64 = (uint64_t)generation << 32 | (uint32_t)index;
+        if (epoll_ctl(engine.epfd, EPOLL_CTL_ADD, sockfd, &event) == -1) {
+            perror("epoll_ctl");
+            close(sockfd);
+            continue;
+        }
+        conn.attempts.push_back({sockfd, generation, p});
+        conn.connecting = true;
+        //* the next address is tried if this one does not connect in time
+        conn.next_attempt = p->ai_next != NULL ? engine_now() + engine.attempt_delay : 0;
+        engine_arm(engine, index);
+        return 0;
+    }
+    conn.next_attempt = 0;
+    engine_arm(engine, index);
+    return 1;
+}
+
+void engine_connected(s_engine &engine, int index, uint32_t generation) {
+    s_engine_conn &conn = engine.conns[index];
+    int error = 0, one = 1;
+    socklen_t len = sizeof error;
+
+    auto found = std::find_if(conn.attempts.begin(), conn.attempts.end(),
+        [generation](const s_engine_attempt &attempt) { return attempt.generation == generation; });
+    //! events of an attempt closed while handling the previous events
+    if (found == conn.attempts.end()) {
+        return;
+    }
+    s_engine_attempt attempt = *found;
+    conn.attempts.erase(found);
+
+    //* unable to connect, check next list value at once
+    if (getsockopt(attempt.fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1 || error != 0) {
+        errno = error;
+        perror("client: connect");
+        close(attempt.fd);
+        if (engine_attempt(engine, index) != 0 && conn.attempts.empty()) {
+            engine_closed(engine, index, 3);
+        }
+        return;
+    }
+    //* the first connection established wins, the other attempts are given up
+    engine_cancel(conn);
+    conn.fd = attempt.fd;
+    conn.generation = attempt.generation;
+    conn.addr = attempt.addr;
+    conn.writing = true;
+    conn.progress = engine_now();
+    for (auto &request : conn.queue) {
+        if (request.trace) {
+            trace_mark(request.trace->connected);
+        }
+    }
+    //* requests are small and written at once, do not wait for more data
+    setsockopt(conn.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+    engine_write(engine, index);
+    engine_arm(engine, index);
+}
+
+void engine_cancel(s_engine_conn &conn) {
+    for (const auto &attempt : conn.attempts) {
+        close(attempt.fd);
+    }
+    conn.attempts.clear();
+    conn.connecting = false;
+    conn.next_attempt = 0;
+}
+
+// end of code including parts taken over from the "Beej's Guide to Network Programming"
+
+void engine_write(s_engine &engine, int index) {
+    s_engine_conn &conn = engine.conns[index];
+    struct iovec iov[ENGINE_MAXIOV];
+    struct msghdr msg;
+    ssize_t numbytes;
+
+    if (conn.fd == -1 || conn.connecting) {
+        return;
+    }
+    //* without pipelining the next request is written once the previous one is answered
+    while (conn.written < conn.queue.size() && (conn.pipelining || conn.written == 0)) {
+        conn.written++;
+    }
+
+    //* the fragments of the released requests are gathered into one send, it may accept only a part of them
+    while (conn.sending < conn.written) {
+        s_message &current = conn.queue[conn.sending].message;
+        if (conn.part == current.parts.size()) {
+            if (conn.queue[conn.sending].trace) {
+                trace_mark(conn.queue[conn.sending].trace->sent);
+            }
+            conn.sending++;
+            conn.part = 0;
+            conn.part_offset = 0;
+            continue;
+        }
+        //* a streamed body is sent chunk by chunk, the next one is read once the current one is sent
+        if (current.parts[conn.part].streamed && conn.part_offset == current.body->chunk.size()) {
+            //! the rest of the request cannot be sent
+            if (body_next(*current.body) != 0) {
+                engine_closed(engine, index, 2);
+                return;
+            }
+            conn.part_offset = 0;
+            if (current.body->chunk.empty()) {
+                conn.part++;
+                continue;
+            }
+        }
+
+        int count = 0;
+        size_t request = conn.sending, part = conn.part, offset = conn.part_offset;
+        while (count < ENGINE_MAXIOV && request < conn.written) {
+            const s_message &message = conn.queue[request].message;
+            if (part == message.parts.size()) {
+                request++;
+                part = 0;
+                continue;
+            }
+            //* gathering stops at a streamed body, its chunks are read at the send position
+            if (message.parts[part].streamed && count > 0) {
+                break;
+            }
+            std::string_view data = message_part(message, part);
+            iov[count].iov_base = (void *)(data.data() + offset);
+            iov[count].iov_len = data.size() - offset;
+            count++;
+            if (message.parts[part].streamed) {
+                break;
+            }
+            part++;
+            offset = 0;
+        }
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = count;
+        numbytes = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (numbytes == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            //* the server closed the connection, replies received before are still read
+            if (errno != EPIPE && errno != ECONNRESET) {
+                perror("Error sending the message.\n");
+            }
+            conn.sending = conn.written;
+            conn.part = conn.part_offset = 0;
+            break;
+        }
+        engine_sent(conn, numbytes);
+        if (engine.write_timeout > 0 || engine.read_timeout > 0) {
+            conn.progress = engine_now();
+        }
+    }
+    bool writing = conn.sending < conn.written;
+    if (conn.writing != writing) {
+        engine_watch(engine, index, writing);
+    }
+    engine_arm(engine, index);
+}
+
+void engine_sent(s_engine_conn &conn, size_t numbytes) {
+    //* move past the sent fragments, the request is done once its last fragment is sent
+    while (conn.sending < conn.written) {
+        const s_message &message = conn.queue[conn.sending].message;
+        s_trace *trace = conn.queue[conn.sending].trace.get();
+        if (conn.part == message.parts.size()) {
+            if (trace) {
+                trace_mark(trace->sent);
+            }
+            conn.sending++;
+            conn.part = 0;
+            continue;
+        }
+        size_t left = message_part(message, conn.part).size() - conn.part_offset;
+        if (trace && numbytes > 0) {
+            trace_mark(trace->first_sent);
+            trace->bytes_sent += std::min(numbytes, left);
+        }
+        //* the streamed body stays current until its next chunk is read
+        if (numbytes < left || message.parts[conn.part].streamed) {
+            conn.part_offset += numbytes;
+            return;
+        }
+        numbytes -= left;
+        conn.part++;
+        conn.part_offset = 0;
+    }
+}
+
+void engine_read(s_engine &engine, int index) {
+    char buf[MAXDATASIZE];
+    ssize_t numbytes;
+
+    numbytes = recv(engine.conns[index].fd, buf, MAXDATASIZE, MSG_DONTWAIT);
+    if (numbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return;
+    }
+    if (numbytes == -1 && errno != ECONNRESET) {
+        perror("Error receiving the message.\n");
+        engine_closed(engine, index, 2);
+        return;
+    } else if (numbytes <= 0) {
+        //* server closed (or reset) the connection
+        engine_closed(engine, index, 1);
+        return;
+    }
+    engine.conns[index].in.append(buf, numbytes);
+    if (engine.read_timeout > 0 || engine.write_timeout > 0) {
+        engine.conns[index].progress = engine_now();
+    }
+    if (engine.conns[index].written > 0 && engine.conns[index].queue.front().trace) {
+        engine.conns[index].queue.front().trace->recv_calls++;
+    }
+
+    //* complete the requests whose replies are received, callbacks may add connections
+    while (1) {
+        s_engine_conn &conn = engine.conns[index];
+        if (conn.written == 0 || conn.in.empty()) {
+            break;
+        }
+        s_engine_request &request = conn.queue.front();
+        if (request.trace) {
+            trace_mark(request.trace->first_byte);
+        }
+        if (request.decoder) {
+            s_decoder &decoder = *request.decoder;
+            size_t used = decode_reply(decoder, conn.in.data(), conn.in.size());
+            if (request.trace) {
+                request.trace->bytes_received += used;
+            }
+            conn.in.erase(0, used);
+            if (!decoder.done) {
+                break;
+            }
+            if (decoder.failed) {
+                //* the rest of the data cannot be matched to the requests
+                engine_complete(engine, index, 2, "");
+                engine_closed(engine, index, 1);
+                break;
+            }
+            engine_complete(engine, index, 0, "");
+        } else {
+            size_t end = frame_reply(conn.framer, conn.in.data() + conn.scanned, conn.in.size() - conn.scanned);
+            if (end == std::string::npos) {
+                conn.scanned = conn.in.size();
+                break;
+            }
+            if (request.trace) {
+                request.trace->bytes_received = conn.scanned + end;
+            }
+            std::string reply = conn.in.substr(0, conn.scanned + end);
+            conn.in.erase(0, conn.scanned + end);
+            conn.scanned = 0;
+            conn.framer = s_framer();
+            //* replies sent back to back may be separated by whitespace
+            size_t start = reply.find_first_not_of(" \t\r\n");
+            engine_complete(engine, index, 0, start == std::string::npos ? "" : reply.substr(start));
+        }
+    }
+    engine_arm(engine, index);
+}
+
+void engine_closed(s_engine &engine, int index, int status) {
+    s_engine_conn &conn = engine.conns[index];
+    std::string partial = "";
+    bool started = false;
+
+    //* a reply that started to arrive cannot be received again
+    if (conn.written > 0) {
+        const s_engine_request &front = conn.queue.front();
+        if (front.decoder) {
+            started = front.decoder->state != -1 || front.decoder->depth != 0 || front.decoder->quoted;
+        } else {
+            started = conn.in.find_first_not_of(" \t\r\n") != std::string::npos;
+            partial = conn.in.substr(started ? conn.in.find_first_not_of(" \t\r\n") : 0);
+        }
+    }
+
+    //* requests at the front of the queue the server may have received (a part of)
+    size_t sent = conn.sending + (conn.sending < conn.written && (conn.part > 0 || conn.part_offset > 0) ? 1 : 0);
+
+    if (conn.fd != -1) {
+        close(conn.fd);
+    }
+    engine_cancel(conn);
+    conn.fd = -1;
+    conn.writing = false;
+    conn.written = 0;
+    conn.sending = 0;
+    conn.part = 0;
+    conn.part_offset = 0;
+    conn.in = "";
+    conn.scanned = 0;
+    conn.framer = s_framer();
+    size_t answered = conn.answered;
+    conn.answered = 0;
+    engine_arm(engine, index);
+
+    std::deque<s_engine_request> done;
+    if (started) {
+        done.push_back(std::move(conn.queue.front()));
+        conn.queue.pop_front();
+        sent -= sent > 0;
+    }
+    //* server dropped a connection that answered requests before, send the rest again over a new one,
+    //* a written request that changes something may have been applied before the drop and is not sent twice
+    if (status == 1 && answered > 0) {
+        std::deque<s_engine_request> again;
+        for (size_t i = 0; i < conn.queue.size(); i++) {
+            if (i < sent && !conn.queue[i].read_only) {
+                done.push_back(std::move(conn.queue[i]));
+            } else {
+                again.push_back(std::move(conn.queue[i]));
+            }
+        }
+        conn.queue.swap(again);
+    }
+    if (status == 1 && answered > 0 && !conn.queue.empty()) {
+        if (answered == 1) {
+            //* server answers one request per connection, stop pipelining
+            conn.pipelining = false;
+        }
+        if (engine_connect(engine, index) != 0) {
+            engine_closed(engine, index, 3);
+        }
+    } else {
+        while (!conn.queue.empty()) {
+            done.push_back(std::move(conn.queue.front()));
+            conn.queue.pop_front();
+        }
+    }
+
+    //* callbacks are called last, they may submit new requests
+    engine.pending -= done.size();
+    for (size_t i = 0; i < done.size(); i++) {
+        //* a timed out reply is reported as timed out even if it started to arrive
+        int request_status = started && i == 0 && status != 4 ? 2 : status;
+        done[i].on_done(request_status, started && i == 0 ? partial : "");
+        if (done[i].trace) {
+            trace_end(*done[i].trace, request_status);
+        }
+    }
+}
+
+void engine_abort(s_engine &engine, int status) {
+    //* callbacks of the failed requests may add connections, they are indexed anew
+    for (size_t index = 0; index < engine.conns.size(); index++) {
+        if (!engine.conns[index].queue.empty()) {
+            engine.conns[index].answered = 0; // the requests are not sent again over a new connection
+            engine_closed(engine, index, status);
+        }
+    }
+}
+
+void engine_complete(s_engine &engine, int index, int status, std::string reply) {
+    s_engine_conn &conn = engine.conns[index];
+
+    s_engine_request request = std::move(conn.queue.front());
+    conn.queue.pop_front();
+    if (request.trace) {
+        trace_mark(request.trace->received);
+    }
+    conn.written--;
+    //! a reply to a request not sent whole, the rest of it is not sent
+    if (conn.sending > 0) {
+        conn.sending--;
+    } else {
+        conn.part = 0;
+        conn.part_offset = 0;
+    }
+    conn.answered++;
+    engine.pending--;
+    engine_write(engine, index);
+    request.on_done(status, reply);
+    if (request.trace) {
+        trace_end(*request.trace, status);
+    }
+}
+
+void engine_watch(s_engine &engine, int index, bool writing) {
+    s_engine_conn &conn = engine.conns[index];
+    struct epoll_event event;
+
+    event.events = EPOLLIN | EPOLLRDHUP | (writing ? EPOLLOUT : 0);
+    event.data.u64 = (uint64_t)conn.generation << 32 | (uint32_t)index;
+    if (epoll_ctl(engine.epfd, EPOLL_CTL_MOD, conn.fd, &event) == -1) {
+        perror("epoll_ctl");
+    }
+    conn.writing = writing;
+}
+
+uint64_t engine_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+void engine_arm(s_engine &engine, int index) {
+    s_engine_conn &conn = engine.conns[index];
+    uint64_t deadline = 0;
+
+    if (conn.connecting) {
+        deadline = conn.connect_deadline;
+        if (conn.next_attempt != 0 && (deadline == 0 || conn.next_attempt < deadline)) {
+            deadline = conn.next_attempt;
+        }
+    } else if (conn.fd != -1 && conn.written > 0) {
+        //* the write timeout while a request is being sent, then the read timeout until its reply
+        int timeout = conn.sending < conn.written ? engine.write_timeout : engine.read_timeout;
+        if (timeout > 0) {
+            if (conn.deadline == 0) {
+                conn.progress = engine_now();
+            }
+            deadline = conn.progress + timeout;
+        }
+    }
+    if (deadline != 0 && conn.deadline == 0) {
+        engine.timed++;
+    } else if (deadline == 0 && conn.deadline != 0) {
+        engine.timed--;
+    }
+    conn.deadline = deadline;
+}
+
+void engine_expire(s_engine &engine) {
+    uint64_t now = engine_now();
+
+    //* callbacks of the failed requests may add connections, they are indexed anew
+    for (size_t index = 0; index < engine.conns.size(); index++) {
+        s_engine_conn &conn = engine.conns[index];
+        if (conn.deadline == 0 || conn.deadline > now) {
+            continue;
+        }
+        if (conn.connecting && conn.connect_deadline != 0 && conn.connect_deadline <= now) {
+            errno = ETIMEDOUT;
+            perror("client: connect");
+            engine_closed(engine, index, 3);
+        } else if (conn.connecting) {
+            //* the previous addresses did not answer yet, try the next one in parallel
+            engine_attempt(engine, index);
+        } else {
+            engine_closed(engine, index, 4);
+        }
+    }
+}
+
+void engine_fire(s_engine &engine) {
+    uint64_t now = engine_now();
+
+    //* the fired timers may add new ones, the due ones are taken out first
+    std::vector<s_engine_timer> due;
+    for (size_t i = 0; i < engine.timers.size();) {
+        if (engine.timers[i].due <= now) {
+            due.push_back(std::move(engine.timers[i]));
+            engine.timers[i] = std::move(engine.timers.back());
+            engine.timers.pop_back();
+        } else {
+            i++;
+        }
+    }
+    std::sort(due.begin(), due.end(), [](const s_engine_timer &a, const s_engine_timer &b) { return a.due < b.due; });
+    for (auto &timer : due) {
+        if (timer.hold) {
+            engine.held--;
+        }
+        timer.fire();
+    }
+
+    //* the command took too long, whatever is still pending is given up
+    if (engine.deadline != 0 && engine.deadline <= now) {
+        for (size_t index = 0; index < engine.conns.size(); index++) {
+            if (!engine.conns[index].queue.empty()) {
+                engine_closed(engine, index, 4);
+            }
+        }
+    }
+}
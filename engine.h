@@ -0,0 +1,278 @@
+/**
+ * @file engine.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - event-driven client engine, header.
+ *
+ **/
+
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+#include <deque>
+#include <memory>
+#include <climits>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/tcp.h>
+#include "request.h"
+#include "trace.h"
+
+#define ENGINE_MAXEVENTS 256 // max number of events handled in one poll
+#define ENGINE_MAXIOV 64 // max number of request fragments passed to one sendmsg
+#define ENGINE_ATTEMPT_DELAY 250 // milliseconds before the next address is tried in parallel (RFC 8305)
+#define ENGINE_WAKE UINT64_MAX // epoll data of the wake-up event, not a connection
+
+struct s_engine_request {
+    s_message message; // request sent to the server
+    std::shared_ptr<s_decoder> decoder; // the reply is passed to the decoder while received, else it is framed and passed whole
+    // status 0 if the reply was received (empty if decoded), 1 if the connection was closed before the reply,
+    // 2 if the reply is malformed or incomplete, 3 if the connection could not be established,
+    // 4 if the server stopped reading the request or answering it within the timeout
+    std::function<void(int status, std::string reply)> on_done;
+    std::shared_ptr<s_trace> trace; // phase timing, set by engine_submit only if the trace is enabled
+    bool read_only = false; // the request changes nothing on the server, it may be sent again after it was written
+};
+
+struct s_engine_timer {
+    uint64_t due; // milliseconds of the monotonic clock the timer fires at
+    bool hold; // engine_run waits for the timer
+    std::function<void()> fire;
+};
+
+struct s_engine_attempt {
+    int fd; // socket connecting
+    uint32_t generation; // generation of the socket
+    struct addrinfo *addr; // address being connected to
+};
+
+struct s_engine_conn {
+    int fd = -1;
+    uint32_t generation = 0; // generation of the connected socket, tells events of a closed socket apart
+    uint32_t sockets = 0; // number of sockets opened, the generation of the next one
+    bool connecting = false; // non-blocking connects in progress
+    struct addrinfo *addr = NULL; // last address tried
+    std::vector<s_engine_attempt> attempts; // connects in progress to several addresses, the first one established wins
+    uint64_t connect_deadline = 0; // milliseconds of the monotonic clock the connect fails at, 0 without timeout
+    uint64_t next_attempt = 0; // milliseconds of the monotonic clock the next address is tried at
+    uint64_t progress = 0; // milliseconds of the monotonic clock the last request or reply data was exchanged at
+    uint64_t deadline = 0; // earliest of the deadlines above that applies now, 0 if none
+    std::deque<s_engine_request> queue; // requests not completed yet, in order
+    size_t written = 0; // requests at the front of the queue released for sending
+    size_t sending = 0; // requests at the front of the queue sent whole
+    size_t part = 0; // fragments of the request being sent already sent
+    size_t part_offset = 0; // bytes of the current fragment already sent
+    bool writing = false; // EPOLLOUT is registered
+    std::string in = ""; // received data not handled yet
+    size_t scanned = 0; // bytes of the received data already passed to the framer
+    s_framer framer;
+    size_t answered = 0; // replies received over the current socket
+    bool pipelining = true; // false once the server answered only one request per connection
+};
+
+struct s_engine {
+    int epfd = -1;
+    struct addrinfo *server_info = NULL; // resolved server addresses, owned by the caller
+    std::vector<s_engine_conn> conns; // connections by index
+    size_t pending = 0; // requests not completed in all connections
+    size_t detached = 0; // pending requests whose completion nobody waits for (losing hedges), engine_run does not wait for them
+    std::vector<s_engine_timer> timers; // timers not fired yet
+    size_t held = 0; // timers engine_run waits for
+    uint64_t deadline = 0; // milliseconds of the monotonic clock the pending requests fail at (status 4), 0 without deadline
+    int connect_timeout = 0; // milliseconds to establish a connection over all addresses, 0 without timeout
+    int read_timeout = 0; // milliseconds without reply data while a reply is awaited, 0 without timeout
+    int write_timeout = 0; // milliseconds without sending progress while a request is being sent, 0 without timeout
+    int attempt_delay = ENGINE_ATTEMPT_DELAY; // milliseconds before the next address is tried in parallel
+    size_t timed = 0; // connections with a deadline
+    int wakefd = -1; // event other threads wake the poll loop with, -1 if not used
+    std::function<void()> on_wake; // called in the poll loop once woken up
+    std::string envelope = ""; // sent before every request (the header of the agent), empty if none
+};
+
+/**
+ * Create the engine.
+ * @param engine Engine state.
+ * @param server_info Resolved server addresses, must outlive the engine.
+ * @return 1 if an error occurs, else 0.
+ */
+int engine_init(s_engine &engine, struct addrinfo *server_info);
+
+/**
+ * Close all connections of the engine.
+ * @param engine Engine state.
+ */
+void engine_free(s_engine &engine);
+
+/**
+ * Let other threads wake up the poll loop, e.g. to submit requests passed to it.
+ * @param engine Engine state.
+ * @param on_wake Called in the poll loop after it was woken up, once for any number of wake-ups.
+ * @return 1 if an error occurs, else 0.
+ */
+int engine_waker(s_engine &engine, std::function<void()> on_wake);
+
+/**
+ * Wake up the poll loop, it may be called from any thread.
+ * @param engine Engine state.
+ */
+void engine_wake(s_engine &engine);
+
+/**
+ * Add a connection, it is established with the first submitted request.
+ * @param engine Engine state.
+ * @return Index of the connection.
+ */
+int engine_open(s_engine &engine);
+
+/**
+ * Queue the request on the connection, requests are written back to back and the replies are matched in order.
+ * A connection dropped by the server after it answered a request is reestablished and the unanswered requests
+ * that were not written yet (or are read-only) are sent again, the written ones may have been applied and fail.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @param request The request and its completion callback.
+ */
+void engine_submit(s_engine &engine, int index, s_engine_request request);
+
+/**
+ * Call the function from the poll loop once the delay passes.
+ * @param engine Engine state.
+ * @param delay Milliseconds.
+ * @param hold True if engine_run waits for the timer, as for a pending request.
+ * @param fire Called once, it may submit requests.
+ */
+void engine_after(s_engine &engine, int delay, bool hold, std::function<void()> fire);
+
+/**
+ * Handle the events until all submitted requests (except the detached ones) and held timers are completed.
+ * @param engine Engine state.
+ * @return 1 if an error occurs, else 0.
+ */
+int engine_run(s_engine &engine);
+
+/**
+ * Shorten a poll timeout to the nearest deadline of the connections, timer or command deadline.
+ * @param engine Engine state.
+ * @param timeout Milliseconds to wait, -1 to wait until an event comes.
+ * @return Milliseconds to wait at most.
+ */
+int engine_timeout(const s_engine &engine, int timeout);
+
+/**
+ * Wait for the events and handle them.
+ * @param engine Engine state.
+ * @param timeout Milliseconds to wait, -1 to wait until an event comes.
+ * @return 1 if an error occurs, else 0.
+ */
+int engine_poll(s_engine &engine, int timeout);
+
+/**
+ * Start connecting to the server addresses, the next address is tried in parallel
+ * if the previous ones do not connect within the attempt delay or fail.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @return 1 if no connect could be started, else 0.
+ */
+int engine_connect(s_engine &engine, int index);
+
+/**
+ * Start a non-blocking connect to the next server address.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @return 1 if no address is left, else 0.
+ */
+int engine_attempt(s_engine &engine, int index);
+
+/**
+ * Finish a non-blocking connect, the first one established is kept and the others are closed.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @param generation Generation of the socket of the attempt.
+ */
+void engine_connected(s_engine &engine, int index, uint32_t generation);
+
+/**
+ * Close the sockets of the connects in progress.
+ * @param conn Connection.
+ */
+void engine_cancel(s_engine_conn &conn);
+
+/**
+ * Get the time of the monotonic clock.
+ * @return Milliseconds.
+ */
+uint64_t engine_now();
+
+/**
+ * Update the deadline of the connection after its state changed.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ */
+void engine_arm(s_engine &engine, int index);
+
+/**
+ * Start the next connect attempts and fail the connections whose deadline passed.
+ * @param engine Engine state.
+ */
+void engine_expire(s_engine &engine);
+
+/**
+ * Fire the timers that are due and fail the pending requests once the command deadline passed.
+ * @param engine Engine state.
+ */
+void engine_fire(s_engine &engine);
+
+/**
+ * Release the queued requests for sending and send as much of their fragments as possible.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ */
+void engine_write(s_engine &engine, int index);
+
+/**
+ * Advance the send position of the connection.
+ * @param conn Connection.
+ * @param numbytes Bytes accepted by the socket.
+ */
+void engine_sent(s_engine_conn &conn, size_t numbytes);
+
+/**
+ * Read the available data and complete the requests whose replies are received.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ */
+void engine_read(s_engine &engine, int index);
+
+/**
+ * Close the socket and resolve the requests left on the connection.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @param status Status of the requests that are not sent again.
+ */
+void engine_closed(s_engine &engine, int index, int status);
+
+/**
+ * Close all connections and fail their requests with the status, nothing is sent again.
+ * @param engine Engine state.
+ * @param status Completion status.
+ */
+void engine_abort(s_engine &engine, int status);
+
+/**
+ * Remove the first request of the connection and call its callback.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @param status Completion status.
+ * @param reply Received reply.
+ */
+void engine_complete(s_engine &engine, int index, int status, std::string reply);
+
+/**
+ * Update the events watched on the connection socket.
+ * @param engine Engine state.
+ * @param index Index of the connection.
+ * @param writing True to watch for the socket being writable.
+ */
+void engine_watch(s_engine &engine, int index, bool writing);
+
+#endif /* _ENGINE_H_ */
@@ -0,0 +1,235 @@
+#ifndef _ESCAPE_H_
+#define _ESCAPE_H_
+
+/**
+ * @file escape.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - escaping of quoted protocol strings.
+ *
+ * Strings are escaped in one pass: the output size is counted first, then the output is filled.
+ * The input is scanned for special characters 16 (SSE2) or 32 (AVX2) bytes at a time,
+ * the AVX2 kernel is selected at runtime if the CPU supports it.
+ **/
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ESCAPE_X86 1
+#include <immintrin.h>
+#endif
+
+namespace encoding {
+
+class Escape {
+ public:
+
+  // Length of the escaped string: every backslash, quote and newline takes two characters.
+  static size_t EscapedLength(std::string_view data) {
+    return data.size() + Kernels().count(data.data(), data.size());
+  }
+
+  // Escapes into a caller-supplied buffer of at least EscapedLength(data) bytes.
+  static size_t Encode(std::string_view data, char *out) {
+    const char *in = data.data();
+    size_t len = data.size(), i = 0;
+    char *p = out;
+
+    while (i < len) {
+      size_t next = i + Kernels().find_special(in + i, len - i);
+      memcpy(p, in + i, next - i);
+      p += next - i;
+      if (next == len) break;
+      *p++ = '\\';
+      *p++ = in[next] == '\n' ? 'n' : in[next];
+      i = next + 1;
+    }
+    return p - out;
+  }
+
+  static std::string Encode(std::string_view data) {
+    std::string ret(EscapedLength(data), '\0');
+    Encode(data, &ret[0]);
+    return ret;
+  }
+
+  // Unescapes into a caller-supplied buffer of at least data.size() bytes.
+  // Only escaped backslash and quote (and newline if asked) are replaced, other sequences are kept as they are.
+  static size_t Decode(std::string_view data, char *out, bool newline = false) {
+    const char *in = data.data();
+    size_t len = data.size(), i = 0;
+    char *p = out;
+
+    while (i < len) {
+      const char *found = static_cast<const char *>(memchr(in + i, '\\', len - i));
+      size_t next = found ? found - in : len;
+      memcpy(p, in + i, next - i);
+      p += next - i;
+      if (next == len) break;
+      if (newline && next + 1 < len && in[next + 1] == 'n') {
+        *p++ = '\n';
+        i = next + 2;
+        continue;
+      }
+      if (next + 1 < len && (in[next + 1] == '\\' || in[next + 1] == '"')) {
+        next++;
+      }
+      *p++ = in[next];
+      i = next + 1;
+    }
+    return p - out;
+  }
+
+  static std::string Decode(std::string_view data, bool newline = false) {
+    std::string ret(data.size(), '\0');
+    ret.resize(Decode(data, &ret[0], newline));
+    return ret;
+  }
+
+  // Position of the first quote or backslash, or len if there is none.
+  static size_t FindQuoteOrBackslash(const char *data, size_t len) {
+    return Kernels().find_quote(data, len);
+  }
+
+  // Name of the kernels selected for this CPU.
+  static const char *Implementation() {
+    return Kernels().name;
+  }
+
+  static size_t CountScalar(const char *data, size_t len) {
+    size_t count = 0;
+    for (size_t i = 0; i < len; i++) {
+      count += data[i] == '\\' || data[i] == '"' || data[i] == '\n';
+    }
+    return count;
+  }
+
+  static size_t FindSpecialScalar(const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len && data[i] != '\\' && data[i] != '"' && data[i] != '\n') i++;
+    return i;
+  }
+
+  static size_t FindQuoteScalar(const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len && data[i] != '\\' && data[i] != '"') i++;
+    return i;
+  }
+
+#ifdef ESCAPE_X86
+  static size_t CountSSE2(const char *data, size_t len) {
+    size_t count = 0, i = 0;
+    for (; i + 16 <= len; i += 16) {
+      count += __builtin_popcount(SpecialMask128(Load128(data + i), true));
+    }
+    return count + CountScalar(data + i, len - i);
+  }
+
+  static size_t FindSpecialSSE2(const char *data, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+      unsigned mask = SpecialMask128(Load128(data + i), true);
+      if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + FindSpecialScalar(data + i, len - i);
+  }
+
+  static size_t FindQuoteSSE2(const char *data, size_t len) {
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+      unsigned mask = SpecialMask128(Load128(data + i), false);
+      if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + FindQuoteScalar(data + i, len - i);
+  }
+
+  __attribute__((target("avx2,popcnt")))
+  static size_t CountAVX2(const char *data, size_t len) {
+    size_t count = 0, i = 0;
+    for (; i + 32 <= len; i += 32) {
+      count += __builtin_popcount(SpecialMask256(Load256(data + i), true));
+    }
+    return count + CountSSE2(data + i, len - i);
+  }
+
+  __attribute__((target("avx2")))
+  static size_t FindSpecialAVX2(const char *data, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+      unsigned mask = SpecialMask256(Load256(data + i), true);
+      if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + FindSpecialSSE2(data + i, len - i);
+  }
+
+  __attribute__((target("avx2")))
+  static size_t FindQuoteAVX2(const char *data, size_t len) {
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+      unsigned mask = SpecialMask256(Load256(data + i), false);
+      if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + FindQuoteSSE2(data + i, len - i);
+  }
+#endif
+
+ private:
+
+  using CountKernel = size_t (*)(const char *data, size_t len);
+  using FindKernel = size_t (*)(const char *data, size_t len);
+
+  struct KernelSet {
+    CountKernel count;
+    FindKernel find_special;
+    FindKernel find_quote;
+    const char *name;
+  };
+
+  static const KernelSet &Kernels() {
+    static const KernelSet kernels = SelectKernels();
+    return kernels;
+  }
+
+  static KernelSet SelectKernels() {
+#ifdef ESCAPE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {CountAVX2, FindSpecialAVX2, FindQuoteAVX2, "avx2"};
+    return {CountSSE2, FindSpecialSSE2, FindQuoteSSE2, "sse2"};
+#else
+    return {CountScalar, FindSpecialScalar, FindQuoteScalar, "scalar"};
+#endif
+  }
+
+#ifdef ESCAPE_X86
+  static __m128i Load128(const char *data) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+  }
+
+  // Bit i is set if byte i is a backslash or quote (or newline).
+  static unsigned SpecialMask128(__m128i chunk, bool newline) {
+    __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')));
+    if (newline) found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')));
+    return _mm_movemask_epi8(found);
+  }
+
+  __attribute__((target("avx2")))
+  static __m256i Load256(const char *data) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data));
+  }
+
+  __attribute__((target("avx2")))
+  static unsigned SpecialMask256(__m256i chunk, bool newline) {
+    __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')));
+    if (newline) found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')));
+    return _mm256_movemask_epi8(found);
+  }
+#endif
+
+};
+
+}
+
+#endif /* _ESCAPE_H_ */
@@ -0,0 +1,70 @@
+/**
+ * @file histogram.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - log-linear latency histogram.
+ *
+ * Values are counted in HdrHistogram-style buckets: exact below 2^HIST_SUB_BITS, then
+ * a fixed number of linear sub-buckets per power of two, so the relative error stays
+ * below 0.1 % over the whole range and histograms of several threads merge by adding counts.
+ */
+
+#include "histogram.h"
+
+void histogram_record(s_histogram &hist, uint64_t value) {
+    if (hist.counts.empty()) {
+        hist.counts.resize(histogram_index((1ull << HIST_MAX_BITS) - 1) + 1);
+    }
+    value = std::min<uint64_t>(value, (1ull << HIST_MAX_BITS) - 1);
+    hist.counts[histogram_index(value)]++;
+    hist.total++;
+    hist.min = std::min(hist.min, value);
+    hist.max = std::max(hist.max, value);
+    hist.sum += value;
+}
+
+void histogram_merge(s_histogram &hist, const s_histogram &other) {
+    if (other.total == 0) {
+        return;
+    }
+    if (hist.counts.empty()) {
+        hist.counts.resize(other.counts.size());
+    }
+    for (size_t i = 0; i < other.counts.size(); i++) {
+        hist.counts[i] += other.counts[i];
+    }
+    hist.total += other.total;
+    hist.min = std::min(hist.min, other.min);
+    hist.max = std::max(hist.max, other.max);
+    hist.sum += other.sum;
+}
+
+uint64_t histogram_percentile(const s_histogram &hist, double percentile) {
+    if (hist.total == 0) {
+        return 0;
+    }
+    uint64_t rank = std::max<uint64_t>(1, std::ceil(percentile / 100 * hist.total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < hist.counts.size(); i++) {
+        seen += hist.counts[i];
+        if (seen >= rank) {
+            return std::min(histogram_value(i), hist.max);
+        }
+    }
+    return hist.max;
+}
+
+size_t histogram_index(uint64_t value) {
+    //* values below the sub-bucket count are exact, above it each power of two has half as many buckets
+    int bucket = std::max(0, 64 - __builtin_clzll(value | ((1ull << HIST_SUB_BITS) - 1)) - HIST_SUB_BITS);
+    return ((size_t)bucket << (HIST_SUB_BITS - 1)) + (value >> bucket);
+}
+
+uint64_t histogram_value(size_t index) {
+    int bucket = (int)(index >> (HIST_SUB_BITS - 1)) - 1;
+    if (bucket <= 0) {
+        return index;
+    }
+    uint64_t sub = (index & ((1ull << (HIST_SUB_BITS - 1)) - 1)) + (1ull << (HIST_SUB_BITS - 1));
+    return ((sub + 1) << bucket) - 1;
+}
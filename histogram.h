@@ -0,0 +1,64 @@
+/**
+ * @file histogram.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - log-linear latency histogram, header.
+ *
+ **/
+
+#ifndef _HISTOGRAM_H_
+#define _HISTOGRAM_H_
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#define HIST_SUB_BITS 11 // 2048 linear sub-buckets, about 3 significant digits
+#define HIST_MAX_BITS 36 // largest tracked latency is about 19 hours in microseconds
+
+struct s_histogram {
+    std::vector<uint64_t> counts; // HDR layout: linear sub-buckets, then half as many per power of two
+    uint64_t total = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    double sum = 0;
+};
+
+/**
+ * Record a value into the histogram.
+ * @param hist Histogram.
+ * @param value Recorded value.
+ */
+void histogram_record(s_histogram &hist, uint64_t value);
+
+/**
+ * Add all values of one histogram to another.
+ * @param hist Target histogram.
+ * @param other Added histogram.
+ */
+void histogram_merge(s_histogram &hist, const s_histogram &other);
+
+/**
+ * Get the value at the given percentile.
+ * @param hist Histogram.
+ * @param percentile Percentile between 0 and 100.
+ * @return Highest value equivalent to the value at the percentile.
+ */
+uint64_t histogram_percentile(const s_histogram &hist, double percentile);
+
+/**
+ * Get the bucket index of a value.
+ * @param value Recorded value.
+ * @return Index into the histogram counts.
+ */
+size_t histogram_index(uint64_t value);
+
+/**
+ * Get the highest value counted by a bucket.
+ * @param index Index into the histogram counts.
+ * @return Highest value equivalent to the values in the bucket.
+ */
+uint64_t histogram_value(size_t index);
+
+#endif /* _HISTOGRAM_H_ */
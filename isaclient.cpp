@@ -0,0 +1,345 @@
+/**
+ * @file isaclient.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - embeddable client library (libisaclient).
+ *
+ * Each client owns an engine served by its own thread. Calls from other threads are queued
+ * under the lock and the engine thread is woken up to submit them, so the engine itself is
+ * only used by its thread. Requests that use the login token are built when they are submitted
+ * to the engine; while a login or logout is in flight they are held back, so they are sent
+ * with the token it results in, as the batch mode of the client does.
+ */
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "isaclient.h"
+#include "engine.h"
+
+struct s_isa_call {
+    int command; // index in command_table
+    std::vector<std::string> fields; // unescaped arguments
+    std::function<void(int status, std::string reply)> on_done; // typed completion of the call
+};
+
+struct s_isa_client {
+    struct addrinfo *server_info = NULL;
+    s_engine engine;
+    std::vector<int> conns; // engine connections, used in turns
+    size_t next_conn = 0;
+    std::thread thread; // engine thread
+    std::mutex lock; // guards the submitted calls and closing
+    std::deque<s_isa_call> submitted; // calls made, not yet taken by the engine thread
+    bool closing = false; // no more calls are accepted, the engine thread stops once all are completed
+    bool failed = false; // the engine thread stopped after an error, calls are completed with ISA_CLOSED
+    std::atomic<bool> logged_in{false};
+    // used by the engine thread only
+    std::string token = "\"\""; // login token as sent in the requests
+    std::deque<s_isa_call> held; // calls waiting for a login or logout in flight
+    size_t changing = 0; // logins and logouts in flight
+};
+
+/**
+ * Pass a call to the engine, or hold it back while the token may change. Engine thread only.
+ * @param client Client.
+ * @param call Call.
+ */
+static void isa_start(s_isa_client *client, s_isa_call call) {
+    const s_command &entry = command_table[call.command];
+
+    //! the engine thread is stopping after an error
+    if (client->failed) {
+        call.on_done(ISA_CLOSED, "");
+        return;
+    }
+    //* calls without the token are sent at once, the rest in order after the login or logout
+    if (client->changing > 0 && (entry.uses_token() || entry.effect != EFFECT_NONE)) {
+        client->held.push_back(std::move(call));
+        return;
+    }
+    e_effect effect = entry.effect;
+    if (effect != EFFECT_NONE) {
+        client->changing++;
+    }
+
+    //* the fields are sent without copying them, they are kept with the request
+    std::shared_ptr<std::vector<std::string>> fields = std::make_shared<std::vector<std::string>>(std::move(call.fields));
+    s_request_args values;
+    values.values.assign(fields->begin(), fields->end());
+    values.token = client->token;
+    s_engine_request request;
+    encode_request(call.command, values, request.message);
+    request.read_only = entry.read_only;
+    request.on_done = [client, effect, fields, on_done = std::move(call.on_done)](int status, std::string reply) {
+        if (effect != EFFECT_NONE) {
+            s_reply parsed;
+            //* the token of the login is used by the following calls
+            if (status == 0 && parse_response(reply, parsed) == 0 && parsed.ok) {
+                if (effect == EFFECT_LOGIN && parsed.fields.size() > 1) {
+                    client->token = "\"" + std::string(parsed.fields[1]) + "\"";
+                    client->logged_in = true;
+                } else if (effect == EFFECT_LOGOUT) {
+                    client->token = "\"\"";
+                    client->logged_in = false;
+                }
+            }
+            client->changing--;
+        }
+        on_done(status, reply);
+
+        //* release the calls held back, until the next login or logout among them
+        while (client->changing == 0 && !client->held.empty()) {
+            s_isa_call held = std::move(client->held.front());
+            client->held.pop_front();
+            isa_start(client, std::move(held));
+        }
+    };
+    int conn = client->conns[client->next_conn++ % client->conns.size()];
+    engine_submit(client->engine, conn, std::move(request));
+}
+
+/**
+ * Take the calls made by other threads. Engine thread only.
+ * @param client Client.
+ */
+static void isa_wake(s_isa_client *client) {
+    std::deque<s_isa_call> calls;
+    {
+        std::lock_guard<std::mutex> guard(client->lock);
+        calls.swap(client->submitted);
+    }
+    for (auto &call : calls) {
+        isa_start(client, std::move(call));
+    }
+}
+
+/**
+ * Complete all outstanding calls with ISA_CLOSED once the engine failed, new calls are rejected. Engine thread only.
+ * @param client Client.
+ */
+static void isa_fail(s_isa_client *client) {
+    std::deque<s_isa_call> calls;
+    {
+        std::lock_guard<std::mutex> guard(client->lock);
+        client->failed = true;
+        calls.swap(client->submitted);
+    }
+    //* the calls in flight first, the held ones released by their completion are rejected at once
+    engine_abort(client->engine, ISA_CLOSED);
+    while (!client->held.empty()) {
+        calls.push_front(std::move(client->held.back()));
+        client->held.pop_back();
+    }
+    for (auto &call : calls) {
+        call.on_done(ISA_CLOSED, "");
+    }
+}
+
+/**
+ * Serve the engine until the client is closed and all calls are completed.
+ * @param client Client.
+ */
+static void isa_loop(s_isa_client *client) {
+    while (1) {
+        {
+            std::lock_guard<std::mutex> guard(client->lock);
+            if (client->closing && client->submitted.empty() && client->held.empty() && client->engine.pending == 0) {
+                break;
+            }
+        }
+        if (engine_poll(client->engine, -1) != 0) {
+            isa_fail(client);
+            break;
+        }
+    }
+}
+
+/**
+ * Queue a call for the engine thread.
+ * @param client Client.
+ * @param call Call, completed at once if the client is closing.
+ */
+static void isa_submit(s_isa_client *client, s_isa_call call) {
+    std::unique_lock<std::mutex> guard(client->lock);
+    if (client->closing || client->failed) {
+        guard.unlock();
+        call.on_done(ISA_CLOSED, "");
+        return;
+    }
+    client->submitted.push_back(std::move(call));
+    guard.unlock();
+    engine_wake(client->engine);
+}
+
+/**
+ * Fill the common part of a result.
+ * @param status Completion status of the engine.
+ * @param reply Received reply.
+ * @param parsed Parsed reply, the fields point into the reply.
+ * @param result Result.
+ * @return True if the server answered.
+ */
+static bool isa_result(int status, const std::string &reply, s_reply &parsed, s_isa_result &result) {
+    result.status = status;
+    //* the fields are returned as they were passed to isa_send, an escaped newline is a newline
+    parsed.newlines = true;
+    if (status == 0 && parse_response(reply, parsed) != 0) {
+        result.status = ISA_INVALID;
+    }
+    if (result.status != ISA_OK) {
+        return false;
+    }
+    result.ok = parsed.ok;
+    //* error message or command result
+    if (!parsed.ok && !parsed.fields.empty()) {
+        result.text = parsed.fields[0];
+    }
+    return true;
+}
+
+/**
+ * Complete a call whose reply is a message (and the token of a login).
+ * @param done Callback of the call.
+ * @return Completion of the call.
+ */
+static std::function<void(int, std::string)> isa_plain(std::function<void(s_isa_result)> done) {
+    return [done](int status, std::string reply) {
+        s_isa_result result;
+        s_reply parsed;
+        if (isa_result(status, reply, parsed, result) && parsed.ok) {
+            if (parsed.fields.empty()) {
+                result = s_isa_result();
+                result.status = ISA_INVALID;
+            } else {
+                result.text = parsed.fields[0];
+            }
+        }
+        done(result);
+    };
+}
+
+/**
+ * Call the function with a callback setting the value of a future.
+ * @param call Function making the call.
+ * @return Future of the result.
+ */
+template <typename T, typename F>
+static std::future<T> isa_future(F call) {
+    std::shared_ptr<std::promise<T>> promise = std::make_shared<std::promise<T>>();
+    std::future<T> future = promise->get_future();
+    call([promise](T result) { promise->set_value(std::move(result)); });
+    return future;
+}
+
+s_isa_client *isa_open(const s_isa_options &options) {
+    s_isa_client *client = new s_isa_client;
+
+    if (resolve_address(options.addr, options.port, &client->server_info) != 0) {
+        delete client;
+        return NULL;
+    }
+    if (engine_init(client->engine, client->server_info) != 0 || engine_waker(client->engine, [client] { isa_wake(client); }) != 0) {
+        engine_free(client->engine);
+        free_server(client->server_info);
+        delete client;
+        return NULL;
+    }
+    client->engine.connect_timeout = options.connect_timeout;
+    client->engine.read_timeout = options.read_timeout;
+    client->engine.write_timeout = options.write_timeout;
+    for (int i = 0; i < std::max(1, options.connections); i++) {
+        client->conns.push_back(engine_open(client->engine));
+    }
+    client->thread = std::thread(isa_loop, client);
+    return client;
+}
+
+void isa_close(s_isa_client *client) {
+    {
+        std::lock_guard<std::mutex> guard(client->lock);
+        client->closing = true;
+    }
+    engine_wake(client->engine);
+    client->thread.join();
+    engine_free(client->engine);
+    free_server(client->server_info);
+    delete client;
+}
+
+bool isa_logged_in(s_isa_client *client) {
+    return client->logged_in;
+}
+
+void isa_register(s_isa_client *client, std::string user, std::string password, std::function<void(s_isa_result)> done) {
+    isa_submit(client, {find_command("register"), {user, password}, isa_plain(done)});
+}
+
+std::future<s_isa_result> isa_register(s_isa_client *client, std::string user, std::string password) {
+    return isa_future<s_isa_result>([&](std::function<void(s_isa_result)> done) { isa_register(client, user, password, done); });
+}
+
+void isa_login(s_isa_client *client, std::string user, std::string password, std::function<void(s_isa_result)> done) {
+    isa_submit(client, {find_command("login"), {user, password}, isa_plain(done)});
+}
+
+std::future<s_isa_result> isa_login(s_isa_client *client, std::string user, std::string password) {
+    return isa_future<s_isa_result>([&](std::function<void(s_isa_result)> done) { isa_login(client, user, password, done); });
+}
+
+void isa_list(s_isa_client *client, std::function<void(s_isa_list)> done) {
+    isa_submit(client, {find_command("list"), {}, [done](int status, std::string reply) {
+        s_isa_list result;
+        s_reply parsed;
+        if (isa_result(status, reply, parsed, result) && parsed.ok) {
+            //* sender and subject of each message, the ids are their positions
+            for (size_t i = 0; i + 1 < parsed.fields.size(); i += 2) {
+                result.messages.push_back({(long)(i / 2 + 1), std::string(parsed.fields[i]), std::string(parsed.fields[i + 1])});
+            }
+        }
+        done(result);
+    }});
+}
+
+std::future<s_isa_list> isa_list(s_isa_client *client) {
+    return isa_future<s_isa_list>([&](std::function<void(s_isa_list)> done) { isa_list(client, done); });
+}
+
+void isa_fetch(s_isa_client *client, long id, std::function<void(s_isa_fetched)> done) {
+    isa_submit(client, {find_command("fetch"), {std::to_string(id)}, [done](int status, std::string reply) {
+        s_isa_fetched result;
+        s_reply parsed;
+        if (isa_result(status, reply, parsed, result) && parsed.ok) {
+            if (parsed.fields.size() < 3) {
+                result = s_isa_fetched();
+                result.status = ISA_INVALID;
+            } else {
+                result.sender = parsed.fields[0];
+                result.subject = parsed.fields[1];
+                result.body = parsed.fields[2];
+            }
+        }
+        done(result);
+    }});
+}
+
+std::future<s_isa_fetched> isa_fetch(s_isa_client *client, long id) {
+    return isa_future<s_isa_fetched>([&](std::function<void(s_isa_fetched)> done) { isa_fetch(client, id, done); });
+}
+
+void isa_send(s_isa_client *client, std::string recipient, std::string subject, std::string body, std::function<void(s_isa_result)> done) {
+    isa_submit(client, {find_command("send"), {recipient, subject, std::move(body)}, isa_plain(done)});
+}
+
+std::future<s_isa_result> isa_send(s_isa_client *client, std::string recipient, std::string subject, std::string body) {
+    return isa_future<s_isa_result>([&](std::function<void(s_isa_result)> done) { isa_send(client, recipient, subject, std::move(body), done); });
+}
+
+void isa_logout(s_isa_client *client, std::function<void(s_isa_result)> done) {
+    isa_submit(client, {find_command("logout"), {}, isa_plain(done)});
+}
+
+std::future<s_isa_result> isa_logout(s_isa_client *client) {
+    return isa_future<s_isa_result>([&](std::function<void(s_isa_result)> done) { isa_logout(client, done); });
+}
@@ -0,0 +1,144 @@
+/**
+ * @file isaclient.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - embeddable client library (libisaclient), header.
+ *
+ * The calls return typed results instead of the printed responses, either through a callback
+ * or a future. Each client runs its own engine thread, the calls may be made from any thread
+ * and the login token is kept in memory by the client, the login-token file is not used.
+ *
+ *  s_isa_client *client = isa_open(options);
+ *  isa_login(client, "user", "password").get();
+ *  s_isa_list list = isa_list(client).get();
+ *  isa_close(client);
+ *
+ * Callbacks are called in the engine thread, they must not wait for the result of another call.
+ **/
+
+#ifndef _ISACLIENT_H_
+#define _ISACLIENT_H_
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <future>
+
+// status of a result
+#define ISA_OK 0 // the server answered, ok tells whether the command succeeded
+#define ISA_CLOSED 1 // the connection was closed before the reply, or the client is closed
+#define ISA_INVALID 2 // the reply is malformed or incomplete
+#define ISA_UNREACHABLE 3 // the server could not be connected to
+#define ISA_TIMEOUT 4 // the server did not read the request or answer it in time
+
+struct s_isa_options {
+    std::string addr = "127.0.0.1"; // server hostname or address
+    std::string port = "32323";
+    int connections = 1; // connections the calls are spread over in turns, calls on different connections may complete in any order
+    int connect_timeout = 10000; // milliseconds, 0 without timeout
+    int read_timeout = 30000;
+    int write_timeout = 30000;
+};
+
+struct s_isa_result {
+    int status = ISA_CLOSED; // ISA_OK if the server answered
+    bool ok = false; // the server answered with ok
+    std::string text = ""; // result or error message of the server
+};
+
+struct s_isa_listed {
+    long id; // message id
+    std::string sender = "";
+    std::string subject = "";
+};
+
+struct s_isa_list : s_isa_result {
+    std::vector<s_isa_listed> messages; // messages of the user, if ok
+};
+
+struct s_isa_fetched : s_isa_result {
+    std::string sender = ""; // fields of the message, if ok
+    std::string subject = "";
+    std::string body = "";
+};
+
+struct s_isa_client; // client state, opaque
+
+/**
+ * Resolve the server and start the engine thread, the connections are established with the first calls.
+ * @param options Server and connection options.
+ * @return Client, NULL if the server cannot be resolved or the engine cannot be started.
+ */
+s_isa_client *isa_open(const s_isa_options &options);
+
+/**
+ * Complete the calls made so far, stop the engine thread and free the client.
+ * @param client Client.
+ */
+void isa_close(s_isa_client *client);
+
+/**
+ * Check whether the client holds a login token.
+ * @param client Client.
+ * @return True after a successful login until a successful logout.
+ */
+bool isa_logged_in(s_isa_client *client);
+
+/**
+ * Register a user.
+ * @param client Client.
+ * @param user User name.
+ * @param password Password, it is sent base64 encoded.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_register(s_isa_client *client, std::string user, std::string password, std::function<void(s_isa_result)> done);
+std::future<s_isa_result> isa_register(s_isa_client *client, std::string user, std::string password);
+
+/**
+ * Log in, the token is used by the following calls of the client.
+ * Calls made after the login are sent once it is answered.
+ * @param client Client.
+ * @param user User name.
+ * @param password Password.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_login(s_isa_client *client, std::string user, std::string password, std::function<void(s_isa_result)> done);
+std::future<s_isa_result> isa_login(s_isa_client *client, std::string user, std::string password);
+
+/**
+ * List the messages of the logged in user.
+ * @param client Client.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_list(s_isa_client *client, std::function<void(s_isa_list)> done);
+std::future<s_isa_list> isa_list(s_isa_client *client);
+
+/**
+ * Fetch a message of the logged in user.
+ * @param client Client.
+ * @param id Message id.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_fetch(s_isa_client *client, long id, std::function<void(s_isa_fetched)> done);
+std::future<s_isa_fetched> isa_fetch(s_isa_client *client, long id);
+
+/**
+ * Send a message as the logged in user.
+ * @param client Client.
+ * @param recipient Recipient user name.
+ * @param subject Subject.
+ * @param body Message body.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_send(s_isa_client *client, std::string recipient, std::string subject, std::string body, std::function<void(s_isa_result)> done);
+std::future<s_isa_result> isa_send(s_isa_client *client, std::string recipient, std::string subject, std::string body);
+
+/**
+ * Log out, the token is forgotten once the server confirms it.
+ * @param client Client.
+ * @param done Called with the result in the engine thread.
+ */
+void isa_logout(s_isa_client *client, std::function<void(s_isa_result)> done);
+std::future<s_isa_result> isa_logout(s_isa_client *client);
+
+#endif /* _ISACLIENT_H_ */
@@ -0,0 +1,481 @@
+/**
+ * @file loadgen.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - multi-user load generator.
+ *
+ * Simulates virtual users, each with its own account, login token and connection,
+ * running a weighted mix of commands. The users are spread over a pool of worker threads,
+ * each worker drives the connections of its users from one client engine, every user has
+ * at most one request in flight. Requests are built, exchanged and parsed by the same code
+ * as in the client (encode_request, the client engine, split_response). Each request is built
+ * from the arguments and the token of its user, so the workers build them without a lock.
+ * Latency is measured from the scheduled start of the request when a target rate is given,
+ * so a stalled server is not hidden by the paused workers.
+ *
+ * usage: loadgen [ <option> ... ]
+ * <option> is one of
+ * -a <addr>, --address <addr>
+ *    Server hostname or address to connect to
+ * -p <port>, --port <port>
+ *    Server port to connect to
+ * -u <count>, --users <count>
+ *    Number of virtual users
+ * -t <count>, --threads <count>
+ *    Number of worker threads, number of cores by default
+ * -r <rate>, --rate <rate>
+ *    Target requests per second of all workers, unlimited by default
+ * -d <sec>, --duration <sec>
+ *    Length of the run
+ * -m <mix>, --mix <mix>
+ *    Command weights, e.g. "register=0,login=1,send=4,list=4,fetch=4,logout=1"
+ * -b <bytes>, --body-size <bytes>
+ *    Size of the sent message bodies
+ * -n <prefix>, --prefix <prefix>
+ *    User name prefix, unique per run by default
+ * -j, --json
+ *    Print the report as JSON
+ * -H, --histogram
+ *    Print the percentile distribution of each command
+ * --help, -h
+ *    Show this help
+ */
+
+#include "loadgen.h"
+
+static std::vector<s_user> users;
+static std::string body = ""; // body of the sent messages
+static std::chrono::steady_clock::time_point end_time;
+
+int main(int argc, char *argv[])
+{
+    struct addrinfo *server_info;
+
+    parseargs(argc, argv);
+
+    //* each virtual user keeps a connection open
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    if (resolve_server(&server_info) != 0) {
+        return 1;
+    }
+
+    //* virtual users
+    if (load_args.prefix == "") {
+        load_args.prefix = "load" + std::to_string(getpid()) + "-";
+    }
+    users = std::vector<s_user>(load_args.users);
+    for (int i = 0; i < load_args.users; i++) {
+        users[i].name = load_args.prefix + std::to_string(i);
+    }
+    //* the body contains the escaped characters, so escaping is part of the load
+    const std::string pattern = "Load test message with \"quotes\", \\backslashes\\ and\nnew lines. ";
+    while (body.size() < load_args.body_size) {
+        body += pattern;
+    }
+    body.resize(load_args.body_size);
+
+    int threads = load_args.threads > 0 ? load_args.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, load_args.users);
+
+    //* run the workers
+    std::vector<std::vector<s_stats>> worker_stats(threads, std::vector<s_stats>(LOAD_COMMANDS));
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    end_time = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(load_args.duration));
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(run_worker, i, threads, server_info, &worker_stats[i]);
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    free_server(server_info);
+
+    //* merge the statistics of the workers, the last entry is the total
+    std::vector<s_stats> stats(LOAD_COMMANDS + 1);
+    for (auto &worker : worker_stats) {
+        for (int i = 0; i < LOAD_COMMANDS; i++) {
+            for (s_stats *target : {&stats[i], &stats[LOAD_COMMANDS]}) {
+                histogram_merge(target->latency, worker[i].latency);
+                target->ok += worker[i].ok;
+                target->err += worker[i].err;
+                target->failed += worker[i].failed;
+            }
+        }
+    }
+
+    if (load_args.json) {
+        print_json(stats, elapsed);
+    } else {
+        print_text(stats, elapsed);
+    }
+
+    return stats[LOAD_COMMANDS].failed > 0 ? 2 : 0;
+}
+
+void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"address", 1, 0, 'a'},
+                {"port", 1, 0, 'p'},
+                {"users", 1, 0, 'u'},
+                {"threads", 1, 0, 't'},
+                {"rate", 1, 0, 'r'},
+                {"duration", 1, 0, 'd'},
+                {"mix", 1, 0, 'm'},
+                {"body-size", 1, 0, 'b'},
+                {"prefix", 1, 0, 'n'},
+                {"json", 0, 0, 'j'},
+                {"histogram", 0, 0, 'H'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "a:p:u:t:r:d:m:b:n:jHh", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 'a':
+                args.addr = optarg;
+                break;
+            case 'p':
+                args.port = optarg;
+                break;
+            case 'u':
+                load_args.users = atoi(optarg);
+                break;
+            case 't':
+                load_args.threads = atoi(optarg);
+                break;
+            case 'r':
+                load_args.rate = atof(optarg);
+                break;
+            case 'd':
+                load_args.duration = atof(optarg);
+                break;
+            case 'm':
+                if (parse_mix(optarg) != 0) {
+                    exit(1);
+                }
+                break;
+            case 'b':
+                load_args.body_size = strtoul(optarg, NULL, 10);
+                break;
+            case 'n':
+                load_args.prefix = optarg;
+                break;
+            case 'j':
+                load_args.json = true;
+                break;
+            case 'H':
+                load_args.histogram = true;
+                break;
+            case 'h':
+                p_help();
+                break;
+            case '?':
+                exit(1);
+        }
+    }
+
+    //! no positional arguments
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument %s. See --help.\n", argv[optind]);
+        exit(1);
+    }
+    //! invalid values
+    if (load_args.users < 1 || load_args.threads < 0 || load_args.rate < 0 || load_args.duration <= 0) {
+        fprintf(stderr, "Invalid number of users, threads, rate or duration. See --help.\n");
+        exit(1);
+    }
+}
+
+void p_help() {
+    printf("usage: loadgen [ <option> ... ]\n <option> is one of\n-a <addr>, --address <addr>\nServer hostname or address to connect to\n-p <port>, --port <port>\nServer port to connect to\n");
+    printf("-u <count>, --users <count>\nNumber of virtual users\n-t <count>, --threads <count>\nNumber of worker threads, number of cores by default\n");
+    printf("-r <rate>, --rate <rate>\nTarget requests per second of all workers, unlimited by default\n-d <sec>, --duration <sec>\nLength of the run\n");
+    printf("-m <mix>, --mix <mix>\nCommand weights, e.g. \"register=0,login=1,send=4,list=4,fetch=4,logout=1\"\n-b <bytes>, --body-size <bytes>\nSize of the sent message bodies\n");
+    printf("-n <prefix>, --prefix <prefix>\nUser name prefix, unique per run by default\n-j, --json\nPrint the report as JSON\n-H, --histogram\nPrint the percentile distribution of each command\n--help, -h\nShow this help\n");
+    exit(0);
+}
+
+int parse_mix(std::string mix) {
+    int weights[LOAD_COMMANDS] = {0};
+    size_t start = 0;
+
+    while (start < mix.size()) {
+        size_t end = mix.find(',', start);
+        if (end == std::string::npos) {
+            end = mix.size();
+        }
+        std::string item = mix.substr(start, end - start);
+        size_t eq = item.find('=');
+        int i = 0;
+        while (i < LOAD_COMMANDS && (eq == std::string::npos || item.compare(0, eq, load_commands[i]) != 0)) {
+            i++;
+        }
+        //! unknown command or missing weight
+        if (i == LOAD_COMMANDS || atoi(item.c_str() + eq + 1) < 0) {
+            fprintf(stderr, "Invalid command mix item %s. See --help.\n", item.c_str());
+            return 1;
+        }
+        weights[i] = atoi(item.c_str() + eq + 1);
+        start = end + 1;
+    }
+
+    //! at least one of the commands run by logged in users
+    if (weights[0] + weights[1] + weights[2] + weights[3] + weights[4] + weights[5] == 0) {
+        fprintf(stderr, "Invalid command mix, all weights are zero. See --help.\n");
+        return 1;
+    }
+    std::copy(weights, weights + LOAD_COMMANDS, load_args.weights);
+    return 0;
+}
+
+void run_worker(int worker, int threads, struct addrinfo *server_info, std::vector<s_stats> *stats) {
+    s_worker state;
+    auto interval = std::chrono::steady_clock::duration::zero();
+    auto next = std::chrono::steady_clock::now();
+
+    state.rng.seed(std::random_device{}() + worker);
+    state.stats = stats;
+    if (engine_init(state.engine, server_info) != 0) {
+        return;
+    }
+    for (size_t index = worker; index < users.size(); index += threads) {
+        users[index].conn = engine_open(state.engine);
+        state.idle.push_back(index);
+    }
+    //* each worker keeps its share of the target rate
+    if (load_args.rate > 0) {
+        interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(threads / load_args.rate));
+    }
+
+    while (1) {
+        auto now = std::chrono::steady_clock::now();
+        bool rate = interval != interval.zero();
+
+        //* idle users start their next request, with a target rate only the due ones do
+        //* (users that failed at once are started again in the next round)
+        for (size_t ready = state.idle.size(); ready > 0; ready--) {
+            auto scheduled = now;
+            if (rate && (next >= end_time || next > now)) {
+                break;
+            } else if (!rate && now >= end_time) {
+                break;
+            } else if (rate) {
+                scheduled = next;
+                next += interval;
+            }
+            size_t index = state.idle.front();
+            state.idle.pop_front();
+            start_request(state, index, scheduled);
+        }
+
+        bool running = rate ? next < end_time : now < end_time;
+        if (!running && state.engine.pending == 0) {
+            break;
+        }
+        int timeout = -1;
+        if (running && !state.idle.empty()) {
+            timeout = rate ? std::max<int64_t>(0, std::chrono::ceil<std::chrono::milliseconds>(next - now).count()) : 0;
+        }
+        if (engine_poll(state.engine, timeout) != 0) {
+            break;
+        }
+    }
+    engine_free(state.engine);
+}
+
+void start_request(s_worker &worker, size_t index, std::chrono::steady_clock::time_point scheduled) {
+    s_user &user = users[index];
+    int command = pick_command(user, worker.rng);
+    std::string name = load_commands[command];
+    std::vector<std::string> words = {name};
+    s_engine_request request;
+
+    //* command arguments
+    if (name == "register") {
+        words.push_back(user.registered ? user.name + "." + std::to_string(++user.registrations) : user.name);
+        words.push_back("load");
+    } else if (name == "login") {
+        words.push_back(user.name);
+        words.push_back("load");
+    } else if (name == "send") {
+        words.push_back(users[(index + 1) % users.size()].name);
+        words.push_back("load " + std::to_string(worker.rng() % 1000));
+        words.push_back(body);
+    } else if (name == "fetch") {
+        int inbox = user.inbox.load();
+        words.push_back(std::to_string(inbox > 0 ? worker.rng() % inbox + 1 : 1));
+    }
+    std::string target = words.size() > 1 ? words[1] : "";
+
+    //* build the request with the encoder of the client, the arguments are kept with it
+    std::shared_ptr<std::vector<std::string>> values = std::make_shared<std::vector<std::string>>(words.begin() + 1, words.end());
+    s_request_args arguments;
+    arguments.values.assign(values->begin(), values->end());
+    arguments.token = user.token;
+    int entry = find_command(name);
+    if (entry == -1 || encode_request(entry, arguments, request.message) != 0) {
+        request.message = s_message();
+    } else {
+        request.read_only = command_table[entry].read_only;
+    }
+
+    request.on_done = [&worker, index, command, target, scheduled, values](int status, std::string reply) {
+        int result = resolve_reply(index, command, target, status, reply);
+        auto latency = std::chrono::steady_clock::now() - scheduled;
+
+        s_stats &command_stats = (*worker.stats)[command];
+        histogram_record(command_stats.latency, std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+        if (result == 0) {
+            command_stats.ok++;
+        } else if (result == 1) {
+            command_stats.err++;
+        } else {
+            command_stats.failed++;
+        }
+        worker.idle.push_back(index);
+    };
+    if (request.message.size == 0) {
+        request.on_done(2, "");
+        return;
+    }
+    engine_submit(worker.engine, user.conn, std::move(request));
+}
+
+int pick_command(s_user &user, std::mt19937_64 &rng) {
+    //* the account and the login token come first
+    if (!user.registered) {
+        return 0;
+    }
+    if (user.token == "") {
+        return 1;
+    }
+    int sum = 0;
+    for (int i = 0; i < LOAD_COMMANDS; i++) {
+        sum += load_args.weights[i];
+    }
+    int pick = rng() % sum;
+    int command = 0;
+    while (pick >= load_args.weights[command]) {
+        pick -= load_args.weights[command];
+        command++;
+    }
+    return command;
+}
+
+int resolve_reply(size_t index, int command, std::string target, int status, std::string reply) {
+    s_user &user = users[index];
+    std::string name = load_commands[command];
+
+    //* reply state and token
+    if (status != 0) {
+        return 2;
+    }
+    bool ok = reply.compare(0, 3, "(ok") == 0;
+    std::vector<std::string> fields = split_response(reply);
+    if (!ok && (reply.compare(0, 4, "(err") != 0 || fields.empty())) {
+        return 2;
+    }
+    if (name == "register" && target == user.name) {
+        user.registered = true; // also if registered by a previous run
+    }
+    if (!ok) {
+        return 1;
+    }
+    if (name == "login") {
+        if (fields.size() < 2) {
+            return 2;
+        }
+        user.token = "\"" + fields[1] + "\"";
+    } else if (name == "logout") {
+        user.token = "";
+    } else if (name == "send") {
+        users[(index + 1) % users.size()].inbox++;
+    }
+    return 0;
+}
+
+void print_text(const std::vector<s_stats> &stats, double elapsed) {
+    printf("%d users, %s for %.2f s, target rate %s\n", load_args.users, (args.addr + ":" + args.port).c_str(), elapsed,
+        load_args.rate > 0 ? (std::to_string((int)load_args.rate) + " req/s").c_str() : "unlimited");
+    printf("%-9s %9s %9s %7s %7s %10s %9s %9s %9s %9s %9s %9s\n", "command", "count", "ok", "err", "failed", "req/s",
+        "mean ms", "p50 ms", "p90 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_stats &s = stats[i];
+        const s_histogram &h = s.latency;
+        printf("%-9s %9lu %9lu %7lu %7lu %10.1f %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+            i < LOAD_COMMANDS ? load_commands[i] : "total", h.total, s.ok, s.err, s.failed, h.total / elapsed,
+            h.total ? h.sum / h.total / 1000 : 0, histogram_percentile(h, 50) / 1000.0, histogram_percentile(h, 90) / 1000.0,
+            histogram_percentile(h, 99) / 1000.0, histogram_percentile(h, 99.9) / 1000.0, h.total ? h.max / 1000.0 : 0);
+    }
+
+    if (!load_args.histogram) {
+        return;
+    }
+    //* percentile distribution, the steps halve towards the maximum as in HdrHistogram
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_histogram &h = stats[i].latency;
+        if (h.total == 0) {
+            continue;
+        }
+        printf("\n%s\n%12s %14s %10s %14s\n", i < LOAD_COMMANDS ? load_commands[i] : "total", "Value (ms)", "Percentile", "TotalCount", "1/(1-Percentile)");
+        for (int half = 0; ; half++) {
+            double remaining = std::pow(0.5, half);
+            bool last = remaining * h.total < 1;
+            for (int tick = 0; tick < 5 && !last; tick++) {
+                double percentile = 1 - remaining * (1 - tick / 10.0);
+                uint64_t value = histogram_percentile(h, percentile * 100);
+                printf("%12.3f %14.12f %10lu %14.2f\n", value / 1000.0, percentile, (uint64_t)std::ceil(percentile * h.total), 1 / (1 - percentile));
+            }
+            if (last) {
+                printf("%12.3f %14.12f %10lu %14s\n", h.max / 1000.0, 1.0, h.total, "inf");
+                break;
+            }
+        }
+        printf("#[Mean = %.3f, Max = %.3f, Total count = %lu]\n", h.sum / h.total / 1000, h.max / 1000.0, h.total);
+    }
+}
+
+void print_json(const std::vector<s_stats> &stats, double elapsed) {
+    printf("{\"address\":\"%s\",\"port\":\"%s\",\"users\":%d,\"rate\":%g,\"elapsed_s\":%.6f,\"commands\":{",
+        char_to_escaped(args.addr).c_str(), char_to_escaped(args.port).c_str(), load_args.users, load_args.rate, elapsed);
+    for (size_t i = 0; i < stats.size(); i++) {
+        const s_stats &s = stats[i];
+        const s_histogram &h = s.latency;
+        if (i == LOAD_COMMANDS) {
+            printf("},\"total\":");
+        } else {
+            printf("%s\"%s\":", i > 0 ? "," : "", load_commands[i]);
+        }
+        printf("{\"count\":%lu,\"ok\":%lu,\"err\":%lu,\"failed\":%lu,\"throughput\":%.3f,", h.total, s.ok, s.err, s.failed, h.total / elapsed);
+        printf("\"latency_us\":{\"min\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu},",
+            h.total ? h.min : 0, h.total ? h.sum / h.total : 0, histogram_percentile(h, 50), histogram_percentile(h, 90),
+            histogram_percentile(h, 99), histogram_percentile(h, 99.9), h.max);
+        //* non-empty buckets as [highest equivalent value, count]
+        printf("\"histogram\":[");
+        bool first = true;
+        for (size_t j = 0; j < h.counts.size(); j++) {
+            if (h.counts[j] > 0) {
+                printf("%s[%lu,%lu]", first ? "" : ",", histogram_value(j), h.counts[j]);
+                first = false;
+            }
+        }
+        printf("]}");
+    }
+    printf("}\n");
+}
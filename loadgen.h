@@ -0,0 +1,125 @@
+/**
+ * @file loadgen.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - multi-user load generator, header.
+ *
+ **/
+
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <sys/resource.h>
+#include "engine.h"
+#include "histogram.h"
+
+#define LOAD_COMMANDS 6 // register, login, send, list, fetch, logout
+
+const char *const load_commands[LOAD_COMMANDS] = {"register", "login", "send", "list", "fetch", "logout"};
+
+struct s_load_args {
+    int users = 10; // number of virtual users
+    int threads = 0; // worker threads, number of cores if 0
+    double rate = 0; // target requests per second of all workers, unlimited if 0
+    double duration = 10; // seconds
+    int weights[LOAD_COMMANDS] = {0, 1, 4, 4, 4, 1}; // command mix, in the order of load_commands
+    size_t body_size = 256; // bytes of each sent message body
+    std::string prefix = ""; // user name prefix, unique per run if empty
+    bool json = false; // print the report as JSON
+    bool histogram = false; // print the percentile distribution of each command
+} load_args;
+
+struct s_stats {
+    s_histogram latency; // microseconds
+    uint64_t ok = 0; // ok replies
+    uint64_t err = 0; // err replies
+    uint64_t failed = 0; // no or malformed reply
+};
+
+struct s_user {
+    std::string name;
+    std::string token = ""; // quoted login token, empty if not logged in
+    int conn = -1; // connection kept between requests, in the engine of the worker
+    bool registered = false;
+    int registrations = 0; // extra accounts created by the register command of the mix
+    std::atomic<int> inbox{0}; // messages sent to the user during the run
+};
+
+struct s_worker {
+    s_engine engine; // connections of the users of the worker
+    std::mt19937_64 rng;
+    std::vector<s_stats> *stats; // statistics of the worker, one per command
+    std::deque<size_t> idle; // users without a request in flight
+};
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+void parseargs(int argc, char** argv);
+
+/**
+ * Print help.
+ */
+void p_help();
+
+/**
+ * Parse the command mix, e.g. "send=4,list=4,fetch=4,login=1,logout=1".
+ * @param mix Command weights.
+ * @return 1 if an error occurs, else 0.
+ */
+int parse_mix(std::string mix);
+
+/**
+ * Run the requests of one worker thread until the duration elapses.
+ * @param worker Worker index, the worker serves every threads-th user starting at this index.
+ * @param threads Number of worker threads.
+ * @param server_info Resolved server addresses.
+ * @param stats Statistics of the worker, one per command.
+ */
+void run_worker(int worker, int threads, struct addrinfo *server_info, std::vector<s_stats> *stats);
+
+/**
+ * Choose the next command of the user according to the mix.
+ * @param user Virtual user.
+ * @param rng Random generator of the worker.
+ * @return Index of the command in load_commands.
+ */
+int pick_command(s_user &user, std::mt19937_64 &rng);
+
+/**
+ * Submit the next request of the user, its latency and result are recorded once it completes.
+ * @param worker Worker state.
+ * @param index Index of the user.
+ * @param scheduled Time the request was due, the latency is measured from it.
+ */
+void start_request(s_worker &worker, size_t index, std::chrono::steady_clock::time_point scheduled);
+
+/**
+ * Check the reply and update the user according to it.
+ * @param index Index of the user.
+ * @param command Index of the command in load_commands.
+ * @param target First argument of the request (user name for register).
+ * @param status Completion status from the engine.
+ * @param reply Received reply.
+ * @return 0 for an ok reply, 1 for an err reply, 2 if no valid reply was received.
+ */
+int resolve_reply(size_t index, int command, std::string target, int status, std::string reply);
+
+/**
+ * Print the report as a text table.
+ * @param stats Statistics of all commands, the last one is the total.
+ * @param elapsed Seconds of the run.
+ */
+void print_text(const std::vector<s_stats> &stats, double elapsed);
+
+/**
+ * Print the report as JSON.
+ * @param stats Statistics of all commands, the last one is the total.
+ * @param elapsed Seconds of the run.
+ */
+void print_json(const std::vector<s_stats> &stats, double elapsed);
@@ -0,0 +1,252 @@
+/**
+ * @file microbench.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - benchmark of the client hot paths.
+ *
+ * Measures the parsing, escaping and request building functions of the client on synthetic
+ * mailboxes of 10 to 100k messages and message bodies of 1 KB to 100 MB, and writes the results
+ * as JSON so runs can be compared over time (make bench writes bench.json).
+ * special_to_char and escaped_to_special were replaced by unescape_field, it is measured instead.
+ *
+ * usage: microbench [ <option> ... ]
+ * <option> is one of
+ * -o <file>, --output <file>
+ *    Write the JSON results to the file instead of the standard output
+ * -f <text>, --filter <text>
+ *    Run only the benchmarks whose name contains the text
+ * -q, --quick
+ *    Mailboxes up to 10k messages and bodies up to 1 MB
+ * --help, -h
+ *    Show this help
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <getopt.h>
+#include "base64.h"
+#include "protocol.h"
+#include "request.h"
+
+#define BENCH_MIN_TIME 0.2 // seconds each benchmark runs at least
+#define BENCH_MIN_RUNS 3 // calls each benchmark makes at least
+
+struct s_bench_args {
+    std::string output = ""; // JSON file, standard output if empty
+    std::string filter = ""; // substring of the benchmark names to run
+    bool quick = false; // smaller inputs
+} bench_args;
+
+struct s_result {
+    std::string name; // measured function
+    std::string input; // input case, e.g. "list/1000" or "body/1048576"
+    size_t bytes; // input bytes processed by one call
+    size_t runs; // number of calls
+    double mean_ns; // mean time of a call
+    double min_ns; // fastest call
+};
+
+static std::vector<s_result> results;
+static volatile size_t sink = 0; // keeps the results of the calls from being optimised out
+
+/**
+ * Run the function repeatedly and record its time per call.
+ * @param name Measured function.
+ * @param input Input case.
+ * @param bytes Input bytes processed by one call.
+ * @param fn Measured call, returns a size that is kept.
+ */
+template <typename F>
+static void measure(std::string name, std::string input, size_t bytes, F fn) {
+    using clock = std::chrono::steady_clock;
+
+    if (name.find(bench_args.filter) == std::string::npos) {
+        return;
+    }
+    size_t runs = 0;
+    double min_ns = 1e300, total_ns = 0;
+    while (runs < BENCH_MIN_RUNS || total_ns < BENCH_MIN_TIME * 1e9) {
+        auto start = clock::now();
+        sink += fn();
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        min_ns = std::min(min_ns, ns);
+        total_ns += ns;
+        runs++;
+    }
+    results.push_back({name, input, bytes, runs, total_ns / runs, min_ns});
+    fprintf(stderr, "%-18s %-16s %12zu %8zu %14.0f %14.0f %10.1f\n", name.c_str(), input.c_str(), bytes, runs,
+        total_ns / runs, min_ns, bytes / (total_ns / runs) * 1e3);
+}
+
+/**
+ * Build a body of the given size with the characters the protocol escapes.
+ * @param size Size in bytes.
+ * @return Unescaped body.
+ */
+static std::string make_body(size_t size) {
+    const std::string pattern = "Benchmark message with \"quotes\", \\backslashes\\ and\nnew lines, mostly plain text. ";
+    std::string body;
+    body.reserve(size);
+    while (body.size() < size) {
+        body += pattern;
+    }
+    body.resize(size);
+    return body;
+}
+
+/**
+ * Build a list reply of the given number of messages as the server sends it.
+ * @param count Number of messages.
+ * @return Server response.
+ */
+static std::string make_list(size_t count) {
+    std::string reply = "(ok (";
+    for (size_t i = 1; i <= count; i++) {
+        reply += (i > 1 ? " (" : "(") + std::to_string(i) + " \"sender" + std::to_string(i % 97)
+            + "\" \"" + char_to_escaped("subject \"" + std::to_string(i) + "\" of the message") + "\")";
+    }
+    return reply + "))";
+}
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+static void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"output", 1, 0, 'o'},
+                {"filter", 1, 0, 'f'},
+                {"quick", 0, 0, 'q'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "o:f:qh", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 'o':
+                bench_args.output = optarg;
+                break;
+            case 'f':
+                bench_args.filter = optarg;
+                break;
+            case 'q':
+                bench_args.quick = true;
+                break;
+            case 'h':
+                printf("usage: microbench [ <option> ... ]\n <option> is one of\n-o <file>, --output <file>\nWrite the JSON results to the file instead of the standard output\n");
+                printf("-f <text>, --filter <text>\nRun only the benchmarks whose name contains the text\n-q, --quick\nMailboxes up to 10k messages and bodies up to 1 MB\n--help, -h\nShow this help\n");
+                exit(0);
+            case '?':
+                exit(1);
+        }
+    }
+    //! no positional arguments
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument %s. See --help.\n", argv[optind]);
+        exit(1);
+    }
+}
+
+/**
+ * Write the results as JSON.
+ * @param file Output file.
+ */
+static void print_json(FILE *file) {
+    fprintf(file, "{\"timestamp\":%ld,\"compiler\":\"%s\",\"base64\":\"%s\",\"quick\":%s,\"results\":[", (long)time(NULL),
+        char_to_escaped(__VERSION__).c_str(), encoding::Base64::Implementation(), bench_args.quick ? "true" : "false");
+    for (size_t i = 0; i < results.size(); i++) {
+        const s_result &r = results[i];
+        fprintf(file, "%s\n{\"name\":\"%s\",\"input\":\"%s\",\"bytes\":%zu,\"runs\":%zu,\"mean_ns\":%.0f,\"min_ns\":%.0f,\"mb_per_s\":%.3f}",
+            i > 0 ? "," : "", r.name.c_str(), r.input.c_str(), r.bytes, r.runs, r.mean_ns, r.min_ns, r.bytes / r.mean_ns * 1e3);
+    }
+    fprintf(file, "\n]}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    parseargs(argc, argv);
+    size_t max_list = bench_args.quick ? 10000 : 100000;
+    size_t max_body = bench_args.quick ? (1 << 20) : 100 << 20;
+
+    //* requests are built with the token of a session, the token file is not read
+    session.active = true;
+    session.token = "\"" + encoding::Base64::Encode("bench" + std::to_string(time(NULL))) + "\"";
+
+    fprintf(stderr, "%-18s %-16s %12s %8s %14s %14s %10s\n", "name", "input", "bytes", "runs", "mean ns", "min ns", "MB/s");
+
+    //* mailboxes
+    for (size_t count = 10; count <= max_list; count *= 10) {
+        std::string reply = make_list(count);
+        std::string input = "list/" + std::to_string(count);
+        measure("split_response", input, reply.size(), [&] { return split_response(reply).size(); });
+        measure("parse_response", input, reply.size(), [&] { s_reply parsed; parse_response(reply, parsed); return parsed.fields.size(); });
+        measure("terminal_response", input, reply.size(), [&] { return terminal_response(reply, "list").size(); });
+        measure("frame_reply", input, reply.size(), [&] { s_framer framer; return frame_reply(framer, reply.data(), reply.size()); });
+    }
+
+    //* message bodies, 1 KB and then 16 times larger up to 100 MB
+    std::vector<size_t> sizes;
+    for (size_t size = 1 << 10; size < max_body; size *= 16) {
+        sizes.push_back(size);
+    }
+    sizes.push_back(max_body);
+    for (size_t size : sizes) {
+        std::string body = make_body(size);
+        std::string escaped = char_to_escaped(body);
+        std::string reply = "(ok (\"sender\" \"subject\" \"" + escaped + "\"))";
+        std::string input = "body/" + std::to_string(size);
+
+        measure("split_response", input, reply.size(), [&] { return split_response(reply).size(); });
+        measure("parse_response", input, reply.size(), [&] { s_reply parsed; parse_response(reply, parsed); return parsed.fields.size(); });
+        measure("terminal_response", input, reply.size(), [&] { return terminal_response(reply, "fetch").size(); });
+        measure("decode_reply", input, reply.size(), [&] {
+            s_decoder decoder;
+            size_t received = 0;
+            decoder.stream_field = 2;
+            decoder.on_state = [](bool) {};
+            decoder.on_field = [](std::string_view) {};
+            decoder.on_body = [&](std::string_view part) { received += part.size(); };
+            decode_reply(decoder, reply.data(), reply.size());
+            return received;
+        });
+        measure("replace_all", input, escaped.size(), [&] { return replace_all(escaped, "\\\"", "\"").size(); });
+        measure("char_to_escaped", input, body.size(), [&] { return char_to_escaped(body).size(); });
+        measure("unescape_field", input, escaped.size(), [&] {
+            std::string arena;
+            arena.reserve(escaped.size());
+            return unescape_field(escaped, arena, false).size();
+        });
+        measure("get_message", input, body.size(), [&] {
+            char *words[] = {(char *)"send", (char *)"recipient", (char *)"subject", (char *)body.c_str()};
+            optind = 0;
+            return get_message(4, words, "send").size();
+        });
+        measure("Base64::Encode", input, body.size(), [&] { return encoding::Base64::Encode(body).size(); });
+    }
+
+    //* the JSON goes to the file or to the standard output, the table to the standard error
+    FILE *file = stdout;
+    if (bench_args.output != "" && (file = fopen(bench_args.output.c_str(), "w")) == NULL) {
+        perror("Error while writing the results");
+        return 1;
+    }
+    print_json(file);
+    if (file != stdout) {
+        fclose(file);
+    }
+    return 0;
+}
@@ -0,0 +1,264 @@
+/**
+ * @file protocol.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - message framing, parsing and escaping shared by the client and the server.
+ * 
+ * Messages are S-expressions, for example
+ *  (login "user" "cGFzc3dvcmQ=")
+ *  (ok "user logged in" "dXNlcjE2MzY5MTQyOTgwODAuNTQxNQ==")
+ * Quoted strings escape backslash, quote and newline with a backslash.
+ */
+
+#include "protocol.h"
+
+size_t decode_reply(s_decoder &decoder, const char *data, size_t len) {
+    size_t i = 0;
+
+    while (i < len && !decoder.done) {
+        char c = data[i];
+        bool streamed = decoder.state == 1 && decoder.field_count == decoder.stream_field;
+        if (decoder.quoted) {
+            if (decoder.escaped) {
+                //* only escaped backslash and quote (and newline if asked) are replaced, other sequences are kept as they are
+                char sequence[2] = {'\\', c};
+                bool replaced = c == '\\' || c == '"';
+                if (c == 'n' && decoder.newlines) {
+                    sequence[1] = '\n';
+                    replaced = true;
+                }
+                decoder_append(decoder, replaced ? sequence + 1 : sequence, replaced ? 1 : 2, streamed);
+                decoder.escaped = false;
+                i++;
+            } else if (c == '\\') {
+                decoder.escaped = true;
+                i++;
+            } else if (c == '"') {
+                //* field complete
+                if (!streamed) {
+                    decoder.on_field(decoder.field);
+                }
+                decoder.field.clear();
+                decoder.field_count++;
+                decoder.quoted = false;
+                i++;
+            } else {
+                //* pass the whole run of ordinary characters at once
+                size_t end = i + encoding::Escape::FindQuoteOrBackslash(data + i, len - i);
+                decoder_append(decoder, data + i, end - i, streamed);
+                i = end;
+            }
+            continue;
+        }
+
+        if (c == '(' || c == ')' || c == '"' || isspace((unsigned char)c)) {
+            //* the first word of the reply is its state, other words (message ids) are skipped
+            if (decoder.atom != "" && decoder.state == -1) {
+                if (decoder.atom == "ok" || decoder.atom == "err") {
+                    decoder.state = decoder.atom == "ok";
+                    decoder.on_state(decoder.state == 1);
+                } else {
+                    decoder.failed = true;
+                }
+            }
+            decoder.atom.clear();
+            if (c == '(') {
+                decoder.depth++;
+            } else if (c == ')') {
+                decoder.done = --decoder.depth == 0;
+            } else if (c == '"') {
+                decoder.quoted = true;
+                decoder.failed = decoder.failed || decoder.state == -1;
+            }
+        } else if (decoder.depth == 0) {
+            decoder.failed = true;
+        } else if (decoder.state == -1) {
+            decoder.atom += c;
+        }
+        if (decoder.failed) {
+            decoder.done = true;
+        }
+        i++;
+    }
+    return i;
+}
+
+void decoder_append(s_decoder &decoder, const char *data, size_t len, bool streamed) {
+    if (streamed) {
+        decoder.on_body(std::string_view(data, len));
+    } else {
+        decoder.field.append(data, len);
+    }
+}
+
+size_t frame_reply(s_framer &framer, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+        if (framer.escaped) {
+            framer.escaped = false;
+        } else if (framer.quoted) {
+            //* skip the whole run of ordinary characters in the string at once
+            i += encoding::Escape::FindQuoteOrBackslash(data + i, len - i);
+            if (i == len) {
+                break;
+            }
+            if (data[i] == '\\') {
+                framer.escaped = true;
+            } else {
+                framer.quoted = false;
+            }
+        } else if (c == '"') {
+            framer.quoted = true;
+        } else if (c == '(') {
+            framer.depth++;
+        } else if (c == ')') {
+            //* closing the outermost parenthesis ends the reply
+            if (--framer.depth == 0) {
+                return i + 1;
+            }
+        }
+    }
+    return std::string::npos;
+}
+
+int parse_response(std::string_view server_response, s_reply &reply) {
+    size_t len = server_response.size();
+    const char *data = server_response.data();
+    size_t i = 0;
+
+    reply.fields.clear();
+    reply.arena.clear();
+    //* unescaped fields are never longer than the response, the arena is never reallocated
+    reply.arena.reserve(len);
+
+    //* response state
+    while (i < len && isspace((unsigned char)data[i])) { i++; }
+    if (i == len || data[i++] != '(') {
+        return 1;
+    }
+    size_t state_start = i;
+    while (i < len && data[i] != ' ' && data[i] != '(' && data[i] != ')' && data[i] != '"') { i++; }
+    std::string_view state = server_response.substr(state_start, i - state_start);
+    if (state == "ok") {
+        reply.ok = true;
+    } else if (state == "err") {
+        reply.ok = false;
+    } else {
+        return 1;
+    }
+
+    //* collect the quoted strings, everything else is structure or message ids
+    while (i < len) {
+        if (data[i++] != '"') {
+            continue;
+        }
+        size_t start = i;
+        bool escaped = false;
+        while ((i += encoding::Escape::FindQuoteOrBackslash(data + i, len - i)) < len && data[i] != '"') {
+            //* skip the escaped character
+            escaped = true;
+            if (i + 1 >= len) {
+                return 1; // backslash at the end, unterminated string
+            }
+            i += 2;
+        }
+        if (i >= len) {
+            return 1; // unterminated string
+        }
+        std::string_view field = server_response.substr(start, i - start);
+        reply.fields.push_back(escaped ? unescape_field(field, reply.arena, reply.newlines) : field);
+        i++;
+    }
+    return 0;
+}
+
+std::string_view unescape_field(std::string_view field, std::string &arena, bool newlines) {
+    size_t start = arena.size();
+    //* the capacity is reserved, resizing does not move the other fields
+    arena.resize(start + field.size());
+    arena.resize(start + encoding::Escape::Decode(field, &arena[start], newlines));
+    return std::string_view(arena).substr(start);
+}
+
+std::vector<std::string> split_response(std::string server_response) {
+    s_reply reply;
+    if (parse_response(server_response, reply) != 0) {
+        return {};
+    }
+    return std::vector<std::string>(reply.fields.begin(), reply.fields.end());
+}
+
+std::string replace_all(std::string msg, std::string replaced, std::string replace) {
+    size_t index = 0, found;
+    if (replaced.empty()) {
+        return msg;
+    }
+    //* the parts are appended to a new string, replacing in place moves the rest of the string each time
+    std::string result;
+    result.reserve(msg.size());
+    while ((found = msg.find(replaced, index)) != std::string::npos) {
+        result.append(msg, index, found - index);
+        result += replace;
+        index = found + replaced.size();
+    }
+    result.append(msg, index, std::string::npos);
+    return result;
+}
+
+std::string char_to_escaped(std::string_view input_msg) {
+    return encoding::Escape::Encode(input_msg);
+}
+
+int parse_request(std::string_view request, s_request &parsed) {
+    size_t len = request.size();
+    const char *data = request.data();
+    size_t i = 0;
+
+    parsed.command = std::string_view();
+    parsed.args.clear();
+    parsed.quoted.clear();
+
+    //* command
+    while (i < len && isspace((unsigned char)data[i])) { i++; }
+    if (i == len || data[i++] != '(') {
+        return 1;
+    }
+    size_t start = i;
+    while (i < len && data[i] != ' ' && data[i] != '(' && data[i] != ')' && data[i] != '"') { i++; }
+    parsed.command = request.substr(start, i - start);
+    if (parsed.command.empty()) {
+        return 1;
+    }
+
+    //* arguments up to the closing parenthesis
+    while (i < len) {
+        char c = data[i];
+        if (isspace((unsigned char)c)) {
+            i++;
+        } else if (c == ')') {
+            return 0;
+        } else if (c == '"') {
+            start = ++i;
+            while ((i += encoding::Escape::FindQuoteOrBackslash(data + i, len - i)) < len && data[i] != '"') {
+                if (i + 1 >= len) {
+                    return 1; // backslash at the end, unterminated string
+                }
+                i += 2; // skip the escaped character
+            }
+            if (i >= len) {
+                return 1; // unterminated string
+            }
+            parsed.args.push_back(request.substr(start, i - start));
+            parsed.quoted.push_back(true);
+            i++;
+        } else if (c == '(') {
+            return 1; // requests are not nested
+        } else {
+            start = i;
+            while (i < len && !isspace((unsigned char)data[i]) && data[i] != '(' && data[i] != ')' && data[i] != '"') { i++; }
+            parsed.args.push_back(request.substr(start, i - start));
+            parsed.quoted.push_back(false);
+        }
+    }
+    return 1; // missing closing parenthesis
+}
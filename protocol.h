@@ -0,0 +1,132 @@
+/**
+ * @file protocol.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - message framing, parsing and escaping shared by the client and the server, header.
+ * 
+ **/
+
+#ifndef _PROTOCOL_H_
+#define _PROTOCOL_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cctype>
+#include "escape.h"
+
+struct s_framer {
+    int depth = 0; // parenthesis nesting
+    bool quoted = false; // inside of a quoted string
+    bool escaped = false; // previous character was a backslash
+};
+
+struct s_decoder {
+    int depth = 0; // parenthesis nesting
+    bool quoted = false; // inside of a quoted string
+    bool escaped = false; // previous character was a backslash
+    bool done = false; // end of the reply reached
+    bool failed = false; // reply is malformed
+    int state = -1; // 1 for ok, 0 for err, -1 if not received yet
+    std::string atom = ""; // unquoted word being received
+    std::string field = ""; // quoted string being received
+    bool newlines = false; // an escaped newline is passed on as a newline, else as it was sent
+    size_t field_count = 0; // number of completed quoted strings
+    size_t stream_field = std::string::npos; // index of the field passed to on_body in parts (successful replies only)
+    std::function<void(bool)> on_state; // reply state received
+    std::function<void(std::string_view)> on_field; // quoted string completed
+    std::function<void(std::string_view)> on_body; // part of the streamed field received
+};
+
+struct s_reply {
+    bool ok = false; // response state
+    std::vector<std::string_view> fields; // quoted parts of the response
+    std::string arena = ""; // storage of fields that had to be unescaped
+    bool newlines = false; // set before parsing: an escaped newline is decoded into a newline, else kept as sent
+};
+
+struct s_request {
+    std::string_view command; // first word of the request
+    std::vector<std::string_view> args; // arguments, quoted strings are kept escaped as sent
+    std::vector<bool> quoted; // true if the argument at the same index was a quoted string
+};
+
+/**
+ * Decode a part of the reply and pass the decoded parts to the decoder callbacks.
+ * @param decoder Decoder state, kept between calls with consecutive parts of the reply.
+ * @param data Received data.
+ * @param len Length of the data.
+ * @return Number of bytes consumed, less than len if the reply ended.
+ */
+size_t decode_reply(s_decoder &decoder, const char *data, size_t len);
+
+/**
+ * Append unescaped characters to the current field, or pass them on if the field is streamed.
+ * @param decoder Decoder state.
+ * @param data Unescaped characters.
+ * @param len Number of characters.
+ * @param streamed True if the current field is streamed.
+ */
+void decoder_append(s_decoder &decoder, const char *data, size_t len, bool streamed);
+
+/**
+ * Scan received data for the end of a message (the outermost closing parenthesis outside of quoted strings).
+ * @param framer Framing state, kept between calls with consecutive parts of the message.
+ * @param data Received data.
+ * @param len Length of the data.
+ * @return Number of bytes up to the end of the message, or std::string::npos if the message continues.
+ */
+size_t frame_reply(s_framer &framer, const char *data, size_t len);
+
+/**
+ * Parse the server response in one pass.
+ * Fields point into the response, or into the reply arena if they had to be unescaped.
+ * @param server_response The response sent by server, must outlive the reply.
+ * @param reply Parsed response state and quoted fields.
+ * @return 1 if the response is malformed, else 0.
+ */
+int parse_response(std::string_view server_response, s_reply &reply);
+
+/**
+ * Unescape a quoted field into the arena (only escaped backslash and quote, and newline if asked, are replaced).
+ * @param field Quoted field without the quotes.
+ * @param arena Storage of unescaped fields, must have enough capacity reserved.
+ * @param newlines Decode an escaped newline into a newline.
+ * @return Unescaped field, pointing into the arena.
+ */
+std::string_view unescape_field(std::string_view field, std::string &arena, bool newlines);
+
+/**
+ * Parse the server response to individual parts of the message.
+ * @param server_response The response sent by server.
+ * @return Array of strings (quoted parts of the message), empty if the response is malformed.
+ */
+std::vector<std::string> split_response(std::string server_response);
+
+/**
+ * Replace all occurrences of a substring.
+ * @param msg String.
+ * @param replaced Substring that is being replaced.
+ * @param replace String replacing the substring.
+ * @return Edited string.
+ */
+std::string replace_all(std::string msg, std::string replaced, std::string replace);
+
+/**
+ * Escape special characters (backslash, quote and newline) in one pass.
+ * @param input_msg String.
+ * @return Edited string.
+ */
+std::string char_to_escaped(std::string_view input_msg);
+
+/**
+ * Parse a client request in one pass.
+ * Arguments point into the request.
+ * @param request The request sent by client, must outlive the parsed request.
+ * @param parsed Command and arguments of the request.
+ * @return 1 if the request is malformed, else 0.
+ */
+int parse_request(std::string_view request, s_request &parsed);
+
+#endif /* _PROTOCOL_H_ */
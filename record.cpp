@@ -0,0 +1,481 @@
+/**
+ * @file record.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - machine-readable output records (NDJSON, TSV).
+ *
+ * Each listed or fetched message is one line, written from the fields as they are decoded:
+ *  ndjson  {"id":1,"sender":"...","subject":"..."} and {"id":1,"sender":"...","subject":"...","body":"..."}
+ *  tsv     1<TAB>sender<TAB>subject and 1<TAB>sender<TAB>subject<TAB>body
+ * Other replies are {"ok":true,"message":"..."} or {"ok":false,"error":"..."} (ok or error<TAB>message).
+ * The fields are the same as the text output prints, bytes that are not ASCII are passed as they are.
+ * Input records (send --batch) are read one at a time from CSV or NDJSON.
+ */
+
+#include "record.h"
+
+/**
+ * Build the table of the bytes escaped by a format.
+ * @param format FORMAT_NDJSON or FORMAT_TSV.
+ * @return Escape character by byte (u for \u00XX), 0 if the byte is written as it is.
+ */
+static constexpr std::array<char, 256> record_build_escapes(int format) {
+    std::array<char, 256> escapes = {};
+    if (format == FORMAT_NDJSON) {
+        for (int c = 0; c < 0x20; c++) {
+            escapes[c] = 'u';
+        }
+        escapes['\b'] = 'b';
+        escapes['\f'] = 'f';
+        escapes['"'] = '"';
+    }
+    escapes['\t'] = 't';
+    escapes['\n'] = 'n';
+    escapes['\r'] = 'r';
+    escapes['\\'] = '\\';
+    return escapes;
+}
+
+static constexpr std::array<char, 256> json_escapes = record_build_escapes(FORMAT_NDJSON);
+static constexpr std::array<char, 256> tsv_escapes = record_build_escapes(FORMAT_TSV);
+static std::string scratch = ""; // streamed record being written, the buffer is reused
+
+void record_escape(std::string &out, std::string_view field) {
+    const std::array<char, 256> &escapes = args.format == FORMAT_TSV ? tsv_escapes : json_escapes;
+    static const char hex[] = "0123456789abcdef";
+    size_t start = 0;
+
+    //* runs without anything to escape are appended at once
+    for (size_t i = 0; i < field.size(); i++) {
+        char escape = escapes[(unsigned char)field[i]];
+        if (escape == 0) {
+            continue;
+        }
+        out.append(field.data() + start, i - start);
+        out += '\\';
+        out += escape;
+        if (escape == 'u') {
+            out += "00";
+            out += hex[(unsigned char)field[i] >> 4];
+            out += hex[field[i] & 0xf];
+        }
+        start = i + 1;
+    }
+    out.append(field.data() + start, field.size() - start);
+}
+
+/**
+ * Append a field as a JSON string or a TSV column, with the separator before it.
+ * @param out Output, appended to.
+ * @param name Name of the JSON member.
+ * @param field Field.
+ */
+static void record_field(std::string &out, std::string_view name, std::string_view field) {
+    if (args.format == FORMAT_TSV) {
+        out += '\t';
+        record_escape(out, field);
+        return;
+    }
+    out += ",\"";
+    out += name;
+    out += "\":\"";
+    record_escape(out, field);
+    out += '"';
+}
+
+/**
+ * Append the message id starting a record.
+ * @param out Output, appended to.
+ * @param id Message id, 0 if it is not known (null, an empty column).
+ */
+static void record_id(std::string &out, long id) {
+    if (args.format != FORMAT_TSV) {
+        out += "{\"id\":";
+    }
+    if (id > 0) {
+        out += std::to_string(id);
+    } else if (args.format != FORMAT_TSV) {
+        out += "null";
+    }
+}
+
+void record_listed(std::string &out, long id, std::string_view sender, std::string_view subject) {
+    record_id(out, id);
+    record_field(out, "sender", sender);
+    record_field(out, "subject", subject);
+    out += args.format == FORMAT_TSV ? "\n" : "}\n";
+}
+
+void record_message_head(std::string &out, long id, std::string_view sender, std::string_view subject) {
+    record_id(out, id);
+    record_field(out, "sender", sender);
+    record_field(out, "subject", subject);
+    out += args.format == FORMAT_TSV ? "\t" : ",\"body\":\"";
+}
+
+void record_message_tail(std::string &out) {
+    out += args.format == FORMAT_TSV ? "\n" : "\"}\n";
+}
+
+void record_message(std::string &out, long id, std::string_view sender, std::string_view subject, std::string_view body) {
+    record_message_head(out, id, sender, subject);
+    record_escape(out, body);
+    record_message_tail(out);
+}
+
+/**
+ * Append the outcome closing a status record.
+ * @param out Output, appended to.
+ * @param ok The command succeeded.
+ * @param text Result or error message.
+ */
+static void record_outcome(std::string &out, bool ok, std::string_view text) {
+    if (args.format == FORMAT_TSV) {
+        out += ok ? "ok\t" : "error\t";
+        record_escape(out, text);
+        out += '\n';
+        return;
+    }
+    out += ok ? "\"ok\":true,\"message\":\"" : "\"ok\":false,\"error\":\"";
+    record_escape(out, text);
+    out += "\"}\n";
+}
+
+void record_status(std::string &out, bool ok, std::string_view text) {
+    if (args.format != FORMAT_TSV) {
+        out += '{';
+    }
+    record_outcome(out, ok, text);
+}
+
+void record_result(std::string &out, long id, bool ok, std::string_view text) {
+    if (args.format == FORMAT_TSV) {
+        out += std::to_string(id);
+        out += '\t';
+    } else {
+        out += "{\"id\":";
+        out += std::to_string(id);
+        out += ',';
+    }
+    record_outcome(out, ok, text);
+}
+
+/**
+ * Append the records of the ok reply of a command.
+ * @param reply Parsed reply.
+ * @param id Message id of a fetch.
+ * @param out Records, appended to.
+ * @return 1 if the reply does not have the fields of the layout, else 0.
+ */
+template <e_layout LAYOUT>
+static int record_reply(const s_reply &reply, long id, std::string &out) {
+    size_t count = reply.fields.size();
+
+    if constexpr (LAYOUT == REPLY_LIST) {
+        for (size_t i = 0; i + 1 < count; i += 2) {
+            record_listed(out, i / 2 + 1, reply.fields[i], reply.fields[i + 1]);
+        }
+    } else if constexpr (LAYOUT == REPLY_MESSAGE) {
+        if (count <= COMMAND_BODY_FIELD) {
+            return 1;
+        }
+        record_message(out, id, reply.fields[0], reply.fields[1], reply.fields[COMMAND_BODY_FIELD]);
+    } else {
+        if (count < 1) {
+            return 1;
+        }
+        record_status(out, true, reply.fields[0]);
+    }
+    return 0;
+}
+
+static constexpr int (*record_replies[])(const s_reply &, long, std::string &) = {
+    &record_reply<REPLY_TEXT>, &record_reply<REPLY_LIST>, &record_reply<REPLY_MESSAGE>,
+};
+
+int record_response(std::string server_response, std::string command, long id, std::string &out) {
+    s_reply reply;
+    std::string token;
+
+    //* a newline sent escaped is a newline of the field, the record escapes it in its own way
+    reply.newlines = true;
+    if (parse_response(server_response, reply) != 0) {
+        fprintf(stderr, "Invalid server response.\n");
+        return 1;
+    }
+    //* an error message, or the records of the reply as laid out in the table entry of the command
+    int index = find_command(command);
+    int rv = 0;
+    if (!reply.ok && !reply.fields.empty()) {
+        record_status(out, false, reply.fields[0]);
+    } else if (!reply.ok) {
+        rv = 1;
+    } else {
+        rv = record_replies[index != -1 ? command_table[index].layout : REPLY_TEXT](reply, id, out);
+    }
+    if (rv != 0) {
+        fprintf(stderr, "Invalid server response.\n");
+        return 1;
+    }
+
+    //* resolve login token
+    if (reply.fields.size() > 1) {
+        token = reply.fields[1];
+    }
+    return resolve_tokens(reply.ok, command, token);
+}
+
+void record_write(std::string &out) {
+    fwrite(out.data(), 1, out.size(), stdout);
+    out.clear();
+}
+
+std::shared_ptr<s_decoder> record_decoder(e_layout layout, long id) {
+    std::shared_ptr<s_decoder> decoder = std::make_shared<s_decoder>();
+    s_decoder *state = decoder.get();
+
+    //* each record (and each part of a body) is escaped into a reused buffer and written at once
+    decoder->newlines = true;
+    if (layout == REPLY_MESSAGE) {
+        decoder->stream_field = COMMAND_BODY_FIELD; // message body
+    }
+    decoder->on_state = [](bool) {};
+    decoder->on_field = [layout, id, state, sender = std::string()](std::string_view field) mutable {
+        size_t index = state->field_count;
+        if (state->state == 0 || layout == REPLY_TEXT) {
+            if (index == 0) {
+                record_status(scratch, state->state == 1, field); // error message, command result
+            }
+        } else if (index % 2 == 0 || (layout == REPLY_MESSAGE && index > COMMAND_BODY_FIELD)) {
+            sender = field; // kept until the subject completes the record
+        } else if (layout == REPLY_LIST) {
+            record_listed(scratch, index / 2 + 1, sender, field);
+        } else {
+            record_message_head(scratch, id, sender, field);
+        }
+        record_write(scratch);
+    };
+    decoder->on_body = [](std::string_view part) {
+        record_escape(scratch, part);
+        record_write(scratch);
+    };
+    return decoder;
+}
+
+void record_end(const s_decoder &decoder, e_layout layout, int status) {
+    //* the record of a message is open from its subject until the end of its body
+    if (layout != REPLY_MESSAGE || decoder.state != 1 || decoder.field_count < COMMAND_BODY_FIELD) {
+        return;
+    }
+    if (status == 0 && decoder.field_count > COMMAND_BODY_FIELD) {
+        record_message_tail(scratch);
+    } else {
+        scratch += '\n';
+    }
+    record_write(scratch);
+}
+
+int record_detect(std::istream &input) {
+    int c;
+    while ((c = input.peek()) != EOF && isspace(c)) {
+        input.get();
+    }
+    return c == '{' ? RECORD_NDJSON : RECORD_CSV;
+}
+
+/**
+ * Read the fields of one CSV record, a quoted field may continue on the next lines.
+ * @param input Input.
+ * @param line First line of the record.
+ * @param fields Fields, appended to.
+ * @return 0 if the record was read, 2 if a quoted field is not closed.
+ */
+static int record_read_csv(std::istream &input, std::string &line, std::vector<std::string> &fields) {
+    std::string field;
+    bool quoted = false;
+    size_t i = 0;
+
+    while (1) {
+        if (i == line.size()) {
+            if (!quoted) {
+                break;
+            }
+            //* the newline belongs to the quoted field
+            if (!std::getline(input, line)) {
+                return 2;
+            }
+            field += '\n';
+            i = 0;
+            continue;
+        }
+        char c = line[i++];
+        if (quoted && c == '"' && i < line.size() && line[i] == '"') {
+            field += '"'; // doubled quote
+            i++;
+        } else if (c == '"' && (quoted || field.empty())) {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            fields.push_back(std::move(field));
+            field.clear();
+        } else if (c != '\r' || quoted || i != line.size()) {
+            field += c;
+        }
+    }
+    fields.push_back(std::move(field));
+    return 0;
+}
+
+/**
+ * Append a code point encoded as UTF-8.
+ * @param out Output, appended to.
+ * @param code Code point.
+ */
+static void record_utf8(std::string &out, uint32_t code) {
+    if (code < 0x80) {
+        out += (char)code;
+    } else if (code < 0x800) {
+        out += (char)(0xc0 | code >> 6);
+        out += (char)(0x80 | (code & 0x3f));
+    } else if (code < 0x10000) {
+        out += (char)(0xe0 | code >> 12);
+        out += (char)(0x80 | ((code >> 6) & 0x3f));
+        out += (char)(0x80 | (code & 0x3f));
+    } else {
+        out += (char)(0xf0 | code >> 18);
+        out += (char)(0x80 | ((code >> 12) & 0x3f));
+        out += (char)(0x80 | ((code >> 6) & 0x3f));
+        out += (char)(0x80 | (code & 0x3f));
+    }
+}
+
+/**
+ * Parse a JSON string.
+ * @param line Line, the string starts after its opening quote at the position.
+ * @param i Position, moved past the closing quote.
+ * @param value Unescaped string.
+ * @return 1 if the string is malformed, else 0.
+ */
+static int record_json_string(std::string_view line, size_t &i, std::string &value) {
+    value.clear();
+    while (i < line.size()) {
+        //* runs without escapes are copied at once
+        size_t end = line.find_first_of("\"\\", i);
+        if (end == std::string_view::npos) {
+            return 1;
+        }
+        value.append(line.data() + i, end - i);
+        i = end + 1;
+        if (line[end] == '"') {
+            return 0;
+        }
+        if (i == line.size()) {
+            return 1;
+        }
+        char c = line[i++];
+        static const char escapes[] = "\"\\/bfnrt";
+        const char *plain = strchr(escapes, c);
+        if (plain != NULL && c != '\0') {
+            value += "\"\\/\b\f\n\r\t"[plain - escapes];
+            continue;
+        }
+        //* \uXXXX, a surrogate pair is joined into one code point
+        uint32_t code = 0;
+        for (int pair = 0; c == 'u'; pair++) {
+            if (i + 4 > line.size()) {
+                return 1;
+            }
+            uint32_t unit = 0;
+            for (int k = 0; k < 4; k++) {
+                char h = line[i++];
+                if (!isxdigit((unsigned char)h)) {
+                    return 1;
+                }
+                unit = unit * 16 + (isdigit((unsigned char)h) ? h - '0' : (tolower(h) - 'a' + 10));
+            }
+            if (pair == 0 && unit >= 0xd800 && unit < 0xdc00 && line.substr(i, 2) == "\\u") {
+                code = unit;
+                i += 2;
+                continue;
+            }
+            code = pair == 1 && unit >= 0xdc00 && unit < 0xe000 ? 0x10000 + ((code - 0xd800) << 10) + (unit - 0xdc00) : unit;
+            break;
+        }
+        if (c != 'u') {
+            return 1;
+        }
+        record_utf8(value, code);
+    }
+    return 1;
+}
+
+/**
+ * Parse a JSON object of strings into the fields.
+ * @param line Line with the object.
+ * @param names Names of the members in the order of the fields, other members are ignored.
+ * @param fields Fields, resized to the names.
+ * @return 0 if the object has all members, else 2.
+ */
+static int record_read_json(std::string_view line, const std::vector<std::string_view> &names, std::vector<std::string> &fields) {
+    std::vector<bool> found(names.size());
+    std::string name, value;
+    size_t i = line.find_first_not_of(" \t\r");
+
+    fields.resize(names.size());
+    if (i == std::string_view::npos || line[i++] != '{') {
+        return 2;
+    }
+    while (1) {
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string_view::npos) {
+            return 2;
+        }
+        if (line[i] == '}' && name.empty()) {
+            break;
+        }
+        //* "name": "value", only string members are supported
+        if (line[i++] != '"' || record_json_string(line, i, name) != 0) {
+            return 2;
+        }
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string_view::npos || line[i++] != ':') {
+            return 2;
+        }
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string_view::npos || line[i++] != '"' || record_json_string(line, i, value) != 0) {
+            return 2;
+        }
+        for (size_t n = 0; n < names.size(); n++) {
+            if (names[n] == name) {
+                fields[n].swap(value);
+                found[n] = true;
+            }
+        }
+        i = line.find_first_not_of(" \t\r", i);
+        if (i == std::string_view::npos) {
+            return 2;
+        }
+        if (line[i] == '}') {
+            break;
+        }
+        if (line[i++] != ',') {
+            return 2;
+        }
+    }
+    return std::find(found.begin(), found.end(), false) == found.end() ? 0 : 2;
+}
+
+int record_read(std::istream &input, int format, const std::vector<std::string_view> &names, std::vector<std::string> &fields) {
+    std::string line;
+
+    fields.clear();
+    //* blank lines separate nothing
+    do {
+        if (!std::getline(input, line)) {
+            return 1;
+        }
+    } while (line.find_first_not_of(" \t\r") == std::string::npos);
+    if (format == RECORD_NDJSON) {
+        return record_read_json(line, names, fields);
+    }
+    return record_read_csv(input, line, fields);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file record.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - machine-readable output records (NDJSON, TSV), header.
+ *
+ **/
+
+#ifndef _RECORD_H_
+#define _RECORD_H_
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <memory>
+#include "request.h"
+
+// format of the input records
+#define RECORD_CSV 0 // comma separated, quoted fields may hold commas, quotes ("") and newlines
+#define RECORD_NDJSON 1 // one JSON object per line, the fields are its string members
+
+/**
+ * Append a field escaped for the output format, without the quotes of JSON.
+ * JSON escapes the quote, the backslash and the control characters, TSV the tab,
+ * the newline, the carriage return and the backslash as \t, \n, \r and \\.
+ * @param out Output, appended to.
+ * @param field Field.
+ */
+void record_escape(std::string &out, std::string_view field);
+
+/**
+ * Append the record of a listed message.
+ * @param out Output, appended to.
+ * @param id Message id (position in the list).
+ * @param sender Sender.
+ * @param subject Subject.
+ */
+void record_listed(std::string &out, long id, std::string_view sender, std::string_view subject);
+
+/**
+ * Append the start of the record of a fetched message, up to its body.
+ * @param out Output, appended to.
+ * @param id Message id, 0 if it is not known.
+ * @param sender Sender.
+ * @param subject Subject.
+ */
+void record_message_head(std::string &out, long id, std::string_view sender, std::string_view subject);
+
+/**
+ * Append the end of the record of a fetched message, after its body.
+ * @param out Output, appended to.
+ */
+void record_message_tail(std::string &out);
+
+/**
+ * Append the record of a fetched message.
+ * @param out Output, appended to.
+ * @param id Message id, 0 if it is not known.
+ * @param sender Sender.
+ * @param subject Subject.
+ * @param body Body.
+ */
+void record_message(std::string &out, long id, std::string_view sender, std::string_view subject, std::string_view body);
+
+/**
+ * Append the record of a command result or an error reply.
+ * @param out Output, appended to.
+ * @param ok The command succeeded.
+ * @param text Result or error message of the server.
+ */
+void record_status(std::string &out, bool ok, std::string_view text);
+
+/**
+ * Append the record of the result of one input record.
+ * @param out Output, appended to.
+ * @param id Number of the input record.
+ * @param ok The command succeeded.
+ * @param text Result or error message.
+ */
+void record_result(std::string &out, long id, bool ok, std::string_view text);
+
+/**
+ * Perform actions according to the server response and build its records, like terminal_response.
+ * @param server_response The response sent by server.
+ * @param command The current command.
+ * @param id Message id of a fetch, 0 if it is not known.
+ * @param out Records, appended to.
+ * @return 1 if the response is invalid or the token cannot be saved, else 0.
+ */
+int record_response(std::string server_response, std::string command, long id, std::string &out);
+
+/**
+ * Write the records to stdout and clear them.
+ * @param out Records.
+ */
+void record_write(std::string &out);
+
+/**
+ * Create a decoder writing the records of a reply while it is received.
+ * @param layout Layout of the ok reply.
+ * @param id Message id of a fetch, 0 if it is not known.
+ * @return Decoder, record_end is called once the reply is complete.
+ */
+std::shared_ptr<s_decoder> record_decoder(e_layout layout, long id);
+
+/**
+ * Finish the records of a decoded reply, the line of an incomplete record is ended.
+ * @param decoder Decoder created by record_decoder.
+ * @param layout Layout of the ok reply.
+ * @param status Completion status of the engine.
+ */
+void record_end(const s_decoder &decoder, e_layout layout, int status);
+
+/**
+ * Tell the format of input records from their first character, a JSON object or a CSV line.
+ * @param input Input, leading whitespace is skipped.
+ * @return RECORD_NDJSON or RECORD_CSV.
+ */
+int record_detect(std::istream &input);
+
+/**
+ * Read the next input record, empty lines are skipped.
+ * @param input Input.
+ * @param format RECORD_CSV or RECORD_NDJSON.
+ * @param names Names of the JSON members in the order of the fields, CSV fields are taken in their order.
+ * @param fields Unescaped fields of the record.
+ * @return 0 if a record was read, 1 at the end of the input, 2 if the record is malformed (it is skipped).
+ */
+int record_read(std::istream &input, int format, const std::vector<std::string_view> &names, std::vector<std::string> &fields);
+
+#endif /* _RECORD_H_ */
@@ -0,0 +1,452 @@
+/**
+ * @file replay.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - replay of captured protocol traffic.
+ *
+ * Extracts the client requests of a pcap capture (e.g. isa.pcap) with the analyzer reassembly
+ * and sends them again to a target server over a pool of connections of the client engine, in the
+ * captured timing, scaled, or as fast as possible. Requests pipelined on one captured connection
+ * stay pipelined on one target connection. The login tokens issued by the target server replace
+ * the captured ones. Each reply is compared with the captured one by its state and fields as the
+ * client reads them, the report shows the differing replies and the latency and throughput of the
+ * capture next to the replayed ones, so a recorded session can be used as a repeatable benchmark.
+ * The target server should start in the state of the captured one (e.g. fresh), else the replies
+ * of register, list and fetch differ.
+ *
+ * usage: replay [ <option> ... ] <file>
+ * <option> is one of
+ * -a <addr>, --address <addr>
+ *    Target server hostname or address to connect to
+ * -p <port>, --port <port>
+ *    Target server port to connect to
+ * -s <factor>, --speed <factor>
+ *    Speed relative to the capture, 1 (original timing) by default, 0 as fast as possible
+ * -c <count>, --connections <count>
+ *    Number of connections to the target server
+ * -P <port>, --capture-port <port>
+ *    Server port in the capture, 32323 by default
+ * -j, --json
+ *    Print the report as JSON
+ * --help, -h
+ *    Show this help
+ */
+
+#include "replay.h"
+
+int main(int argc, char *argv[])
+{
+    struct addrinfo *server_info;
+    s_replay replay;
+
+    parseargs(argc, argv);
+
+    //* the connections of the pool are kept open
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    replay.stats.resize(REPLAY_COMMANDS + 1);
+    if (load_capture(replay_args.file, replay) != 0) {
+        return 1;
+    }
+    if (resolve_server(&server_info) != 0) {
+        return 1;
+    }
+    if (engine_init(replay.engine, server_info) != 0) {
+        free_server(server_info);
+        return 1;
+    }
+    for (int i = 0; i < replay_args.connections; i++) {
+        engine_open(replay.engine);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int rv = run_replay(replay);
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    engine_free(replay.engine);
+    free_server(server_info);
+    if (rv != 0) {
+        return 1;
+    }
+
+    //* the capture is measured from the first request to the last reply
+    uint64_t last = 0;
+    for (const s_replay_request &request : replay.requests) {
+        last = std::max(last, request.replied != UINT64_MAX ? request.replied : request.sent);
+    }
+    double original = (last - replay.requests[0].sent) / 1e6;
+
+    if (replay_args.json) {
+        print_json(replay, original, elapsed);
+    } else {
+        print_text(replay, original, elapsed);
+    }
+
+    const s_replay_stats &total = replay.stats[REPLAY_COMMANDS];
+    return total.failed > 0 || total.different > 0 ? 2 : 0;
+}
+
+void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"address", 1, 0, 'a'},
+                {"port", 1, 0, 'p'},
+                {"speed", 1, 0, 's'},
+                {"connections", 1, 0, 'c'},
+                {"capture-port", 1, 0, 'P'},
+                {"json", 0, 0, 'j'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "a:p:s:c:P:jh", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 'a':
+                args.addr = optarg;
+                break;
+            case 'p':
+                args.port = optarg;
+                break;
+            case 's':
+                replay_args.speed = atof(optarg);
+                break;
+            case 'c':
+                replay_args.connections = atoi(optarg);
+                break;
+            case 'P':
+                replay_args.capture_port = atoi(optarg);
+                break;
+            case 'j':
+                replay_args.json = true;
+                break;
+            case 'h':
+                p_help();
+                break;
+            case '?':
+                exit(1);
+        }
+    }
+
+    //! exactly one capture file
+    if (optind != argc - 1) {
+        fprintf(stderr, "Missing capture file. See --help.\n");
+        exit(1);
+    }
+    replay_args.file = argv[optind];
+    //! invalid values
+    if (replay_args.speed < 0 || replay_args.connections < 1 || replay_args.capture_port == 0) {
+        fprintf(stderr, "Invalid speed, number of connections or capture port. See --help.\n");
+        exit(1);
+    }
+}
+
+void p_help() {
+    printf("usage: replay [ <option> ... ] <file>\n <option> is one of\n-a <addr>, --address <addr>\nTarget server hostname or address to connect to\n");
+    printf("-p <port>, --port <port>\nTarget server port to connect to\n-s <factor>, --speed <factor>\nSpeed relative to the capture, 1 (original timing) by default, 0 as fast as possible\n");
+    printf("-c <count>, --connections <count>\nNumber of connections to the target server\n-P <port>, --capture-port <port>\nServer port in the capture, 32323 by default\n");
+    printf("-j, --json\nPrint the report as JSON\n--help, -h\nShow this help\n");
+    exit(0);
+}
+
+int load_capture(std::string path, s_replay &replay) {
+    s_capture capture;
+    std::vector<std::vector<s_packet>> packets(1);
+    std::unordered_map<uint32_t, std::deque<size_t>> waiting; // requests waiting for the reply by connection
+    s_reassembly reassembly;
+    uint32_t streams = 0;
+
+    capture.port = replay_args.capture_port;
+    if (open_capture(capture, path) != 0) {
+        return 1;
+    }
+    dispatch_packets(capture, packets, streams);
+    madvise((void *)capture.data, capture.size, MADV_NORMAL);
+
+    //* whole messages are kept, the replies are matched to the requests in order
+    reassembly.on_message = [&](uint32_t stream, bool to_server, const s_direction &dir, uint64_t time) {
+        if (to_server) {
+            s_replay_request request;
+            s_request parsed;
+            request.message = dir.message;
+            request.stream = stream;
+            request.sent = time;
+            if (parse_request(request.message, parsed) == 0) {
+                for (int i = 0; i < REPLAY_COMMANDS - 1; i++) {
+                    if (parsed.command == replay_commands[i]) {
+                        request.command = i;
+                    }
+                }
+            }
+            waiting[stream].push_back(replay.requests.size());
+            replay.requests.push_back(std::move(request));
+            return;
+        }
+        auto found = waiting.find(stream);
+        if (found == waiting.end() || found->second.empty()) {
+            return;
+        }
+        s_replay_request &request = replay.requests[found->second.front()];
+        found->second.pop_front();
+        request.replied = time;
+        request.reply = dir.message;
+    };
+    reassembly.on_close = [&](uint32_t stream) {
+        waiting.erase(stream);
+    };
+    reassemble_packets(capture, reassembly, packets[0]);
+    close_capture(capture);
+
+    if (reassembly.gaps > 0) {
+        fprintf(stderr, "%lu segments are missing from the capture, the requests in them are not replayed.\n", reassembly.gaps);
+    }
+    //! nothing to replay
+    if (replay.requests.empty()) {
+        fprintf(stderr, "No requests in the capture %s (server port %u).\n", path.c_str(), replay_args.capture_port);
+        return 1;
+    }
+
+    //* a request is completed by its last segment, which may come after the first segment of the next one
+    std::stable_sort(replay.requests.begin(), replay.requests.end(), [](const s_replay_request &a, const s_replay_request &b) {
+        return a.sent < b.sent;
+    });
+    //* captured latency, the requests never answered wait for nothing
+    for (size_t i = 0; i < replay.requests.size(); i++) {
+        const s_replay_request &request = replay.requests[i];
+        if (request.replied != UINT64_MAX) {
+            histogram_record(replay.stats[request.command].original, request.replied - request.sent);
+            histogram_record(replay.stats[REPLAY_COMMANDS].original, request.replied - request.sent);
+        }
+        replay.by_reply.push_back(i);
+    }
+    std::stable_sort(replay.by_reply.begin(), replay.by_reply.end(), [&](size_t a, size_t b) {
+        return replay.requests[a].replied < replay.requests[b].replied;
+    });
+    return 0;
+}
+
+int run_replay(s_replay &replay) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t first = replay.requests[0].sent;
+    size_t next = 0, frontier = 0, count = replay.requests.size();
+
+    while (1) {
+        auto now = std::chrono::steady_clock::now();
+        int timeout = -1;
+
+        while (next < count) {
+            const s_replay_request &request = replay.requests[next];
+            //* the requests answered in the capture before this one was sent are completed first
+            while (frontier < count && replay.requests[replay.by_reply[frontier]].done) {
+                frontier++;
+            }
+            size_t blocking = frontier < count ? replay.by_reply[frontier] : count;
+            if (blocking < next && replay.requests[blocking].replied < request.sent) {
+                break;
+            }
+            //* the captured timing, scaled
+            if (replay_args.speed > 0) {
+                auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::micro>((request.sent - first) / replay_args.speed));
+                if (due > now) {
+                    timeout = std::chrono::ceil<std::chrono::milliseconds>(due - now).count();
+                    break;
+                }
+            }
+            start_request(replay, next++);
+        }
+
+        if (next == count && replay.engine.pending == 0) {
+            return 0;
+        }
+        if (engine_poll(replay.engine, timeout) != 0) {
+            return 1;
+        }
+    }
+}
+
+void start_request(s_replay &replay, size_t index) {
+    const s_replay_request &request = replay.requests[index];
+    s_engine_request submitted;
+    s_replay *state = &replay;
+    uint32_t stream = request.stream;
+
+    //* requests in flight on a captured connection are pipelined on the same target connection
+    auto &target = replay.streams[stream];
+    if (target.second == 0) {
+        target.first = replay.next_conn;
+        replay.next_conn = (replay.next_conn + 1) % replay_args.connections;
+    }
+    target.second++;
+
+    message_own(submitted.message, substitute_token(replay, request.message));
+    auto submitted_at = std::chrono::steady_clock::now();
+    submitted.on_done = [state, index, stream, submitted_at](int status, std::string reply) {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - submitted_at).count();
+        auto found = state->streams.find(stream);
+        if (--found->second.second == 0) {
+            state->streams.erase(found);
+        }
+        complete_request(*state, index, status, reply, latency);
+    };
+    engine_submit(replay.engine, target.first, std::move(submitted));
+}
+
+std::string substitute_token(const s_replay &replay, const std::string &message) {
+    s_request parsed;
+
+    //* list, send, fetch and logout start with the token
+    if (replay.tokens.empty() || parse_request(message, parsed) != 0 || parsed.args.empty() || !parsed.quoted[0]
+            || (parsed.command != "list" && parsed.command != "send" && parsed.command != "fetch" && parsed.command != "logout")) {
+        return message;
+    }
+    auto found = replay.tokens.find(std::string(parsed.args[0]));
+    if (found == replay.tokens.end()) {
+        return message;
+    }
+    size_t offset = parsed.args[0].data() - message.data();
+    return message.substr(0, offset) + found->second + message.substr(offset + parsed.args[0].size());
+}
+
+void complete_request(s_replay &replay, size_t index, int status, std::string reply, uint64_t latency) {
+    s_replay_request &request = replay.requests[index];
+    bool answered = request.replied != UINT64_MAX;
+    bool same = status == 0 && answered && same_reply(request.command, request.reply, reply);
+
+    request.done = true;
+    //* the later requests use the token of the replayed login
+    if (status == 0 && answered && request.command == 1) {
+        s_reply expected, received;
+        if (parse_response(request.reply, expected) == 0 && parse_response(reply, received) == 0
+                && expected.ok && received.ok && expected.fields.size() > 1 && received.fields.size() > 1) {
+            replay.tokens[char_to_escaped(expected.fields[1])] = char_to_escaped(received.fields[1]);
+        }
+    }
+
+    for (s_replay_stats *stats : {&replay.stats[request.command], &replay.stats[REPLAY_COMMANDS]}) {
+        if (status != 0) {
+            stats->failed++;
+            continue;
+        }
+        histogram_record(stats->replayed, latency);
+        if (!answered) {
+            stats->unanswered++;
+        } else if (same) {
+            stats->same++;
+        } else {
+            stats->different++;
+        }
+    }
+    if (status == 0 && answered && !same && replay.diffs.size() < REPLAY_MAX_DIFFS) {
+        replay.diffs.push_back({index, request.reply, reply});
+    }
+}
+
+bool same_reply(int command, std::string_view expected, std::string_view received) {
+    s_reply a, b;
+
+    bool malformed = parse_response(expected, a) != 0;
+    if (malformed || parse_response(received, b) != 0) {
+        return malformed && expected == received;
+    }
+    if (a.ok != b.ok || a.fields.size() != b.fields.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.fields.size(); i++) {
+        //* login tokens are issued anew
+        if (a.fields[i] != b.fields[i] && !(command == 1 && a.ok && i == 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Shorten a reply to one line for the report.
+ */
+static std::string shown(std::string_view reply) {
+    std::string line(reply.substr(0, REPLAY_SHOWN));
+    for (char &c : line) {
+        if ((unsigned char)c < 0x20) {
+            c = ' ';
+        }
+    }
+    return reply.size() > REPLAY_SHOWN ? line + "..." : line;
+}
+
+void print_text(const s_replay &replay, double original, double elapsed) {
+    char speed[32] = "maximum";
+    if (replay_args.speed > 0) {
+        snprintf(speed, sizeof speed, "%gx", replay_args.speed);
+    }
+    printf("%zu requests of %s replayed to %s in %.2f s (captured in %.2f s), speed %s\n", replay.requests.size(), replay_args.file.c_str(),
+        (args.addr + ":" + args.port).c_str(), elapsed, original, speed);
+    printf("%-9s %7s %7s %7s %7s %11s %11s %12s %12s %12s %12s %8s\n", "command", "count", "same", "diff", "failed", "orig req/s",
+        "req/s", "orig mean ms", "mean ms", "orig p99 ms", "p99 ms", "change");
+    for (size_t i = 0; i < replay.stats.size(); i++) {
+        const s_replay_stats &s = replay.stats[i];
+        const s_histogram &o = s.original, &r = s.replayed;
+        uint64_t count = s.same + s.different + s.failed + s.unanswered;
+        if (count == 0) {
+            continue;
+        }
+        double before = o.total ? o.sum / o.total : 0, after = r.total ? r.sum / r.total : 0;
+        printf("%-9s %7lu %7lu %7lu %7lu %11.1f %11.1f %12.3f %12.3f %12.3f %12.3f %7.1f%%\n",
+            i < REPLAY_COMMANDS ? replay_commands[i] : "total", count, s.same, s.different, s.failed,
+            original > 0 ? count / original : 0, count / elapsed, before / 1000, after / 1000, histogram_percentile(o, 99) / 1000.0,
+            histogram_percentile(r, 99) / 1000.0, before > 0 && r.total ? (after - before) / before * 100 : 0);
+    }
+
+    if (!replay.diffs.empty()) {
+        printf("\ndiffering replies\n");
+    }
+    for (const s_replay_diff &diff : replay.diffs) {
+        printf("#%zu %s\n  captured: %s\n  replayed: %s\n", diff.index + 1, replay_commands[replay.requests[diff.index].command],
+            shown(diff.expected).c_str(), shown(diff.received).c_str());
+    }
+}
+
+void print_json(const s_replay &replay, double original, double elapsed) {
+    printf("{\"file\":\"%s\",\"address\":\"%s\",\"port\":\"%s\",\"speed\":%g,\"connections\":%d,\"requests\":%zu,\"captured_s\":%.6f,\"elapsed_s\":%.6f,\"commands\":{",
+        char_to_escaped(replay_args.file).c_str(), char_to_escaped(args.addr).c_str(), char_to_escaped(args.port).c_str(),
+        replay_args.speed, replay_args.connections, replay.requests.size(), original, elapsed);
+    bool first = true;
+    for (size_t i = 0; i < replay.stats.size(); i++) {
+        const s_replay_stats &s = replay.stats[i];
+        uint64_t count = s.same + s.different + s.failed + s.unanswered;
+        if (i == REPLAY_COMMANDS) {
+            printf("},\"total\":");
+        } else if (count == 0) {
+            continue;
+        } else {
+            printf("%s\"%s\":", first ? "" : ",", replay_commands[i]);
+            first = false;
+        }
+        printf("{\"count\":%lu,\"same\":%lu,\"different\":%lu,\"failed\":%lu,\"unanswered\":%lu", count, s.same, s.different, s.failed, s.unanswered);
+        for (auto run : {std::make_pair("captured", &s.original), std::make_pair("replayed", &s.replayed)}) {
+            const s_histogram &h = *run.second;
+            double seconds = run.second == &s.original ? original : elapsed;
+            printf(",\"%s\":{\"throughput\":%.3f,\"latency_us\":{\"min\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}}",
+                run.first, seconds > 0 ? count / seconds : 0, h.total ? h.min : 0, h.total ? h.sum / h.total : 0, histogram_percentile(h, 50),
+                histogram_percentile(h, 90), histogram_percentile(h, 99), h.max);
+        }
+        printf("}");
+    }
+    printf(",\"differences\":[");
+    for (size_t i = 0; i < replay.diffs.size(); i++) {
+        const s_replay_diff &diff = replay.diffs[i];
+        printf("%s{\"request\":%zu,\"command\":\"%s\",\"captured\":\"%s\",\"replayed\":\"%s\"}", i > 0 ? "," : "", diff.index + 1,
+            replay_commands[replay.requests[diff.index].command], char_to_escaped(shown(diff.expected)).c_str(), char_to_escaped(shown(diff.received)).c_str());
+    }
+    printf("]}\n");
+}
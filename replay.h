@@ -0,0 +1,144 @@
+/**
+ * @file replay.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - replay of captured protocol traffic, header.
+ *
+ **/
+
+#include <cstdint>
+#include <chrono>
+#include <unordered_map>
+#include <sys/resource.h>
+#include "capture.h"
+#include "engine.h"
+#include "histogram.h"
+
+#define REPLAY_COMMANDS 7 // register, login, list, send, fetch, logout, other
+#define REPLAY_MAX_DIFFS 10 // differing replies printed
+#define REPLAY_SHOWN 80 // characters of a differing reply printed
+
+const char *const replay_commands[REPLAY_COMMANDS] = {"register", "login", "list", "send", "fetch", "logout", "other"};
+
+struct s_replay_args {
+    double speed = 1; // 1 original timing, 2 twice as fast, 0 as fast as possible
+    int connections = 16; // connections to the target server
+    uint16_t capture_port = 32323; // server port in the capture, the traffic is told apart by it
+    bool json = false; // print the report as JSON
+    std::string file = ""; // pcap file
+} replay_args;
+
+struct s_replay_request {
+    std::string message = ""; // request as captured
+    int command = REPLAY_COMMANDS - 1; // index in replay_commands
+    uint32_t stream = 0; // captured TCP connection
+    uint64_t sent = 0; // capture time the request was completed, microseconds
+    uint64_t replied = UINT64_MAX; // capture time the reply was completed, UINT64_MAX if not answered
+    std::string reply = ""; // captured reply
+    bool done = false; // the replayed request was completed
+};
+
+struct s_replay_stats {
+    s_histogram original; // captured latency, microseconds
+    s_histogram replayed; // replayed latency, microseconds
+    uint64_t same = 0; // replies structurally equal to the captured ones
+    uint64_t different = 0; // replies that differ from the captured ones
+    uint64_t failed = 0; // no or malformed reply
+    uint64_t unanswered = 0; // not answered in the capture, nothing to compare
+};
+
+struct s_replay_diff {
+    size_t index; // index of the request
+    std::string expected; // captured reply
+    std::string received; // replayed reply
+};
+
+struct s_replay {
+    std::vector<s_replay_request> requests; // in capture order
+    std::vector<size_t> by_reply; // indexes of the requests ordered by their captured reply
+    std::unordered_map<std::string, std::string> tokens; // captured login token -> replayed login token
+    std::unordered_map<uint32_t, std::pair<int, size_t>> streams; // captured connection -> target connection, requests in flight
+    std::vector<s_replay_stats> stats; // one per command, the last one is the total
+    std::vector<s_replay_diff> diffs; // first differing replies
+    s_engine engine;
+    int next_conn = 0; // target connection of the next captured connection
+};
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+void parseargs(int argc, char** argv);
+
+/**
+ * Print help.
+ */
+void p_help();
+
+/**
+ * Extract the requests and the replies from the capture.
+ * @param path Path to the pcap file.
+ * @param replay Replay state, the requests are appended.
+ * @return 1 if an error occurs, else 0.
+ */
+int load_capture(std::string path, s_replay &replay);
+
+/**
+ * Send the requests to the target server in the captured order and timing.
+ * A request is sent only once every request answered in the capture before it was sent is completed,
+ * so a request never overtakes the login (or send) it depends on, whatever the speed.
+ * @param replay Replay state.
+ * @return 1 if an error occurs, else 0.
+ */
+int run_replay(s_replay &replay);
+
+/**
+ * Submit a request on the target connection of its captured connection.
+ * @param replay Replay state.
+ * @param index Index of the request.
+ */
+void start_request(s_replay &replay, size_t index);
+
+/**
+ * Replace the captured login token of the request with the token of the replayed login.
+ * @param replay Replay state.
+ * @param message Captured request.
+ * @return Request to send.
+ */
+std::string substitute_token(const s_replay &replay, const std::string &message);
+
+/**
+ * Record a completed request and compare its reply with the captured one.
+ * @param replay Replay state.
+ * @param index Index of the request.
+ * @param status Completion status of the engine.
+ * @param reply Received reply.
+ * @param latency Microseconds from submitting the request.
+ */
+void complete_request(s_replay &replay, size_t index, int status, std::string reply, uint64_t latency);
+
+/**
+ * Compare two replies by their state and fields, as the client reads them.
+ * @param command Index of the command in replay_commands, the login token is not compared.
+ * @param expected Captured reply.
+ * @param received Replayed reply.
+ * @return True if the replies are the same.
+ */
+bool same_reply(int command, std::string_view expected, std::string_view received);
+
+/**
+ * Print the report as a text table.
+ * @param replay Replay state.
+ * @param original Seconds from the first request to the last reply of the capture.
+ * @param elapsed Seconds of the replay.
+ */
+void print_text(const s_replay &replay, double original, double elapsed);
+
+/**
+ * Print the report as JSON.
+ * @param replay Replay state.
+ * @param original Seconds from the first request to the last reply of the capture.
+ * @param elapsed Seconds of the replay.
+ */
+void print_json(const s_replay &replay, double original, double elapsed);
@@ -0,0 +1,516 @@
+/**
+ * @file request.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - building requests and handling the replies.
+ * 
+ **/
+
+#include "request.h"
+
+s_args args;
+s_session session;
+
+/**
+ * Parts of the following code (network connection setup) were taken over from the "Beej's Guide to Network Programming" and edited accordingly.
+ * The C source code presented in this document is granted to the public domain, and is completely free of any license restriction.
+ * https://beej.us/guide/bgnet/html/
+**/
+int resolve_server(struct addrinfo **server_info) {
+    return resolve_address(args.addr, args.port, server_info);
+}
+
+int resolve_address(std::string addr, std::string port, struct addrinfo **server_info) {
+    struct addrinfo hints, *resolved;
+    int rv;
+
+    //* connection setup
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC; // IPv4 or IPv6
+    hints.ai_socktype = SOCK_STREAM; // TCP
+    uint64_t start = trace_fd != -1 ? trace_now() : 0;
+    if ((rv = getaddrinfo(addr.c_str(), port.c_str(), &hints, &resolved)) != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
+        return 1;
+    }
+    if (start != 0) {
+        trace_resolved(start);
+    }
+
+    //* the addresses are copied in the order of the connection attempts (RFC 8305, section 4):
+    //* the families alternate, starting with the family of the first address
+    std::vector<struct addrinfo *> families[2];
+    for (struct addrinfo *p = resolved; p != NULL; p = p->ai_next) {
+        families[p->ai_family != resolved->ai_family].push_back(p);
+    }
+    std::vector<struct addrinfo *> ordered;
+    for (size_t i = 0; i < std::max(families[0].size(), families[1].size()); i++) {
+        for (auto &family : families) {
+            if (i < family.size()) {
+                ordered.push_back(family[i]);
+            }
+        }
+    }
+    *server_info = NULL;
+    for (auto p = ordered.rbegin(); p != ordered.rend(); p++) {
+        *server_info = server_address((*p)->ai_addr, (*p)->ai_addrlen, *server_info);
+    }
+    freeaddrinfo(resolved);
+    return 0;
+}
+
+// end of code including parts taken over from the "Beej's Guide to Network Programming"
+
+struct addrinfo *server_address(const struct sockaddr *addr, socklen_t addrlen, struct addrinfo *next) {
+    //* the node and its address are allocated at once, free_server releases them
+    struct addrinfo *node = (struct addrinfo *)calloc(1, sizeof(struct addrinfo) + addrlen);
+    node->ai_family = addr->sa_family;
+    node->ai_socktype = SOCK_STREAM;
+    node->ai_protocol = addr->sa_family == AF_UNIX ? 0 : IPPROTO_TCP;
+    node->ai_addrlen = addrlen;
+    node->ai_addr = (struct sockaddr *)(node + 1);
+    memcpy(node->ai_addr, addr, addrlen);
+    node->ai_next = next;
+    return node;
+}
+
+void free_server(struct addrinfo *server_info) {
+    while (server_info != NULL) {
+        struct addrinfo *next = server_info->ai_next;
+        free(server_info);
+        server_info = next;
+    }
+}
+
+bool connection_closed(int sockfd) {
+    struct pollfd pfd = {sockfd, POLLIN, 0};
+    char c;
+    if (poll(&pfd, 1, 0) <= 0) {
+        return false;
+    }
+    //* readable without data means the server closed the connection
+    return (pfd.revents & (POLLHUP | POLLERR)) || recv(sockfd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0;
+}
+
+std::string get_message(int argc, char** argv, std::string command) {
+    s_message message;
+
+    if (build_request(argc, argv, command, message) != 0) {
+        return "";
+    }
+    return message_string(message);
+}
+
+int build_request(int argc, char** argv, std::string command, s_message &message) {
+    s_request_args request;
+
+    int index = find_command(command);
+    if (index == -1) {
+        fprintf(stderr, "Invalid command. See --help.\n");
+        return 1;
+    }
+    const s_command &entry = command_table[index];
+
+    //* the body is streamed from a file when given by --body-file (one argument less) or as "-" (stdin)
+    bool has_body = entry.count > 0 && entry.args[entry.count - 1] == ARG_BODY;
+    bool streamed = has_body && args.body_file != "" && !session.active;
+    if (argc != optind + 1 + (int)entry.user_args() - (streamed ? 1 : 0)) { //* arguments + 1 (index -> count)
+        return 1;
+    }
+    //* the arguments are sent from argv if they need no escaping
+    for (int i = optind + 1; i < argc; i++) {
+        request.values.push_back(argv[i]);
+    }
+    optind = argc - 1;
+    if (has_body && !streamed && !session.active && request.values.back() == "-") {
+        streamed = true;
+        args.body_file = "-";
+        request.values.pop_back();
+    }
+    if (streamed) {
+        request.body_file = args.body_file;
+    }
+    if (entry.effect == EFFECT_LOGIN) {
+        session.user = char_to_escaped(request.values[0]);
+    }
+    if (entry.uses_token()) {
+        request.token = get_token();
+    }
+    return encode_request(index, request, message);
+}
+
+/**
+ * Append one argument of a request.
+ * @param request Arguments of the request.
+ * @param value Index of the next argument given by the user, advanced.
+ * @param message Request, appended to.
+ * @return 1 if the body file cannot be opened, else 0.
+ */
+template <e_arg ARG>
+static int encode_arg(const s_request_args &request, size_t &value, s_message &message) {
+    if constexpr (ARG == ARG_TOKEN) {
+        message_own(message, " " + request.token);
+    } else if constexpr (ARG == ARG_BASE64) {
+        message_own(message, " \"" + encoding::Base64::Encode(request.values[value++]) + "\"");
+    } else if constexpr (ARG == ARG_INTEGER) {
+        message_borrow(message, " ");
+        message_borrow(message, request.values[value++]);
+    } else if constexpr (ARG == ARG_BODY) {
+        if (request.body_file != "") {
+            return message_body_file(message, request.body_file);
+        }
+        message_field(message, request.values[value++]);
+    } else {
+        message_field(message, request.values[value++]);
+    }
+    return 0;
+}
+
+/**
+ * Encode the request of a command, the arguments are appended in the order of the table entry.
+ * @param request Arguments of the request.
+ * @param message Request, appended to.
+ * @return 1 if the body file cannot be opened, else 0.
+ */
+template <size_t C, size_t... A>
+static int encode_command(const s_request_args &request, s_message &message, std::index_sequence<A...>) {
+    size_t value = 0;
+    int rv = 0;
+
+    message_own(message, "(" + std::string(command_table[C].name));
+    ((rv = rv != 0 ? rv : encode_arg<command_table[C].args[A]>(request, value, message)), ...);
+    message_borrow(message, ")");
+    return rv;
+}
+
+template <size_t C>
+static int encode_entry(const s_request_args &request, s_message &message) {
+    return encode_command<C>(request, message, std::make_index_sequence<command_table[C].count>());
+}
+
+template <size_t... C>
+static constexpr std::array<int (*)(const s_request_args &, s_message &), COMMAND_COUNT> make_encoders(std::index_sequence<C...>) {
+    return {&encode_entry<C>...};
+}
+
+static constexpr auto request_encoders = make_encoders(std::make_index_sequence<COMMAND_COUNT>());
+
+int encode_request(int command, const s_request_args &request, s_message &message) {
+    return request_encoders[command](request, message);
+}
+
+void message_borrow(s_message &message, std::string_view part) {
+    if (!part.empty()) {
+        message.parts.push_back({part, -1});
+        message.size += part.size();
+    }
+}
+
+void message_own(s_message &message, std::string part) {
+    if (!part.empty()) {
+        message.size += part.size();
+        message.parts.push_back({std::string_view(), (int)message.owned.size()});
+        message.owned.push_back(std::move(part));
+    }
+}
+
+void message_prepend(s_message &message, std::string part) {
+    if (!part.empty()) {
+        message.size += part.size();
+        message.parts.insert(message.parts.begin(), {std::string_view(), (int)message.owned.size()});
+        message.owned.push_back(std::move(part));
+    }
+}
+
+void message_field(s_message &message, std::string_view field) {
+    message_borrow(message, " \"");
+    if (encoding::Escape::EscapedLength(field) == field.size()) {
+        message_borrow(message, field);
+    } else {
+        message_own(message, char_to_escaped(field));
+    }
+    message_borrow(message, "\"");
+}
+
+int message_body_file(s_message &message, std::string path) {
+    struct stat st;
+    //* the file is closed with the last copy of the message
+    std::shared_ptr<s_body> body(new s_body, [](s_body *done) {
+        body_close(*done);
+        delete done;
+    });
+
+    body->fd = path == "-" ? dup(STDIN_FILENO) : open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (body->fd == -1) {
+        fprintf(stderr, "Error while opening the body file %s: %s\n", path.c_str(), strerror(errno));
+        return 1;
+    }
+    //* regular files are mapped and read in place, pipes and terminals are read in chunks
+    if (fstat(body->fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, body->fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            body->map = (const char *)map;
+            body->map_size = st.st_size;
+        }
+    }
+
+    message_borrow(message, " \"");
+    message.parts.push_back({std::string_view(), -1, true});
+    message_borrow(message, "\"");
+    message.body = body;
+    return 0;
+}
+
+int body_next(s_body &body) {
+    std::string_view raw;
+    ssize_t numbytes;
+
+    body.chunk = std::string_view();
+    if (body.eof) {
+        return 0;
+    }
+    if (body.map != NULL) {
+        //* pages already sent are dropped, the mapped file does not stay in memory
+        size_t sent = body.position & ~(size_t)(sysconf(_SC_PAGESIZE) - 1);
+        if (sent > 0) {
+            madvise((void *)body.map, sent, MADV_DONTNEED);
+        }
+        raw = std::string_view(body.map + body.position, std::min((size_t)BODY_CHUNK, body.map_size - body.position));
+    } else {
+        body.raw.resize(BODY_CHUNK);
+        while ((numbytes = read(body.fd, &body.raw[0], BODY_CHUNK)) == -1 && errno == EINTR) {
+        }
+        if (numbytes == -1) {
+            perror("Error while reading the body");
+            return 1;
+        }
+        raw = std::string_view(body.raw.data(), numbytes);
+    }
+    body.position += raw.size();
+    if (raw.empty()) {
+        body.eof = true;
+        return 0;
+    }
+
+    //* the same escaping as char_to_escaped, it does not depend on the chunk boundaries
+    if (encoding::Escape::EscapedLength(raw) == raw.size()) {
+        body.chunk = raw;
+    } else {
+        body.escaped.resize(encoding::Escape::EscapedLength(raw));
+        encoding::Escape::Encode(raw, &body.escaped[0]);
+        body.chunk = body.escaped;
+    }
+    return 0;
+}
+
+void body_close(s_body &body) {
+    if (body.map != NULL) {
+        munmap((void *)body.map, body.map_size);
+        body.map = NULL;
+    }
+    if (body.fd != -1) {
+        close(body.fd);
+        body.fd = -1;
+    }
+}
+
+std::string_view message_part(const s_message &message, size_t index) {
+    const s_message_part &part = message.parts[index];
+    if (part.streamed) {
+        return message.body->chunk;
+    }
+    return part.owned == -1 ? part.data : std::string_view(message.owned[part.owned]);
+}
+
+std::string message_string(const s_message &message) {
+    std::string msg;
+    msg.reserve(message.size);
+    for (size_t i = 0; i < message.parts.size(); i++) {
+        msg.append(message_part(message, i));
+    }
+    return msg;
+}
+
+/**
+ * Append the ok reply of a command to the printed response.
+ * @param reply Parsed reply.
+ * @param message Printed response, appended to.
+ * @return 1 if the reply does not have the fields of the layout, else 0.
+ */
+template <e_layout LAYOUT>
+static int format_reply(const s_reply &reply, std::string &message) {
+    size_t count = reply.fields.size();
+
+    if constexpr (LAYOUT == REPLY_LIST) {
+        message += "\n";
+        //* print all messages
+        int msg_index = 1;
+        for (size_t i = 0; i + 1 < count; i += 2) {
+            message += std::to_string(msg_index) + ":\n"; // message index
+            message += "  From: ";
+            message += reply.fields[i]; // sender
+            message += "\n  Subject: ";
+            message += reply.fields[i+1]; // subject
+            message += "\n";
+            msg_index++;
+        }
+    } else if constexpr (LAYOUT == REPLY_MESSAGE) {
+        if (count <= COMMAND_BODY_FIELD) {
+            return 1;
+        }
+        message += "\n\nFrom: ";
+        message += reply.fields[0]; // sender
+        message += "\nSubject: ";
+        message += reply.fields[1]; // subject
+        message += "\n\n";
+        message += reply.fields[COMMAND_BODY_FIELD]; // message
+    } else {
+        //* command result
+        if (count < 1) {
+            return 1;
+        }
+        message += reply.fields[0];
+    }
+    return 0;
+}
+
+template <size_t... C>
+static constexpr std::array<int (*)(const s_reply &, std::string &), COMMAND_COUNT> make_formatters(std::index_sequence<C...>) {
+    return {&format_reply<command_table[C].layout>...};
+}
+
+static constexpr auto reply_formatters = make_formatters(std::make_index_sequence<COMMAND_COUNT>());
+
+std::string terminal_response(std::string server_response, std::string command) {
+    std::string message, token;
+    s_reply reply;
+
+    //* get response state and all parts of the response
+    if (parse_response(server_response, reply) != 0) {
+        fprintf(stderr, "Invalid server response.\n");
+        return "";
+    }
+    message += reply.ok ? "SUCCESS: " : "ERROR: ";
+
+    //* an error message, or the reply of the command as laid out in its table entry
+    int index = find_command(command);
+    int rv = reply.ok && index != -1 ? reply_formatters[index](reply, message) : format_reply<REPLY_TEXT>(reply, message);
+    if (rv != 0) {
+        fprintf(stderr, "Invalid server response.\n");
+        return "";
+    }
+
+    //* resolve login token
+    if (reply.fields.size() > 1) {
+        token = reply.fields[1];
+    }
+    if (resolve_tokens(reply.ok, command, token) != 0) {
+        return "";
+    }
+    
+    return message;
+}
+
+int resolve_tokens(bool state, std::string command, std::string token) {
+    int index = find_command(command);
+
+    //* the agent keeps the tokens, the login-token file shared by the processes is not used
+    if (args.agent != "") {
+        return 0;
+    }
+    if (state && index != -1) {
+        if (command_table[index].effect == EFFECT_LOGIN) {
+            if (set_token(token) != 0) {
+                return 1;
+            }
+        } else if (command_table[index].effect == EFFECT_LOGOUT) {
+            //* remove file with current user's token
+            std::remove("login-token");
+            session.token = "";
+        }
+    }
+    return 0;
+}
+
+int set_token(std::string token) {
+    std::ofstream file("login-token"); //* write mode
+    if (file.fail()) {
+        fprintf(stderr, "Error while saving the login token.\n");
+        return 1;
+    }
+    //* the user name follows the token, older clients read the token only
+    file << "\"" << token << "\"\n\"" << session.user << "\"";
+    file.close();
+    if (session.active) {
+        session.token = "\"" + token + "\"";
+    }
+    return 0;
+}
+
+std::string get_token() {
+    std::string token;
+    //* the agent sends the token of the account instead
+    if (args.agent != "") {
+        return "\"\"";
+    }
+    //* session keeps the token in memory, the file is read only once
+    if (session.active && session.token != "") {
+        return session.token;
+    }
+    std::ifstream file("login-token"); //* read mode
+    if (file.fail()) {
+        //* machine-readable output has records only
+        fprintf(args.format == FORMAT_TEXT ? stdout : stderr, "Not logged in.\n");
+        return "\"\"";
+    }
+    file >> token;
+    file.close();
+    if (token == "") { token = "\"\""; };
+    if (session.active) {
+        session.token = token;
+    }
+    return token;
+}
+
+std::string get_user() {
+    std::string token, user;
+    //* the user is given by the arguments, the login-token file is not kept up to date with the agent
+    if (args.agent != "") {
+        return args.user != "" ? char_to_escaped(args.user) : "";
+    }
+    std::ifstream file("login-token"); //* read mode
+    if (file.fail()) {
+        return "";
+    }
+    std::getline(file, token);
+    std::getline(file, user);
+    file.close();
+    if (user.size() < 3 || user.front() != '"' || user.back() != '"') {
+        return "";
+    }
+    return user.substr(1, user.size() - 2);
+}
+
+std::string agent_socket_path() {
+    const char *value = getenv(AGENT_ENV);
+    if (value != NULL && value[0] != '\0') {
+        return strcmp(value, "0") == 0 ? "" : value;
+    }
+    const char *runtime = getenv("XDG_RUNTIME_DIR");
+    if (runtime != NULL && runtime[0] != '\0') {
+        return std::string(runtime) + "/isa-agent.sock";
+    }
+    return "/tmp/isa-agent-" + std::to_string(getuid()) + ".sock";
+}
+
+socklen_t agent_address(std::string path, struct sockaddr_un &addr) {
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    //! the path must fit with its terminating zero
+    if (path.empty() || path.size() >= sizeof addr.sun_path) {
+        return 0;
+    }
+    memcpy(addr.sun_path, path.data(), path.size());
+    return offsetof(struct sockaddr_un, sun_path) + path.size() + 1;
+}
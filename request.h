@@ -0,0 +1,302 @@
+/**
+ * @file request.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - building requests and handling the replies, header.
+ *
+ **/
+
+#ifndef _REQUEST_H_
+#define _REQUEST_H_
+
+#include <getopt.h>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <fstream> // files
+#include <unistd.h>
+#include <poll.h>
+#include "base64.h"
+#include "protocol.h"
+#include "command.h"
+#include "trace.h"
+
+// https://support.sas.com/documentation/onlinedoc/sasc/doc/lr2/lrv2ch15.htm
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in_systm.h>
+#include <netinet/ip_icmp.h>
+#include <netinet/udp.h>
+#include <netinet/ip.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <resolv.h>
+#include <net/if.h>
+
+#define MAXDATASIZE 32818 // max number of bytes we can get at once
+#define BODY_CHUNK 65536 // bytes of a streamed body read and escaped at once
+
+// output format of the replies
+#define FORMAT_TEXT 0 // printed responses
+#define FORMAT_NDJSON 1 // one JSON object per line
+#define FORMAT_TSV 2 // one tab separated line
+
+#define AGENT_ENV "ISA_AGENT" // environment variable with the socket of the agent, "0" disables it
+
+struct s_args {
+    std::string addr = "127.0.0.1";
+    std::string port = "32323";
+    int connections = 8; // connections used to fetch several messages
+    bool unordered = false; // print fetched messages as they complete
+    int cache = 1; // fetched messages cache: 0 bypassed, 1 used, 2 verified against the server
+    std::string cache_dir = ""; // base directory of the cache, default user cache directory if empty
+    std::string body_file = ""; // file the body of send is streamed from, "-" for stdin
+    std::string send_batch = ""; // file of the records sent by send --batch, "-" for stdin
+    int connect_timeout = 10000; // milliseconds to connect over all server addresses, 0 without timeout
+    int read_timeout = 30000; // milliseconds without reply data while a reply is awaited, 0 without timeout
+    int write_timeout = 30000; // milliseconds the server may stop reading a request for, 0 without timeout
+    int dns_ttl = 300; // seconds the resolved server addresses are cached for, 0 not cached
+    int deadline = 0; // milliseconds a command (a line of a session) may take in total, 0 without deadline
+    int retries = 2; // times a read-only request is sent again after a connection failure
+    int retry_backoff = 100; // milliseconds of the first backoff before a retry, doubled for each next one
+    int hedge = 0; // milliseconds a read-only request is duplicated on another connection after, 0 not hedged
+    double hedge_percentile = 95; // percentile of the measured replies used as the hedge delay once known
+    int format = FORMAT_TEXT; // output format of the replies
+    std::string agent = ""; // socket of the agent the requests are forwarded through, "" in direct mode
+    std::string user = ""; // account of the agent used by the commands, the last one logged in if empty
+};
+extern s_args args;
+
+struct s_request_args {
+    std::vector<std::string_view> values; // arguments given by the user in order, they must outlive the message
+    std::string token = ""; // login token as sent, used if the command carries it
+    std::string body_file = ""; // the body is streamed from the file instead of taken from the values, "" if not
+};
+
+struct s_message_part {
+    std::string_view data; // fragment not owned by the message (program arguments, literals)
+    int owned = -1; // index of the owned fragment instead, the message may be copied
+    bool streamed = false; // the fragment is the current chunk of the streamed body instead
+};
+
+struct s_body {
+    int fd = -1; // body file, read in chunks unless it is mapped
+    const char *map = NULL; // mapped regular file
+    size_t map_size = 0;
+    size_t position = 0; // bytes of the file escaped so far
+    bool eof = false; // the whole file was read
+    std::string raw = ""; // chunk read from the file
+    std::string escaped = ""; // chunk escaped, if it had anything to escape
+    std::string_view chunk; // current escaped chunk, pointing into the map or the buffers
+};
+
+struct s_message {
+    std::vector<std::string> owned; // fragments built for the request (escaped fields, token)
+    std::vector<s_message_part> parts; // the request in order
+    size_t size = 0; // total length of the parts, without the streamed body
+    std::shared_ptr<s_body> body; // body streamed from a file, the request is sent only once
+};
+
+struct s_session {
+    bool active = false; // commands are run by the session mode
+    std::string token = ""; // login token kept in memory between commands
+    std::string user = ""; // escaped user name of the last login request, saved with the token
+};
+extern s_session session;
+
+/**
+ * Resolve the server address given by the program arguments.
+ * @param server_info Resolved server addresses in the order they are tried, freed by the caller with free_server.
+ * @return 1 if an error occurs, else 0.
+ */
+int resolve_server(struct addrinfo **server_info);
+
+/**
+ * Resolve a server address.
+ * @param addr Server hostname or address.
+ * @param port Server port.
+ * @param server_info Resolved server addresses in the order they are tried, freed by the caller with free_server.
+ * @return 1 if an error occurs, else 0.
+ */
+int resolve_address(std::string addr, std::string port, struct addrinfo **server_info);
+
+/**
+ * Prepend a server address to a list of addresses.
+ * @param addr Socket address.
+ * @param addrlen Length of the socket address.
+ * @param next Rest of the list.
+ * @return New first node of the list.
+ */
+struct addrinfo *server_address(const struct sockaddr *addr, socklen_t addrlen, struct addrinfo *next);
+
+/**
+ * Free the server addresses.
+ * @param server_info Server addresses.
+ */
+void free_server(struct addrinfo *server_info);
+
+/**
+ * Check whether the server closed the connection.
+ * @param sockfd Network socket.
+ * @return True if the connection is closed.
+ */
+bool connection_closed(int sockfd);
+
+/**
+ * Build the request that is sent to the server according to the program arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @param command The current command.
+ * @return Server input message.
+ */
+std::string get_message(int argc, char** argv, std::string command);
+
+/**
+ * Build the request as a list of fragments that are sent without joining them.
+ * Arguments that need no escaping are not copied, they must outlive the message.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ * @param command The current command.
+ * @param message Built request, appended to.
+ * @return 1 if the arguments are invalid, else 0.
+ */
+int build_request(int argc, char** argv, std::string command, s_message &message);
+
+/**
+ * Encode a request as declared by its entry of the command table.
+ * @param command Index of the command in command_table.
+ * @param request Arguments of the request.
+ * @param message Built request, appended to.
+ * @return 1 if the body file cannot be opened, else 0.
+ */
+int encode_request(int command, const s_request_args &request, s_message &message);
+
+/**
+ * Append a fragment that is not copied, it must outlive the message.
+ * @param message Request.
+ * @param part Fragment.
+ */
+void message_borrow(s_message &message, std::string_view part);
+
+/**
+ * Append a fragment owned by the message.
+ * @param message Request.
+ * @param part Fragment.
+ */
+void message_own(s_message &message, std::string part);
+
+/**
+ * Insert a fragment owned by the message before the other fragments.
+ * @param message Request, not sent yet.
+ * @param part Fragment.
+ */
+void message_prepend(s_message &message, std::string part);
+
+/**
+ * Append a quoted field, escaped into an owned fragment only if needed.
+ * @param message Request.
+ * @param field Unescaped field, it must outlive the message.
+ */
+void message_field(s_message &message, std::string_view field);
+
+/**
+ * Append a quoted field streamed from a file, it is escaped in chunks while being sent.
+ * @param message Request.
+ * @param path File path, "-" for stdin.
+ * @return 1 if the file cannot be opened, else 0.
+ */
+int message_body_file(s_message &message, std::string path);
+
+/**
+ * Read and escape the next chunk of a streamed body.
+ * @param body Streamed body.
+ * @return 1 if an error occurs, else 0 (the chunk is empty at the end of the file).
+ */
+int body_next(s_body &body);
+
+/**
+ * Unmap and close the body file.
+ * @param body Streamed body.
+ */
+void body_close(s_body &body);
+
+/**
+ * Get a fragment of the request.
+ * @param message Request.
+ * @param index Index of the part.
+ * @return Fragment.
+ */
+std::string_view message_part(const s_message &message, size_t index);
+
+/**
+ * Join the fragments of the request.
+ * @param message Request.
+ * @return Server input message.
+ */
+std::string message_string(const s_message &message);
+
+/**
+ * Perform actions according to the server response and build the printed response.
+ * @param server_response The response sent by server.
+ * @param command The current command.
+ * @return Parsed server response.
+ */
+std::string terminal_response(std::string server_response, std::string command);
+
+/**
+ * Perform various token actions.
+ * @param state True if server response was success.
+ * @param command Current command.
+ * @param token Token string.
+ * @return 1 if an error occurs, else 0.
+ */
+int resolve_tokens(bool state, std::string command, std::string token);
+
+/**
+ * Write token into the file.
+ * @param token Token string.
+ * @return 1 if an error occurs, else 0.
+ */
+int set_token(std::string token);
+
+/**
+ * Read token from file.
+ * @return Token string.
+ */
+std::string get_token();
+
+/**
+ * Get the default socket of the agent.
+ * @return $ISA_AGENT, else isa-agent.sock in $XDG_RUNTIME_DIR or /tmp/isa-agent-<uid>.sock, "" if disabled.
+ */
+std::string agent_socket_path();
+
+/**
+ * Fill the address of the agent socket.
+ * @param path Socket path.
+ * @param addr Socket address.
+ * @return Length of the address, 0 if the path is too long.
+ */
+socklen_t agent_address(std::string path, struct sockaddr_un &addr);
+
+/**
+ * Read the user name saved with the token.
+ * @return Escaped user name, or empty string if it is not known.
+ */
+std::string get_user();
+
+#endif /* _REQUEST_H_ */
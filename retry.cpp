@@ -0,0 +1,138 @@
+/**
+ * @file retry.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - retried and hedged read-only requests.
+ *
+ * Only the commands marked read-only in command_table go through here, a request built without the
+ * read_only flag is sent once. A mutating request (send, register) could be applied twice, so it is
+ * never retried or hedged, and the engine does not resend it once written either. Each attempt
+ * builds its own request; its decoder is passed on only once the attempt owns the reply (it was
+ * the first to start decoding it), so a reply is printed once even if both attempts answer.
+ * An attempt that printed a part of its reply cannot be replaced, its failure is final.
+ */
+
+#include <random>
+#include "retry.h"
+
+static s_histogram latencies; // microseconds from sending an attempt to its reply
+static std::mt19937 jitter(std::random_device{}());
+
+void submit_read(s_engine &engine, int conn, std::function<s_engine_request()> make) {
+    if (args.retries == 0 && args.hedge == 0) {
+        engine_submit(engine, conn, make());
+        return;
+    }
+    //* the hedge goes to another connection
+    if (args.hedge > 0 && engine.conns.size() == 1) {
+        engine_open(engine);
+    }
+    std::shared_ptr<s_read> read = std::make_shared<s_read>();
+    read->make = std::move(make);
+    read->conn = conn;
+    read->retries = args.retries;
+    read_attempt(engine, read);
+}
+
+void read_attempt(s_engine &engine, std::shared_ptr<s_read> read) {
+    int attempt = read->attempts++;
+    int conn = (read->conn + attempt) % engine.conns.size();
+    s_engine_request request = read->make();
+    uint64_t started = trace_now();
+
+    //! only a read-only request may be sent more than once
+    if (!request.read_only) {
+        read->retries = 0;
+        read->hedged = true;
+    }
+
+    //* the decoder of an attempt is passed on only while the attempt owns the reply
+    if (request.decoder) {
+        s_decoder *decoder = request.decoder.get();
+        auto on_state = decoder->on_state;
+        auto on_field = decoder->on_field;
+        auto on_body = decoder->on_body;
+        decoder->on_state = [read, attempt, on_state](bool ok) {
+            if (read->owner == -1 && !read->finished) {
+                read->owner = attempt;
+            }
+            if (read->owner == attempt) {
+                on_state(ok);
+            }
+        };
+        decoder->on_field = [read, attempt, on_field](std::string_view field) {
+            if (read->owner == attempt) {
+                on_field(field);
+            }
+        };
+        decoder->on_body = [read, attempt, on_body](std::string_view part) {
+            if (read->owner == attempt) {
+                on_body(part);
+            }
+        };
+    }
+
+    auto on_done = std::move(request.on_done);
+    request.on_done = [&engine, read, attempt, started, on_done](int status, std::string reply) {
+        read->in_flight--;
+        //* the losing attempt, nobody waits for it
+        if (read->finished) {
+            engine.detached--;
+            return;
+        }
+        //* the other attempt owns the reply and completes the request
+        if (read->owner != -1 && read->owner != attempt) {
+            return;
+        }
+        //* a malformed reply is not retried, but the other attempt may still answer
+        if (status == 2 && read->owner != attempt && read->in_flight > 0) {
+            return;
+        }
+        //* connection failures are retried unless a part of the reply was passed on
+        if ((status == 1 || status == 3 || status == 4) && read->owner != attempt) {
+            if (read->in_flight > 0) {
+                return; // the other attempt may still answer
+            }
+            int delay = read->retries > 0 ? retry_delay(args.retries - read->retries) : 0;
+            if (read->retries > 0 && (engine.deadline == 0 || engine_now() + delay < engine.deadline)) {
+                read->retries--;
+                engine_after(engine, delay, true, [&engine, read] { read_attempt(engine, read); });
+                return;
+            }
+        }
+        if (status == 0) {
+            histogram_record(latencies, (trace_now() - started) / 1000);
+        }
+        read->finished = true;
+        engine.detached += read->in_flight;
+        on_done(status, reply);
+    };
+    read->in_flight++;
+    engine_submit(engine, conn, std::move(request));
+
+    //* an attempt that does not start to answer within the delay is duplicated once
+    if (args.hedge > 0 && !read->hedged) {
+        engine_after(engine, hedge_delay(), false, [&engine, read, attempt] {
+            if (!read->finished && !read->hedged && read->owner == -1 && read->attempts == attempt + 1 && read->in_flight > 0) {
+                read->hedged = true;
+                read_attempt(engine, read);
+            }
+        });
+    }
+}
+
+int hedge_delay() {
+    if (latencies.total < HEDGE_MIN_SAMPLES) {
+        return args.hedge;
+    }
+    return (int)std::max<uint64_t>(1, histogram_percentile(latencies, args.hedge_percentile) / 1000);
+}
+
+int retry_delay(int retry) {
+    int backoff = args.retry_backoff;
+    for (int i = 0; i < retry && backoff < RETRY_MAX_BACKOFF; i++) {
+        backoff *= 2;
+    }
+    backoff = std::min(backoff, RETRY_MAX_BACKOFF);
+    return std::uniform_int_distribution<int>(0, std::max(backoff, 0))(jitter);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file retry.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - retried and hedged read-only requests, header.
+ *
+ **/
+
+#ifndef _RETRY_H_
+#define _RETRY_H_
+
+#include "engine.h"
+#include "histogram.h"
+
+#define RETRY_MAX_BACKOFF 5000 // milliseconds the backoff before a retry is capped at
+#define HEDGE_MIN_SAMPLES 20 // replies measured before the percentile replaces the fixed hedge delay
+
+struct s_read {
+    std::function<s_engine_request()> make; // builds the request of an attempt (message, decoder and completion)
+    int conn = 0; // connection of the first attempt, the next ones take the following connections
+    int attempts = 0; // attempts started
+    int in_flight = 0; // attempts not completed yet
+    int retries = 0; // retries left
+    int owner = -1; // attempt whose reply started to be decoded (printed), the others are not passed on
+    bool hedged = false; // the duplicate was sent
+    bool finished = false; // the completion was called, the attempts still in flight are detached
+};
+
+/**
+ * Submit a read-only request (engine read_only flag), it is sent again with a jittered backoff if the connection fails
+ * before any of its reply was passed on, and duplicated on another connection if it is not answered
+ * within the hedge delay. The reply that starts first is used, the other attempt is left detached.
+ * Without retries and hedging the request is submitted as it is.
+ * @param engine Engine state.
+ * @param conn Index of the connection of the first attempt.
+ * @param make Builds the request of each attempt, its decoder and completion are used for the winning one only.
+ */
+void submit_read(s_engine &engine, int conn, std::function<s_engine_request()> make);
+
+/**
+ * Start the next attempt of a read-only request.
+ * @param engine Engine state.
+ * @param read Read-only request.
+ */
+void read_attempt(s_engine &engine, std::shared_ptr<s_read> read);
+
+/**
+ * Get the delay before a request is hedged, the percentile of the measured replies once there are enough.
+ * @return Milliseconds.
+ */
+int hedge_delay();
+
+/**
+ * Get the delay before the next retry, drawn uniformly up to the exponential backoff (full jitter).
+ * @param retry Number of the retry, from 0.
+ * @return Milliseconds.
+ */
+int retry_delay(int retry);
+
+#endif /* _RETRY_H_ */
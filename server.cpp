@@ -0,0 +1,607 @@
+/**
+ * @file server.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - reference server implementation.
+ *
+ * Local stand-in for the course server, for testing and load runs of the client.
+ * Speaks the same protocol (see isa.lua and isa.pcap), keeps the mailboxes in memory
+ * and serves all connections from one non-blocking epoll loop.
+ *
+ * usage: server [ <option> ... ]
+ * <option> is one of
+ * -a <addr>, --address <addr>
+ *    Address to listen on
+ * -p <port>, --port <port>
+ *    Port to listen on
+ * -s <file>, --snapshot <file>
+ *    Load users and messages from the file on start, save them periodically and on exit
+ * -i <sec>, --snapshot-interval <sec>
+ *    Seconds between periodic snapshots
+ * -l <ms>, --latency <ms>
+ *    Delay every reply
+ * -j <ms>, --jitter <ms>
+ *    Add a random delay up to the given value
+ * -f <rate>, --fail-rate <rate>
+ *    Reply to the given fraction of requests with an error
+ * -d <rate>, --drop-rate <rate>
+ *    Close the connection instead of replying to the given fraction of requests
+ * -c, --close
+ *    Close the connection after each reply, as the course server does
+ * --help, -h
+ *    Show this help
+ */
+
+#include "server.h"
+
+#define MAXDATASIZE 65536 // max number of bytes we read at once
+#define MAXEVENTS 1024 // max number of events handled in one loop iteration
+
+static std::vector<s_conn> conns; // client connections indexed by socket
+static std::priority_queue<s_delayed, std::vector<s_delayed>, std::greater<s_delayed>> delayed;
+static std::unordered_map<std::string, s_user> users; // users by escaped name
+static std::unordered_map<std::string, std::string> tokens; // user names by login token
+static std::mt19937_64 rng(std::random_device{}());
+static uint64_t next_conn_id = 1;
+static bool dirty = false; // users or messages changed since the last snapshot
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int) {
+    stop = 1;
+}
+
+int main(int argc, char *argv[])
+{
+    parseargs(argc, argv);
+
+    if (args.snapshot != "" && load_snapshot(args.snapshot) != 0) {
+        return 1;
+    }
+
+    //* allow as many connections as the system limit permits
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    int listenfd = listen_server();
+    if (listenfd == -1) {
+        return 2;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    int rv = run_loop(listenfd);
+    close(listenfd);
+
+    if (args.snapshot != "" && save_snapshot(args.snapshot) != 0) {
+        return 1;
+    }
+    return rv;
+}
+
+void parseargs(int argc, char** argv) {
+    int arg;
+    extern char *optarg;
+
+    //* argument parsing
+    while (1) {
+        static struct option long_options[] = {
+                {"address", 1, 0, 'a'},
+                {"port", 1, 0, 'p'},
+                {"snapshot", 1, 0, 's'},
+                {"snapshot-interval", 1, 0, 'i'},
+                {"latency", 1, 0, 'l'},
+                {"jitter", 1, 0, 'j'},
+                {"fail-rate", 1, 0, 'f'},
+                {"drop-rate", 1, 0, 'd'},
+                {"close", 0, 0, 'c'},
+                {"help", 0, 0, 'h'},
+                {0, 0, 0, 0}
+        };
+        int index = 0;
+        arg = getopt_long(argc, argv, "a:p:s:i:l:j:f:d:ch", long_options, &index);
+        if (arg == -1) {
+            // end of arguments
+            break;
+        }
+        switch (arg) {
+            case 'a':
+                args.addr = optarg;
+                break;
+            case 'p':
+                args.port = optarg;
+                break;
+            case 's':
+                args.snapshot = optarg;
+                break;
+            case 'i':
+                args.snapshot_interval = atoi(optarg);
+                break;
+            case 'l':
+                args.latency = atoi(optarg);
+                break;
+            case 'j':
+                args.jitter = atoi(optarg);
+                break;
+            case 'f':
+                args.fail_rate = atof(optarg);
+                break;
+            case 'd':
+                args.drop_rate = atof(optarg);
+                break;
+            case 'c':
+                args.close_after = true;
+                break;
+            case 'h':
+                p_help();
+                break;
+            case '?':
+                exit(1);
+        }
+    }
+
+    //! no positional arguments
+    if (optind < argc) {
+        fprintf(stderr, "Unexpected argument %s. See --help.\n", argv[optind]);
+        exit(1);
+    }
+}
+
+void p_help() {
+    printf("usage: server [ <option> ... ]\n <option> is one of\n-a <addr>, --address <addr>\nAddress to listen on\n-p <port>, --port <port>\nPort to listen on\n");
+    printf("-s <file>, --snapshot <file>\nLoad users and messages from the file on start, save them periodically and on exit\n-i <sec>, --snapshot-interval <sec>\nSeconds between periodic snapshots\n");
+    printf("-l <ms>, --latency <ms>\nDelay every reply\n-j <ms>, --jitter <ms>\nAdd a random delay up to the given value\n");
+    printf("-f <rate>, --fail-rate <rate>\nReply to the given fraction of requests with an error\n-d <rate>, --drop-rate <rate>\nClose the connection instead of replying to the given fraction of requests\n");
+    printf("-c, --close\nClose the connection after each reply\n--help, -h\nShow this help\n");
+    exit(0);
+}
+
+int listen_server() {
+    struct addrinfo hints, *server_info, *p;
+    int listenfd = -1, yes = 1, rv;
+
+    memset(&hints, 0, sizeof hints);
+    hints.ai_family = AF_UNSPEC; // IPv4 or IPv6
+    hints.ai_socktype = SOCK_STREAM; // TCP
+    hints.ai_flags = AI_PASSIVE;
+    if ((rv = getaddrinfo(args.addr.c_str(), args.port.c_str(), &hints, &server_info)) != 0) {
+        fprintf(stderr, "getaddrinfo: %s\n", gai_strerror(rv));
+        return -1;
+    }
+    //* bind to the first address we can
+    for (p = server_info; p != NULL; p = p->ai_next) {
+        if ((listenfd = socket(p->ai_family, p->ai_socktype | SOCK_NONBLOCK, p->ai_protocol)) == -1) {
+            perror("server: socket");
+            continue;
+        }
+        setsockopt(listenfd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof yes);
+        if (bind(listenfd, p->ai_addr, p->ai_addrlen) == -1) {
+            close(listenfd);
+            perror("server: bind");
+            continue;
+        }
+        break;
+    }
+    freeaddrinfo(server_info);
+
+    if (p == NULL) {
+        fprintf(stderr, "Server failed to bind.\n");
+        return -1;
+    }
+    if (listen(listenfd, SOMAXCONN) == -1) {
+        perror("server: listen");
+        close(listenfd);
+        return -1;
+    }
+    return listenfd;
+}
+
+int run_loop(int listenfd) {
+    struct epoll_event ev, events[MAXEVENTS];
+    int64_t next_snapshot = now_ms() + args.snapshot_interval * 1000;
+
+    int epfd = epoll_create1(0);
+    if (epfd == -1) {
+        perror("server: epoll_create1");
+        return 1;
+    }
+    ev.events = EPOLLIN;
+    ev.data.fd = listenfd;
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, listenfd, &ev) == -1) {
+        perror("server: epoll_ctl");
+        close(epfd);
+        return 1;
+    }
+
+    while (!stop) {
+        //* sleep until the next delayed reply or snapshot is due
+        int timeout = -1;
+        int64_t now = now_ms();
+        if (!delayed.empty()) {
+            timeout = std::max<int64_t>(0, delayed.top().due - now);
+        }
+        if (args.snapshot != "") {
+            int64_t until_snapshot = std::max<int64_t>(0, next_snapshot - now);
+            timeout = timeout == -1 ? until_snapshot : std::min<int64_t>(timeout, until_snapshot);
+        }
+
+        int n = epoll_wait(epfd, events, MAXEVENTS, timeout);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("server: epoll_wait");
+            close(epfd);
+            return 1;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenfd) {
+                accept_connections(epfd, listenfd);
+                continue;
+            }
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                close_connection(epfd, fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                read_requests(epfd, fd);
+            }
+            if ((events[i].events & EPOLLOUT) && conns[fd].open) {
+                write_replies(epfd, fd);
+            }
+        }
+
+        //* replies whose delay has passed
+        now = now_ms();
+        while (!delayed.empty() && delayed.top().due <= now) {
+            s_delayed item = delayed.top();
+            delayed.pop();
+            if (!conns[item.fd].open || conns[item.fd].id != item.conn_id) {
+                continue; // connection closed meanwhile
+            }
+            if (item.drop) {
+                close_connection(epfd, item.fd);
+            } else {
+                queue_reply(epfd, item.fd, item.reply);
+            }
+        }
+
+        if (args.snapshot != "" && now >= next_snapshot) {
+            if (dirty && save_snapshot(args.snapshot) == 0) {
+                dirty = false;
+            }
+            next_snapshot = now + args.snapshot_interval * 1000;
+        }
+    }
+
+    for (size_t fd = 0; fd < conns.size(); fd++) {
+        if (conns[fd].open) {
+            close_connection(epfd, fd);
+        }
+    }
+    close(epfd);
+    return 0;
+}
+
+void accept_connections(int epfd, int listenfd) {
+    struct epoll_event ev;
+    int fd, yes = 1;
+
+    while ((fd = accept4(listenfd, NULL, NULL, SOCK_NONBLOCK)) != -1) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof yes);
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+            perror("server: epoll_ctl");
+            close(fd);
+            continue;
+        }
+        if ((size_t)fd >= conns.size()) {
+            conns.resize(fd + 1);
+        }
+        conns[fd] = s_conn();
+        conns[fd].open = true;
+        conns[fd].id = next_conn_id++;
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("server: accept");
+    }
+}
+
+void read_requests(int epfd, int fd) {
+    char buf[MAXDATASIZE];
+    s_conn &conn = conns[fd];
+    ssize_t numbytes;
+    bool closed = false;
+
+    while ((numbytes = recv(fd, buf, MAXDATASIZE, 0)) > 0) {
+        //* the course server reads only the first request of a connection
+        if (!conn.closing) {
+            conn.in.append(buf, numbytes);
+        }
+    }
+    if (numbytes == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+        closed = true;
+    }
+
+    //* handle all complete requests, in order
+    size_t handled = 0, end;
+    while (!conn.closing && (end = frame_reply(conn.framer, conn.in.data() + conn.scanned, conn.in.size() - conn.scanned)) != std::string::npos) {
+        conn.scanned += end;
+        std::string_view request(conn.in.data() + handled, conn.scanned - handled);
+        handled = conn.scanned;
+        conn.framer = s_framer();
+        if (args.close_after) {
+            conn.closing = true;
+        }
+        schedule_reply(epfd, fd, handle_request(request));
+        if (!conns[fd].open) {
+            return; // connection dropped by fault injection
+        }
+    }
+    conn.scanned = conn.in.size();
+    conn.in.erase(0, handled);
+    conn.scanned -= handled;
+
+    //* client closed its side, finish sending the queued replies (delayed ones are dropped)
+    if (closed) {
+        if (conn.out_offset < conn.out.size()) {
+            conn.closing = true;
+        } else {
+            close_connection(epfd, fd);
+        }
+    }
+}
+
+void schedule_reply(int epfd, int fd, std::string reply) {
+    std::uniform_real_distribution<double> chance(0, 1);
+    bool drop = args.drop_rate > 0 && chance(rng) < args.drop_rate;
+    if (!drop && args.fail_rate > 0 && chance(rng) < args.fail_rate) {
+        reply = simple_reply(false, "injected fault");
+    }
+
+    if (args.latency == 0 && args.jitter == 0) {
+        if (drop) {
+            close_connection(epfd, fd);
+        } else {
+            queue_reply(epfd, fd, reply);
+        }
+        return;
+    }
+
+    //* delayed replies of one connection keep their order
+    s_conn &conn = conns[fd];
+    int64_t delay = args.latency + (args.jitter > 0 ? (int64_t)(rng() % (args.jitter + 1)) : 0);
+    conn.last_due = std::max(conn.last_due, now_ms() + delay);
+    static uint64_t seq = 0;
+    delayed.push({conn.last_due, seq++, fd, conn.id, std::move(reply), drop});
+}
+
+void queue_reply(int epfd, int fd, std::string_view reply) {
+    s_conn &conn = conns[fd];
+    conn.out.append(reply);
+    write_replies(epfd, fd);
+}
+
+void write_replies(int epfd, int fd) {
+    s_conn &conn = conns[fd];
+    struct epoll_event ev;
+    ssize_t numbytes;
+
+    while (conn.out_offset < conn.out.size()) {
+        numbytes = send(fd, conn.out.data() + conn.out_offset, conn.out.size() - conn.out_offset, MSG_NOSIGNAL);
+        if (numbytes == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            close_connection(epfd, fd);
+            return;
+        }
+        conn.out_offset += numbytes;
+    }
+
+    bool pending = conn.out_offset < conn.out.size();
+    if (!pending) {
+        conn.out.clear();
+        conn.out_offset = 0;
+        if (conn.closing) {
+            close_connection(epfd, fd);
+            return;
+        }
+    }
+    //* wait for the socket to become writable only while something is pending
+    if (pending != conn.writing) {
+        conn.writing = pending;
+        ev.events = EPOLLIN | (pending ? EPOLLOUT : 0);
+        ev.data.fd = fd;
+        epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+    }
+}
+
+void close_connection(int epfd, int fd) {
+    epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+    conns[fd] = s_conn();
+}
+
+std::string handle_request(std::string_view request) {
+    s_request parsed;
+
+    if (parse_request(request, parsed) != 0) {
+        return simple_reply(false, "wrong arguments");
+    }
+    std::string command(parsed.command);
+    size_t count = parsed.args.size();
+    std::vector<std::string> arg(parsed.args.begin(), parsed.args.end());
+
+    //* commands without login
+    if (command == "register" || command == "login") {
+        if (count != 2 || !parsed.quoted[0] || !parsed.quoted[1]) {
+            return simple_reply(false, "wrong arguments");
+        }
+        auto user = users.find(arg[0]);
+        if (command == "register") {
+            if (user != users.end()) {
+                return simple_reply(false, "user already registered");
+            }
+            users[arg[0]].password = arg[1];
+            dirty = true;
+            return simple_reply(true, "registered user " + arg[0]);
+        }
+        if (user == users.end()) {
+            return simple_reply(false, "unknown user");
+        }
+        if (user->second.password != arg[1]) {
+            return simple_reply(false, "incorrect password");
+        }
+        std::string token = new_token(arg[0]);
+        tokens[token] = arg[0];
+        return "(ok \"user logged in\" \"" + token + "\")";
+    }
+
+    if (command != "list" && command != "logout" && command != "send" && command != "fetch") {
+        return simple_reply(false, "unknown command");
+    }
+    if (count < 1 || !parsed.quoted[0]) {
+        return simple_reply(false, "wrong arguments");
+    }
+    auto token = tokens.find(arg[0]);
+    if (token == tokens.end()) {
+        return simple_reply(false, "incorrect login token");
+    }
+    s_user &user = users[token->second];
+
+    if (command == "logout" || command == "list") {
+        if (count != 1) {
+            return simple_reply(false, "wrong arguments");
+        }
+        if (command == "logout") {
+            tokens.erase(token);
+            return simple_reply(true, "logged out");
+        }
+        std::string reply = "(ok (";
+        for (size_t i = 0; i < user.messages.size(); i++) {
+            s_message &msg = user.messages[i];
+            reply += (i == 0 ? "(" : " (") + std::to_string(i + 1) + " \"" + msg.sender + "\" \"" + msg.subject + "\")";
+        }
+        return reply + "))";
+
+    } else if (command == "send") {
+        if (count != 4 || !parsed.quoted[1] || !parsed.quoted[2] || !parsed.quoted[3]) {
+            return simple_reply(false, "wrong arguments");
+        }
+        auto recipient = users.find(arg[1]);
+        if (recipient == users.end()) {
+            return simple_reply(false, "unknown recipient");
+        }
+        recipient->second.messages.push_back({token->second, arg[2], arg[3]});
+        dirty = true;
+        return simple_reply(true, "message sent");
+
+    } else {
+        //* fetch
+        if (count != 2 || parsed.quoted[1]) {
+            return simple_reply(false, "wrong arguments");
+        }
+        char *end;
+        long id = strtol(arg[1].c_str(), &end, 10);
+        if (*end != '\0') {
+            return simple_reply(false, "wrong arguments");
+        }
+        if (id < 1 || (size_t)id > user.messages.size()) {
+            return simple_reply(false, "message id not found");
+        }
+        s_message &msg = user.messages[id - 1];
+        std::string reply;
+        reply.reserve(msg.sender.size() + msg.subject.size() + msg.body.size() + 16);
+        reply += "(ok (\"";
+        reply += msg.sender;
+        reply += "\" \"";
+        reply += msg.subject;
+        reply += "\" \"";
+        reply += msg.body;
+        reply += "\"))";
+        return reply;
+    }
+}
+
+std::string simple_reply(bool ok, std::string_view text) {
+    std::string reply = ok ? "(ok \"" : "(err \"";
+    reply += text;
+    reply += "\")";
+    return reply;
+}
+
+std::string new_token(std::string_view user) {
+    //* user name and login time, as the tokens of the course server
+    static uint64_t counter = 0;
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    std::string seed(user);
+    seed += std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+    seed += "." + std::to_string(++counter);
+    return encoding::Base64::Encode(seed);
+}
+
+int load_snapshot(std::string path) {
+    std::ifstream file(path); //* read mode
+    std::string line;
+    s_request record;
+
+    if (file.fail()) {
+        return 0; // no snapshot yet
+    }
+    //* one record per line, in the request format: (user "name" "password") or (message "recipient" "sender" "subject" "body")
+    while (std::getline(file, line)) {
+        if (line == "") {
+            continue;
+        }
+        if (parse_request(line, record) != 0) {
+            fprintf(stderr, "Invalid snapshot record: %s\n", line.c_str());
+            return 1;
+        }
+        std::vector<std::string> fields(record.args.begin(), record.args.end());
+        if (record.command == "user" && fields.size() == 2) {
+            users[fields[0]].password = fields[1];
+        } else if (record.command == "message" && fields.size() == 4 && users.count(fields[0]) != 0) {
+            users[fields[0]].messages.push_back({fields[1], fields[2], fields[3]});
+        } else {
+            fprintf(stderr, "Invalid snapshot record: %s\n", line.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int save_snapshot(std::string path) {
+    //* write a new file and rename it, an interrupted save keeps the old snapshot
+    std::string tmp_path = path + ".tmp";
+    std::ofstream file(tmp_path); //* write mode
+    if (file.fail()) {
+        fprintf(stderr, "Error while saving the snapshot.\n");
+        return 1;
+    }
+    for (auto &user : users) {
+        file << "(user \"" << user.first << "\" \"" << user.second.password << "\")\n";
+    }
+    for (auto &user : users) {
+        for (auto &msg : user.second.messages) {
+            file << "(message \"" << user.first << "\" \"" << msg.sender << "\" \"" << msg.subject << "\" \"" << msg.body << "\")\n";
+        }
+    }
+    file.close();
+    if (file.fail() || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        fprintf(stderr, "Error while saving the snapshot.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,193 @@
+/**
+ * @file server.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - reference server implementation, header.
+ *
+ **/
+
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <fstream>
+#include <chrono>
+#include <csignal>
+#include <unistd.h>
+#include "base64.h"
+#include "protocol.h"
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+
+struct s_args {
+    std::string addr = "127.0.0.1";
+    std::string port = "32323";
+    std::string snapshot = ""; // file with users and messages, loaded on start and saved on exit
+    int snapshot_interval = 60; // seconds between periodic snapshots
+    int latency = 0; // milliseconds added before each reply
+    int jitter = 0; // random milliseconds added on top of the latency
+    double fail_rate = 0; // probability of replying with an injected error
+    double drop_rate = 0; // probability of closing the connection instead of replying
+    bool close_after = false; // close the connection after each reply
+} args;
+
+struct s_message {
+    std::string sender; // all strings are kept escaped, as they were received
+    std::string subject;
+    std::string body;
+};
+
+struct s_user {
+    std::string password; // base64 encoded password
+    std::vector<s_message> messages;
+};
+
+struct s_conn {
+    bool open = false;
+    uint64_t id = 0; // distinguishes connections reusing the same descriptor
+    std::string in = ""; // received data not handled yet
+    size_t scanned = 0; // bytes of the received data already passed to the framer
+    s_framer framer;
+    std::string out = ""; // replies not sent yet
+    size_t out_offset = 0; // bytes of the replies already sent
+    bool writing = false; // EPOLLOUT is registered
+    bool closing = false; // close the connection once the replies are sent
+    int64_t last_due = 0; // time when the last delayed reply is due, keeps the replies in order
+};
+
+struct s_delayed {
+    int64_t due; // monotonic time in milliseconds
+    uint64_t seq; // order of replies due at the same time
+    int fd;
+    uint64_t conn_id;
+    std::string reply;
+    bool drop; // close the connection instead of replying
+    bool operator>(const s_delayed &other) const { return due != other.due ? due > other.due : seq > other.seq; }
+};
+
+/**
+ * Parse command line arguments.
+ * @param argc Number of arguments.
+ * @param argv Array of arguments.
+ */
+void parseargs(int argc, char** argv);
+
+/**
+ * Print help.
+ */
+void p_help();
+
+/**
+ * Create the listening socket.
+ * @return Listening socket, or -1 if an error occurs.
+ */
+int listen_server();
+
+/**
+ * Serve the clients until the server is stopped by a signal.
+ * @param listenfd Listening socket.
+ * @return 1 if an error occurs, else 0.
+ */
+int run_loop(int listenfd);
+
+/**
+ * Accept all pending connections.
+ * @param epfd Epoll instance.
+ * @param listenfd Listening socket.
+ */
+void accept_connections(int epfd, int listenfd);
+
+/**
+ * Read the available data and handle all complete requests.
+ * @param epfd Epoll instance.
+ * @param fd Client socket.
+ */
+void read_requests(int epfd, int fd);
+
+/**
+ * Queue the reply to the request, applying the artificial latency and fault injection.
+ * @param epfd Epoll instance.
+ * @param fd Client socket.
+ * @param reply Reply message.
+ */
+void schedule_reply(int epfd, int fd, std::string reply);
+
+/**
+ * Queue the reply to be sent and send as much as possible.
+ * @param epfd Epoll instance.
+ * @param fd Client socket.
+ * @param reply Reply message.
+ */
+void queue_reply(int epfd, int fd, std::string_view reply);
+
+/**
+ * Send the queued replies until the socket would block.
+ * @param epfd Epoll instance.
+ * @param fd Client socket.
+ */
+void write_replies(int epfd, int fd);
+
+/**
+ * Close the client connection and forget its state.
+ * @param epfd Epoll instance.
+ * @param fd Client socket.
+ */
+void close_connection(int epfd, int fd);
+
+/**
+ * Perform the request and build the reply.
+ * @param request The request sent by client.
+ * @return Reply message.
+ */
+std::string handle_request(std::string_view request);
+
+/**
+ * Build a reply with one quoted string.
+ * @param ok True for an ok reply, false for an err reply.
+ * @param text Escaped text of the reply.
+ * @return Reply message.
+ */
+std::string simple_reply(bool ok, std::string_view text);
+
+/**
+ * Create a login token for the user.
+ * @param user User name.
+ * @return Token string.
+ */
+std::string new_token(std::string_view user);
+
+/**
+ * Load users and messages from the snapshot file.
+ * @param path Snapshot file.
+ * @return 1 if an error occurs, else 0.
+ */
+int load_snapshot(std::string path);
+
+/**
+ * Save users and messages to the snapshot file.
+ * @param path Snapshot file.
+ * @return 1 if an error occurs, else 0.
+ */
+int save_snapshot(std::string path);
+
+/**
+ * Get the monotonic time.
+ * @return Time in milliseconds.
+ */
+int64_t now_ms();
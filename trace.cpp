@@ -0,0 +1,108 @@
+/**
+ * @file trace.cpp
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - per-request phase timing.
+ *
+ * Each traced request records monotonic timestamps of its phases in the client engine:
+ *  resolve  - getaddrinfo of the server address (first request of the process)
+ *  connect  - non-blocking connect until the connection is established
+ *  send     - first to last byte of the request accepted by the socket
+ *  wait     - last byte sent to the first byte of the reply received
+ *  receive  - first byte to the end of the reply
+ *  parse    - handling of the reply (parsing and printing) once it is complete
+ * and is written as one JSON line when it completes. Requests are not traced unless the trace
+ * is enabled (--trace or ISA_TRACE), the engine only checks for a missing trace then.
+ */
+
+#include "trace.h"
+
+int trace_fd = -1;
+static uint64_t resolve_start = 0; // resolving started, waiting for the next request
+static uint64_t resolve_time = 0;
+
+int trace_open(std::string path) {
+    if (path == "" || path == "-" || path == "stderr") {
+        trace_fd = STDERR_FILENO;
+        return 0;
+    }
+    //* lines are appended with one write, so several clients can share the file
+    trace_fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (trace_fd == -1) {
+        perror("Error while opening the trace file");
+        return 1;
+    }
+    return 0;
+}
+
+int trace_open_env() {
+    const char *value = getenv(TRACE_ENV);
+    if (value == NULL || value[0] == '\0' || strcmp(value, "0") == 0) {
+        return 0;
+    }
+    return trace_open(strcmp(value, "1") == 0 ? "" : value);
+}
+
+uint64_t trace_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void trace_resolved(uint64_t start) {
+    resolve_start = start;
+    resolve_time = trace_now() - start;
+}
+
+std::shared_ptr<s_trace> trace_begin(std::string_view command) {
+    std::shared_ptr<s_trace> trace = std::make_shared<s_trace>();
+
+    //* the command word only, it is written into the JSON line as it is
+    size_t start = command.find_first_not_of("( \t\r\n");
+    for (char c : command.substr(std::min(start, command.size()), 32)) {
+        if (!isalnum((unsigned char)c)) {
+            break;
+        }
+        trace->command += c;
+    }
+    trace->start = trace_now();
+    //* the first request waited for the server address
+    if (resolve_start != 0) {
+        trace->start = resolve_start;
+        trace->resolve = resolve_time;
+        resolve_start = 0;
+    }
+    return trace;
+}
+
+/**
+ * Nanoseconds between two timestamps as microseconds, 0 if either is missing.
+ */
+static double span(uint64_t from, uint64_t to) {
+    return from != 0 && to > from ? (to - from) / 1e3 : 0;
+}
+
+void trace_end(s_trace &trace, int status) {
+    char line[TRACE_LINE];
+    struct timespec wall;
+
+    if (trace_fd == -1) {
+        return;
+    }
+    trace_mark(trace.done);
+    clock_gettime(CLOCK_REALTIME, &wall);
+    //* durations of the phases, then the timestamps they were computed from
+    int len = snprintf(line, sizeof line, "{\"ts\":%ld.%06ld,\"pid\":%d,\"command\":\"%s\",\"status\":%d,\"reused\":%s,"
+        "\"resolve_us\":%.1f,\"connect_us\":%.1f,\"send_us\":%.1f,\"wait_us\":%.1f,\"receive_us\":%.1f,\"parse_us\":%.1f,\"total_us\":%.1f,"
+        "\"bytes_sent\":%lu,\"bytes_received\":%lu,\"recv_calls\":%lu,\"mono_ns\":{\"start\":%lu,\"connect\":%lu,\"connected\":%lu,"
+        "\"first_sent\":%lu,\"sent\":%lu,\"first_byte\":%lu,\"received\":%lu,\"done\":%lu}}\n",
+        (long)wall.tv_sec, wall.tv_nsec / 1000, (int)getpid(), trace.command.c_str(), status, trace.reused ? "true" : "false",
+        trace.resolve / 1e3, span(trace.connect, trace.connected), span(trace.first_sent, trace.sent), span(trace.sent, trace.first_byte),
+        span(trace.first_byte, trace.received), span(trace.received, trace.done), span(trace.start, trace.done),
+        trace.bytes_sent, trace.bytes_received, trace.recv_calls, trace.start, trace.connect, trace.connected,
+        trace.first_sent, trace.sent, trace.first_byte, trace.received, trace.done);
+    if (len > 0 && write(trace_fd, line, std::min<size_t>(len, sizeof line - 1)) == -1 && errno != EPIPE) {
+        perror("Error while writing the trace");
+        trace_fd = -1;
+    }
+}
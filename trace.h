@@ -0,0 +1,98 @@
+/**
+ * @file trace.h
+ * @author Tereza Burianova, xburia28
+ * @date 16 Oct 2026
+ * @brief ISA project - per-request phase timing, header.
+ *
+ **/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <memory>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define TRACE_ENV "ISA_TRACE" // environment variable enabling the trace, "1" or "stderr" for stderr, else a file path
+#define TRACE_LINE 1024 // max length of one trace line
+
+struct s_trace {
+    std::string command = ""; // first word of the request
+    bool reused = false; // sent over a connection already open
+    uint64_t resolve = 0; // nanoseconds of resolving the server address, the first request of the process only
+    // monotonic timestamps in nanoseconds, 0 if the phase was not reached
+    uint64_t start = 0; // request submitted (resolving started for the first request)
+    uint64_t connect = 0; // connect started for the request
+    uint64_t connected = 0; // connection established
+    uint64_t first_sent = 0; // first byte of the request accepted by the socket
+    uint64_t sent = 0; // last byte of the request accepted by the socket
+    uint64_t first_byte = 0; // first byte of the reply received
+    uint64_t received = 0; // reply complete (framed, or decoded while received)
+    uint64_t done = 0; // reply handled (parsed and printed)
+    uint64_t bytes_sent = 0;
+    uint64_t bytes_received = 0; // bytes of the reply
+    uint64_t recv_calls = 0; // recv calls returning data while the request was the first waiting for its reply
+};
+
+extern int trace_fd; // trace output, -1 if the trace is disabled
+
+/**
+ * Enable the trace.
+ * @param path Output file (appended to), "" or "-" for stderr.
+ * @return 1 if the file cannot be opened, else 0.
+ */
+int trace_open(std::string path);
+
+/**
+ * Enable the trace if the environment variable asks for it.
+ * @return 1 if the file cannot be opened, else 0.
+ */
+int trace_open_env();
+
+/**
+ * Get the monotonic time.
+ * @return Nanoseconds.
+ */
+uint64_t trace_now();
+
+/**
+ * Record the time of resolving the server address, it is reported with the next request.
+ * @param start Time resolving started.
+ */
+void trace_resolved(uint64_t start);
+
+/**
+ * Start the trace of a request.
+ * @param command First word of the request.
+ * @return Trace of the request.
+ */
+std::shared_ptr<s_trace> trace_begin(std::string_view command);
+
+/**
+ * Set a timestamp of the trace unless it is already set.
+ * @param slot Timestamp.
+ */
+inline void trace_mark(uint64_t &slot) {
+    if (slot == 0) {
+        slot = trace_now();
+    }
+}
+
+/**
+ * Write the trace of a completed request as one JSON line.
+ * @param trace Trace of the request.
+ * @param status Completion status of the request.
+ */
+void trace_end(s_trace &trace, int status);
+
+#endif /* _TRACE_H_ */